@@ -0,0 +1,593 @@
+#include "server/src/async_server.h"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "google/protobuf/arena.h"
+#include "grpcpp/completion_queue.h"
+#include "grpcpp/security/server_credentials.h"
+#include "grpcpp/server_builder.h"
+#include "grpcpp/server_context.h"
+#include "grpcpp/support/async_stream.h"
+#include "grpcpp/support/async_unary_call.h"
+
+#include "proto/service.grpc.pb.h"
+#include "server/src/service.h"
+
+namespace debt_simpl {
+
+namespace {
+
+// Has simplifications settle their components on `compute_pool`, which they
+// already run on, unless the options name another pool.
+AsyncServerOptions WithComputePool(AsyncServerOptions options,
+                                   ThreadPool* compute_pool) {
+  if (options.simplifier_options.thread_pool == nullptr) {
+    options.simplifier_options.thread_pool = compute_pool;
+  }
+  return options;
+}
+
+}  // namespace
+
+class AsyncServer::Call {
+ public:
+  // Counts the call as live on `server` until it is deleted.
+  explicit Call(AsyncServer* server) : server_(server) {
+    absl::MutexLock lock(&server_->calls_mutex_);
+    server_->num_calls_++;
+  }
+
+  virtual ~Call() {
+    absl::MutexLock lock(&server_->calls_mutex_);
+    server_->num_calls_--;
+  }
+
+  // Moves the call on once its pending operation completed. `ok` is false if
+  // the operation failed, which ends the call.
+  virtual void Proceed(bool ok) = 0;
+
+ private:
+  AsyncServer* const server_;
+};
+
+template <typename Request, typename Response>
+class AsyncServer::UnaryCall : public AsyncServer::Call {
+ public:
+  // `on_request` runs on a polling thread once a client made the call. It
+  // must eventually call `Finish()`, from any thread.
+  UnaryCall(AsyncServer* server, std::function<void(UnaryCall*)> on_request)
+      : Call(server),
+        response_(
+            google::protobuf::Arena::CreateMessage<Response>(&arena_)),
+        responder_(&context_),
+        on_request_(std::move(on_request)) {}
+
+  grpc::ServerContext* context() {
+    return &context_;
+  }
+
+  Request* request() {
+    return &request_;
+  }
+
+  Response* response() {
+    return response_;
+  }
+
+  grpc::ServerAsyncResponseWriter<Response>* responder() {
+    return &responder_;
+  }
+
+  void Finish(const grpc::Status& status) {
+    responder_.Finish(*response_, status, this);
+  }
+
+  void Proceed(bool ok) override {
+    // Either the request failed to arrive, meaning the server is shutting
+    // down, or the response was sent.
+    if (!ok || finishing_) {
+      delete this;
+      return;
+    }
+    finishing_ = true;
+    on_request_(this);
+  }
+
+ private:
+  grpc::ServerContext context_;
+  Request request_;
+  // The response and everything in it are freed along with the call, in one
+  // go.
+  google::protobuf::Arena arena_;
+  Response* const response_;
+  grpc::ServerAsyncResponseWriter<Response> responder_;
+
+  std::function<void(UnaryCall*)> on_request_;
+  bool finishing_ = false;
+};
+
+template <typename Request, typename Response>
+class AsyncServer::ServerStreamingCall : public AsyncServer::Call {
+ public:
+  // `on_request` runs on a polling thread once a client made the call. It
+  // must eventually call `Finish()` after any number of calls to `Write()`,
+  // from one thread at a time, though not necessarily the same one.
+  ServerStreamingCall(AsyncServer* server,
+                      std::function<void(ServerStreamingCall*)> on_request)
+      : Call(server),
+        writer_(&context_),
+        on_request_(std::move(on_request)) {}
+
+  grpc::ServerContext* context() {
+    return &context_;
+  }
+
+  Request* request() {
+    return &request_;
+  }
+
+  grpc::ServerAsyncWriter<Response>* writer() {
+    return &writer_;
+  }
+
+  // Queues `response` to be sent after the ones written before it. Only one
+  // write can be in flight at a time, so responses produced faster than the
+  // client reads them wait here, and the polling threads send them as writes
+  // complete. Never blocks, so a client that stops reading doesn't hold up
+  // the caller, only the memory of what it hasn't read.
+  void Write(const Response& response) {
+    Operation operation;
+    {
+      absl::MutexLock lock(&mutex_);
+      if (!client_gone_) {
+        pending_.push_back(response);
+      }
+      operation = NextOperation();
+    }
+    Start(operation);
+  }
+
+  // Ends the call with `status` once every queued response is sent. The call
+  // must not be touched after this.
+  void Finish(const grpc::Status& status) {
+    Operation operation;
+    {
+      absl::MutexLock lock(&mutex_);
+      status_ = status;
+      operation = NextOperation();
+    }
+    Start(operation);
+    Unref();
+  }
+
+  void Proceed(bool ok) override {
+    if (!requested_) {
+      if (!ok) {
+        delete this;
+        return;
+      }
+      requested_ = true;
+      on_request_(this);
+      return;
+    }
+
+    // A write or the finish completed.
+    bool finished = false;
+    Operation operation = Operation::kNone;
+    {
+      absl::MutexLock lock(&mutex_);
+      if (operation_in_flight_ == Operation::kFinish) {
+        finished = true;
+      } else {
+        if (!ok) {
+          // The client went away, so there is no point in sending the rest.
+          client_gone_ = true;
+          pending_.clear();
+        }
+        operation_in_flight_ = Operation::kNone;
+        operation = NextOperation();
+      }
+    }
+    if (finished) {
+      Unref();
+      return;
+    }
+    Start(operation);
+  }
+
+ private:
+  enum class Operation { kNone, kWrite, kFinish };
+
+  // Picks the next operation to start, if none is in flight.
+  Operation NextOperation() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    if (operation_in_flight_ != Operation::kNone) {
+      return Operation::kNone;
+    }
+    if (!pending_.empty()) {
+      current_ = std::move(pending_.front());
+      pending_.pop_front();
+      operation_in_flight_ = Operation::kWrite;
+    } else if (status_.has_value()) {
+      operation_in_flight_ = Operation::kFinish;
+    }
+    return operation_in_flight_;
+  }
+
+  // Starts `operation` outside of the mutex, since its completion may be
+  // handled on another poller before this returns.
+  void Start(Operation operation) {
+    switch (operation) {
+      case Operation::kNone:
+        break;
+      case Operation::kWrite:
+        writer_.Write(current_, this);
+        break;
+      case Operation::kFinish:
+        writer_.Finish(*status_, this);
+        break;
+    }
+  }
+
+  // The call is deleted once both the producer is done with it and the finish
+  // completed, whichever comes last.
+  void Unref() {
+    if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      delete this;
+    }
+  }
+
+  grpc::ServerContext context_;
+  Request request_;
+  grpc::ServerAsyncWriter<Response> writer_;
+
+  std::function<void(ServerStreamingCall*)> on_request_;
+  bool requested_ = false;
+  std::atomic<int> refs_ = 2;
+
+  absl::Mutex mutex_;
+  std::deque<Response> pending_ ABSL_GUARDED_BY(mutex_);
+  std::optional<grpc::Status> status_ ABSL_GUARDED_BY(mutex_);
+  bool client_gone_ ABSL_GUARDED_BY(mutex_) = false;
+  Operation operation_in_flight_ ABSL_GUARDED_BY(mutex_) = Operation::kNone;
+  // The response being written. Only touched by whoever starts a write, and
+  // only one is in flight at a time.
+  Response current_;
+};
+
+template <typename Request, typename Response>
+class AsyncServer::ClientStreamingCall : public AsyncServer::Call {
+ public:
+  // `on_request` runs on a polling thread once a client made the call, then
+  // `on_read` with each request it sends, in order. Once the client is done
+  // sending, `on_requests_done` runs and must eventually call `Finish()`, from
+  // any thread. If `on_read` fails, the call ends with its status instead,
+  // and if the client cancels the call, it ends without `on_requests_done`.
+  ClientStreamingCall(
+      AsyncServer* server, std::function<void()> on_request,
+      std::function<grpc::Status(const Request&)> on_read,
+      std::function<void(ClientStreamingCall*)> on_requests_done)
+      : Call(server),
+        response_(
+            google::protobuf::Arena::CreateMessage<Response>(&arena_)),
+        reader_(&context_),
+        on_request_(std::move(on_request)),
+        on_read_(std::move(on_read)),
+        on_requests_done_(std::move(on_requests_done)) {}
+
+  grpc::ServerContext* context() {
+    return &context_;
+  }
+
+  Response* response() {
+    return response_;
+  }
+
+  grpc::ServerAsyncReader<Response, Request>* reader() {
+    return &reader_;
+  }
+
+  void Finish(const grpc::Status& status) {
+    state_ = State::kFinishing;
+    reader_.Finish(*response_, status, this);
+  }
+
+  void Proceed(bool ok) override {
+    switch (state_) {
+      case State::kRequested:
+        if (!ok) {
+          // The server is shutting down.
+          delete this;
+          return;
+        }
+        on_request_();
+        break;
+      case State::kReading:
+        if (!ok) {
+          // Either the client closed its side of the stream, or it went away
+          // and what was read is only part of what it meant to send. The
+          // context may not know which yet, but anything sent on a cancelled
+          // call fails, so the headers tell them apart.
+          state_ = State::kReadsDone;
+          reader_.SendInitialMetadata(this);
+          return;
+        }
+        if (grpc::Status status = on_read_(request_); !status.ok()) {
+          Finish(status);
+          return;
+        }
+        break;
+      case State::kReadsDone:
+        if (!ok) {
+          // The call was cancelled, so there is no one to answer.
+          delete this;
+          return;
+        }
+        on_requests_done_(this);
+        return;
+      case State::kFinishing:
+        delete this;
+        return;
+    }
+    // Only one read is in flight at a time, and each request is handled
+    // before the next one is read, so a single message is buffered no matter
+    // how many the client sends.
+    state_ = State::kReading;
+    reader_.Read(&request_, this);
+  }
+
+ private:
+  enum class State { kRequested, kReading, kReadsDone, kFinishing };
+
+  grpc::ServerContext context_;
+  Request request_;
+  google::protobuf::Arena arena_;
+  Response* const response_;
+  grpc::ServerAsyncReader<Response, Request> reader_;
+
+  std::function<void()> on_request_;
+  std::function<grpc::Status(const Request&)> on_read_;
+  std::function<void(ClientStreamingCall*)> on_requests_done_;
+  State state_ = State::kRequested;
+};
+
+// static
+absl::StatusOr<std::unique_ptr<AsyncServer>> AsyncServer::Start(
+    const std::string& address, const AsyncServerOptions& options) {
+  if (options.num_completion_queues == 0 ||
+      options.pollers_per_completion_queue == 0) {
+    return absl::InvalidArgumentError(
+        "Need at least one completion queue and poller");
+  }
+
+  std::unique_ptr<AsyncServer> server(new AsyncServer(options));
+
+  grpc::ServerBuilder builder;
+  builder.AddListeningPort(address, grpc::InsecureServerCredentials(),
+                           &server->port_);
+  builder.RegisterService(&server->service_);
+  builder.SetMaxReceiveMessageSize(options.max_message_bytes);
+  builder.SetMaxSendMessageSize(options.max_message_bytes);
+  for (uint32_t i = 0; i < options.num_completion_queues; i++) {
+    server->cqs_.push_back(builder.AddCompletionQueue());
+  }
+  server->server_ = builder.BuildAndStart();
+  if (server->server_ == nullptr) {
+    return absl::UnavailableError(
+        absl::StrCat("Failed to start RPC server on ", address));
+  }
+
+  for (const auto& cq : server->cqs_) {
+    // Keep a call of each method pending per poller, so that concurrent calls
+    // don't wait for a poller to ask for the next one.
+    for (uint32_t i = 0; i < options.pollers_per_completion_queue; i++) {
+      server->RequestTest(cq.get());
+      server->RequestSimplifyDebts(cq.get());
+      server->RequestStreamSimplifiedDebts(cq.get());
+      server->RequestSimplifyStreamedDebts(cq.get());
+      server->RequestAddGroupTransactions(cq.get());
+      server->RequestGetGroupBalances(cq.get());
+    }
+    for (uint32_t i = 0; i < options.pollers_per_completion_queue; i++) {
+      server->pollers_.emplace_back(&AsyncServer::Poll, cq.get());
+    }
+  }
+  return server;
+}
+
+AsyncServer::AsyncServer(const AsyncServerOptions& options)
+    : options_(WithComputePool(options, &compute_pool_)),
+      cache_(options.cache_options),
+      ledger_store_(options.ledger_store_options),
+      compute_pool_(options.num_compute_threads) {}
+
+AsyncServer::~AsyncServer() {
+  Shutdown();
+}
+
+int AsyncServer::Port() const {
+  return port_;
+}
+
+void AsyncServer::Wait() {
+  server_->Wait();
+}
+
+void AsyncServer::Shutdown() {
+  if (shut_down_) {
+    return;
+  }
+  shut_down_ = true;
+
+  // Server shutdown waits for the calls in progress, whose responses still go
+  // through the pollers, so the queues are only shut down after it. Calls
+  // still going at the deadline are cancelled, which fails their pending
+  // operations.
+  if (server_ != nullptr) {
+    server_->Shutdown(
+        absl::ToChronoTime(absl::Now() + options_.shutdown_grace_period));
+  }
+  // Cancelled calls still finish on a poller or compute thread after the
+  // server shut down, so the queues wait for every call to be done with them.
+  {
+    absl::MutexLock lock(&calls_mutex_);
+    calls_mutex_.Await(absl::Condition(
+        +[](uint64_t* num_calls) { return *num_calls == 0; }, &num_calls_));
+  }
+  compute_pool_.Wait();
+  for (const auto& cq : cqs_) {
+    cq->Shutdown();
+  }
+  for (std::thread& poller : pollers_) {
+    poller.join();
+  }
+  // Queues must be drained before they are destroyed, which the pollers did
+  // unless the server failed to start.
+  if (pollers_.empty()) {
+    for (const auto& cq : cqs_) {
+      Poll(cq.get());
+    }
+  }
+}
+
+SimplificationCache::Stats AsyncServer::CacheStats() const {
+  return cache_.GetStats();
+}
+
+absl::Status AsyncServer::SaveCache(const std::string& path) const {
+  return cache_.Save(path);
+}
+
+absl::Status AsyncServer::RestoreCache(const std::string& path) {
+  return cache_.Restore(path);
+}
+
+void AsyncServer::RequestTest(grpc::ServerCompletionQueue* cq) {
+  using TestCall = UnaryCall<TestReq, TestRes>;
+  auto* call = new TestCall(this, [this, cq](TestCall* call) {
+    RequestTest(cq);
+    call->response()->set_msg(call->request()->msg());
+    call->Finish(grpc::Status::OK);
+  });
+  service_.RequestTest(call->context(), call->request(), call->responder(), cq,
+                       cq, call);
+}
+
+void AsyncServer::RequestSimplifyDebts(grpc::ServerCompletionQueue* cq) {
+  using SimplifyDebtsCall = UnaryCall<SimplifyDebtsReq, SimplifyDebtsRes>;
+  auto* call = new SimplifyDebtsCall(this, [this, cq](SimplifyDebtsCall* call) {
+    RequestSimplifyDebts(cq);
+    compute_pool_.Schedule([this, call]() {
+      call->Finish(SimplifyDebts(
+          *call->request(), options_.simplifier_options,
+          options_.optimize_options,
+          absl::FromChrono(call->context()->deadline()), &cache_,
+          call->response()));
+    });
+  });
+  service_.RequestSimplifyDebts(call->context(), call->request(),
+                                call->responder(), cq, cq, call);
+}
+
+void AsyncServer::RequestStreamSimplifiedDebts(
+    grpc::ServerCompletionQueue* cq) {
+  using StreamCall = ServerStreamingCall<SimplifyDebtsReq, Transaction>;
+  auto* call = new StreamCall(this, [this, cq](StreamCall* call) {
+    RequestStreamSimplifiedDebts(cq);
+    // The transactions are all kept for the cache anyway, so queueing them
+    // for a slow client costs no more than a copy.
+    compute_pool_.Schedule([this, call]() {
+      const auto write = [call](const Transaction& transaction) {
+        call->Write(transaction);
+      };
+      call->Finish(StreamSimplifiedDebts(
+          *call->request(), options_.simplifier_options,
+          options_.optimize_options,
+          absl::FromChrono(call->context()->deadline()), &cache_, write));
+    });
+  });
+  service_.RequestStreamSimplifiedDebts(call->context(), call->request(),
+                                        call->writer(), cq, cq, call);
+}
+
+void AsyncServer::RequestSimplifyStreamedDebts(
+    grpc::ServerCompletionQueue* cq) {
+  using UploadCall = ClientStreamingCall<DebtList, SimplifyDebtsRes>;
+  // Chunks are cheap to fold compared to the simplification, so they are
+  // added on the polling threads, and only the graph outlives them.
+  auto graph = std::make_shared<DebtGraph>();
+  auto* call = new UploadCall(
+      this, [this, cq]() { RequestSimplifyStreamedDebts(cq); },
+      [graph](const DebtList& chunk) {
+        return AddDebtChunk(chunk, graph.get());
+      },
+      [this, graph](UploadCall* call) {
+        compute_pool_.Schedule([this, graph, call]() {
+          call->Finish(SimplifyDebtGraph(std::move(*graph),
+                                         options_.simplifier_options, &cache_,
+                                         call->response()));
+        });
+      });
+  service_.RequestSimplifyStreamedDebts(call->context(), call->reader(), cq,
+                                        cq, call);
+}
+
+void AsyncServer::RequestAddGroupTransactions(
+    grpc::ServerCompletionQueue* cq) {
+  using AddCall = UnaryCall<AddGroupTransactionsReq, AddGroupTransactionsRes>;
+  auto* call = new AddCall(this, [this, cq](AddCall* call) {
+    RequestAddGroupTransactions(cq);
+    // Adds wait for the group's log to sync, which mustn't hold up a poller.
+    compute_pool_.Schedule([this, call]() {
+      call->Finish(AddGroupTransactions(*call->request(), &ledger_store_,
+                                        call->response()));
+    });
+  });
+  service_.RequestAddGroupTransactions(call->context(), call->request(),
+                                       call->responder(), cq, cq, call);
+}
+
+void AsyncServer::RequestGetGroupBalances(grpc::ServerCompletionQueue* cq) {
+  using BalancesCall = UnaryCall<GetGroupBalancesReq, GetGroupBalancesRes>;
+  auto* call = new BalancesCall(this, [this, cq](BalancesCall* call) {
+    RequestGetGroupBalances(cq);
+    // Balances are looked up rather than computed, so they are answered
+    // right on the polling thread instead of queueing behind
+    // simplifications, unless the group has to be loaded from its log first.
+    if (std::optional<grpc::Status> status = GetLoadedGroupBalances(
+            *call->request(), &ledger_store_, call->response())) {
+      call->Finish(*status);
+      return;
+    }
+    compute_pool_.Schedule([this, call]() {
+      call->Finish(GetGroupBalances(*call->request(), &ledger_store_,
+                                    call->response()));
+    });
+  });
+  service_.RequestGetGroupBalances(call->context(), call->request(),
+                                   call->responder(), cq, cq, call);
+}
+
+// static
+void AsyncServer::Poll(grpc::ServerCompletionQueue* cq) {
+  void* tag;
+  bool ok;
+  while (cq->Next(&tag, &ok)) {
+    static_cast<Call*>(tag)->Proceed(ok);
+  }
+}
+
+}  // namespace debt_simpl
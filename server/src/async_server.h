@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "grpcpp/completion_queue.h"
+#include "grpcpp/server.h"
+
+#include "proto/service.grpc.pb.h"
+#include "server/src/expense_simplifier/expense_simplifier.h"
+#include "server/src/expense_simplifier/simplification_cache.h"
+#include "server/src/expense_simplifier/thread_pool.h"
+#include "server/src/ledger_store/ledger_store.h"
+#include "server/src/service.h"
+
+namespace debt_simpl {
+
+struct AsyncServerOptions {
+  // The number of completion queues calls are spread over, and the number of
+  // threads polling each of them. Pollers only move requests and responses
+  // around, so a handful of them serve many compute threads.
+  uint32_t num_completion_queues = 1;
+  uint32_t pollers_per_completion_queue = 1;
+
+  // The number of threads simplifying ledgers. Simplifications never run on
+  // polling threads, so a long one doesn't hold up other calls' I/O.
+  uint32_t num_compute_threads = 1;
+
+  // Components of a simplification are settled on the compute threads, unless
+  // `thread_pool` is set.
+  ExpenseSimplifierOptions simplifier_options;
+
+  // Bounds how long SimplifyDebts calls may search for fewer transactions.
+  // Searches also stop at the deadline of their call.
+  OptimizeOptions optimize_options;
+
+  // Bounds the cache of results shared by every call.
+  SimplificationCacheOptions cache_options;
+
+  // Where the groups of AddGroupTransactions calls are kept.
+  LedgerStoreOptions ledger_store_options;
+
+  // The largest request and response the server accepts.
+  int max_message_bytes = 512 << 20;
+
+  // How long `Shutdown()` waits for the calls in progress to finish before
+  // cancelling them, so that a stalled client can't hold it up.
+  absl::Duration shutdown_grace_period = absl::Seconds(10);
+};
+
+// Serves the DebtSimplifier service on completion queues, handing
+// simplifications off to a separate compute pool.
+class AsyncServer {
+ public:
+  static absl::StatusOr<std::unique_ptr<AsyncServer>> Start(
+      const std::string& address, const AsyncServerOptions& options);
+
+  // Shuts the server down if `Shutdown()` wasn't called.
+  ~AsyncServer();
+
+  AsyncServer(const AsyncServer&) = delete;
+  AsyncServer& operator=(const AsyncServer&) = delete;
+
+  // Returns the port the server listens on, which is picked by the system if
+  // the address given to `Start()` has port 0.
+  int Port() const;
+
+  // Blocks until the server shuts down.
+  void Wait();
+
+  // Stops accepting calls, waits up to `shutdown_grace_period` for the calls
+  // in progress to finish and cancels the rest, then stops the pollers.
+  void Shutdown();
+
+  SimplificationCache::Stats CacheStats() const;
+
+  // Saves the cached results to a snapshot at `path`, from which a restarted
+  // server can pick them up with `RestoreCache()` rather than starting cold.
+  absl::Status SaveCache(const std::string& path) const;
+
+  // Restores the results saved to the snapshot at `path`. They are read
+  // lazily, as calls look them up.
+  absl::Status RestoreCache(const std::string& path);
+
+ private:
+  // A call in progress, which is the tag of its operations on the completion
+  // queue.
+  class Call;
+  template <typename Request, typename Response>
+  class UnaryCall;
+  template <typename Request, typename Response>
+  class ServerStreamingCall;
+  template <typename Request, typename Response>
+  class ClientStreamingCall;
+
+  explicit AsyncServer(const AsyncServerOptions& options);
+
+  // Asks for the next call of each method on `cq`.
+  void RequestTest(grpc::ServerCompletionQueue* cq);
+  void RequestSimplifyDebts(grpc::ServerCompletionQueue* cq);
+  void RequestStreamSimplifiedDebts(grpc::ServerCompletionQueue* cq);
+  void RequestSimplifyStreamedDebts(grpc::ServerCompletionQueue* cq);
+  void RequestAddGroupTransactions(grpc::ServerCompletionQueue* cq);
+  void RequestGetGroupBalances(grpc::ServerCompletionQueue* cq);
+
+  // Advances the calls of `cq` as their operations complete, until the queue
+  // is shut down and drained.
+  static void Poll(grpc::ServerCompletionQueue* cq);
+
+  const AsyncServerOptions options_;
+  SimplificationCache cache_;
+  LedgerStore ledger_store_;
+
+  DebtSimplifier::AsyncService service_;
+  std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> cqs_;
+  std::unique_ptr<grpc::Server> server_;
+  int port_ = 0;
+
+  // The number of calls created and not yet deleted, including the ones
+  // waiting for a client to make them.
+  absl::Mutex calls_mutex_;
+  uint64_t num_calls_ ABSL_GUARDED_BY(calls_mutex_) = 0;
+
+  ThreadPool compute_pool_;
+  std::vector<std::thread> pollers_;
+  bool shut_down_ = false;
+};
+
+}  // namespace debt_simpl
@@ -0,0 +1,243 @@
+#include "server/src/async_server.h"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+#include "grpcpp/client_context.h"
+#include "grpcpp/create_channel.h"
+#include "grpcpp/security/credentials.h"
+#include "grpcpp/support/status.h"
+#include "grpcpp/support/sync_stream.h"
+#include "gtest/gtest.h"
+
+#include "proto/debts.pb.h"
+#include "proto/service.grpc.pb.h"
+#include "proto/service.pb.h"
+#include "server/src/expense_simplifier/debt_list_testing.h"
+#include "server/src/expense_simplifier/utils.h"
+
+namespace debt_simpl {
+
+class TestAsyncServer : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_OK_AND_ASSIGN(
+        server_,
+        AsyncServer::Start(
+            "localhost:0",
+            { .num_completion_queues = 2,
+              .num_compute_threads = 2,
+              .shutdown_grace_period = absl::Milliseconds(100) }));
+    stub_ = DebtSimplifier::NewStub(
+        grpc::CreateChannel(absl::StrCat("localhost:", server_->Port()),
+                            grpc::InsecureChannelCredentials()));
+  }
+
+  void TearDown() override {
+    if (server_ != nullptr) {
+      server_->Shutdown();
+    }
+  }
+
+  // Returns `n` debts between distinct pairs of users, which no mode
+  // simplifies away.
+  static DebtList UnrelatedDebts(int n) {
+    std::vector<std::tuple<std::string, std::string, Cents>> debts;
+    for (int i = 0; i < n; i++) {
+      debts.emplace_back(absl::StrCat("lender", i),
+                         absl::StrCat("receiver", i), i + 1);
+    }
+    return DebtListOf(debts);
+  }
+
+  std::unique_ptr<AsyncServer> server_;
+  std::unique_ptr<DebtSimplifier::Stub> stub_;
+};
+
+TEST_F(TestAsyncServer, UnaryCalls) {
+  grpc::ClientContext test_context;
+  TestReq test_req;
+  test_req.set_msg("hello");
+  TestRes test_res;
+  ASSERT_TRUE(stub_->Test(&test_context, test_req, &test_res).ok());
+  EXPECT_EQ(test_res.msg(), "hello");
+
+  grpc::ClientContext simplify_context;
+  SimplifyDebtsReq simplify_req;
+  *simplify_req.mutable_debts() =
+      DebtListOf({ { "alice", "bob", 500 }, { "bob", "carol", 500 } });
+  simplify_req.set_mode(SimplifyDebtsReq::NET_BALANCES);
+  SimplifyDebtsRes simplify_res;
+  ASSERT_TRUE(
+      stub_->SimplifyDebts(&simplify_context, simplify_req, &simplify_res)
+          .ok());
+  ASSERT_EQ(simplify_res.transactions().transactions_size(), 1);
+  const Transaction& transaction = simplify_res.transactions().transactions(0);
+  EXPECT_EQ(transaction.lender(), "alice");
+  EXPECT_EQ(transaction.receiver(), "carol");
+  EXPECT_EQ(transaction.cents(), 500);
+}
+
+TEST_F(TestAsyncServer, StreamingCalls) {
+  const DebtList debts = DebtListOf({ { "alice", "bob", 500 },
+                                      { "bob", "carol", 300 },
+                                      { "carol", "dave", 100 } });
+
+  grpc::ClientContext stream_context;
+  SimplifyDebtsReq stream_req;
+  *stream_req.mutable_debts() = debts;
+  std::unique_ptr<grpc::ClientReader<Transaction>> reader =
+      stub_->StreamSimplifiedDebts(&stream_context, stream_req);
+  Transaction transaction;
+  int num_streamed = 0;
+  while (reader->Read(&transaction)) {
+    num_streamed++;
+  }
+  ASSERT_TRUE(reader->Finish().ok());
+
+  grpc::ClientContext upload_context;
+  SimplifyDebtsRes upload_res;
+  std::unique_ptr<grpc::ClientWriter<DebtList>> writer =
+      stub_->SimplifyStreamedDebts(&upload_context, &upload_res);
+  for (const Transaction& debt : debts.transactions()) {
+    DebtList chunk;
+    *chunk.add_transactions() = debt;
+    ASSERT_TRUE(writer->Write(chunk));
+  }
+  ASSERT_TRUE(writer->WritesDone());
+  ASSERT_TRUE(writer->Finish().ok());
+
+  EXPECT_EQ(upload_res.transactions().transactions_size(), num_streamed);
+  EXPECT_EQ(server_->CacheStats().hits, 1);
+}
+
+TEST_F(TestAsyncServer, LongStreams) {
+  grpc::ClientContext context;
+  SimplifyDebtsReq req;
+  *req.mutable_debts() = UnrelatedDebts(100);
+  req.set_mode(SimplifyDebtsReq::NET_BALANCES);
+  std::unique_ptr<grpc::ClientReader<Transaction>> reader =
+      stub_->StreamSimplifiedDebts(&context, req);
+  Transaction transaction;
+  int num_streamed = 0;
+  while (reader->Read(&transaction)) {
+    num_streamed++;
+  }
+  ASSERT_TRUE(reader->Finish().ok());
+  EXPECT_EQ(num_streamed, 100);
+}
+
+TEST_F(TestAsyncServer, CancelledStreams) {
+  grpc::ClientContext context;
+  SimplifyDebtsReq req;
+  *req.mutable_debts() = UnrelatedDebts(100);
+  req.set_mode(SimplifyDebtsReq::NET_BALANCES);
+  std::unique_ptr<grpc::ClientReader<Transaction>> reader =
+      stub_->StreamSimplifiedDebts(&context, req);
+  Transaction transaction;
+  ASSERT_TRUE(reader->Read(&transaction));
+
+  context.TryCancel();
+  EXPECT_EQ(reader->Finish().error_code(), grpc::StatusCode::CANCELLED);
+}
+
+TEST_F(TestAsyncServer, StalledStreamsDontHoldComputeThreads) {
+  // More than fits in the flow control windows, on as many streams as there
+  // are compute threads.
+  const std::string padding(1000, 'x');
+  std::vector<std::tuple<std::string, std::string, Cents>> debts;
+  for (int i = 0; i < 20000; i++) {
+    debts.emplace_back(absl::StrCat(padding, "lender", i),
+                       absl::StrCat(padding, "receiver", i), i + 1);
+  }
+  SimplifyDebtsReq stream_req;
+  *stream_req.mutable_debts() = DebtListOf(debts);
+  stream_req.set_mode(SimplifyDebtsReq::NET_BALANCES);
+  grpc::ClientContext stream_contexts[2];
+  std::vector<std::unique_ptr<grpc::ClientReader<Transaction>>> readers;
+  for (grpc::ClientContext& context : stream_contexts) {
+    readers.push_back(stub_->StreamSimplifiedDebts(&context, stream_req));
+    Transaction transaction;
+    ASSERT_TRUE(readers.back()->Read(&transaction));
+  }
+
+  // Neither stream is read any further, yet other calls still get simplified.
+  grpc::ClientContext context;
+  context.set_deadline(std::chrono::system_clock::now() +
+                       std::chrono::seconds(10));
+  SimplifyDebtsReq req;
+  *req.mutable_debts() = UnrelatedDebts(10);
+  SimplifyDebtsRes res;
+  EXPECT_TRUE(stub_->SimplifyDebts(&context, req, &res).ok());
+
+  for (uint32_t i = 0; i < readers.size(); i++) {
+    stream_contexts[i].TryCancel();
+    EXPECT_EQ(readers[i]->Finish().error_code(), grpc::StatusCode::CANCELLED);
+  }
+}
+
+TEST_F(TestAsyncServer, GroupCalls) {
+  grpc::ClientContext add_context;
+  AddGroupTransactionsReq add_req;
+  add_req.set_group_id("trip");
+  *add_req.mutable_transactions() = DebtListOf({ { "alice", "bob", 500 } });
+  AddGroupTransactionsRes add_res;
+  ASSERT_TRUE(
+      stub_->AddGroupTransactions(&add_context, add_req, &add_res).ok());
+
+  grpc::ClientContext balances_context;
+  GetGroupBalancesReq balances_req;
+  balances_req.set_group_id("trip");
+  balances_req.add_users("bob");
+  GetGroupBalancesRes balances_res;
+  ASSERT_TRUE(stub_
+                  ->GetGroupBalances(&balances_context, balances_req,
+                                     &balances_res)
+                  .ok());
+  ASSERT_EQ(balances_res.balances_size(), 1);
+  EXPECT_EQ(balances_res.balances(0).total_debt(), 500);
+
+  grpc::ClientContext missing_context;
+  balances_req.set_group_id("missing");
+  EXPECT_EQ(stub_
+                ->GetGroupBalances(&missing_context, balances_req,
+                                   &balances_res)
+                .error_code(),
+            grpc::StatusCode::NOT_FOUND);
+}
+
+TEST_F(TestAsyncServer, ShutdownCancelsStalledCalls) {
+  // Opened but never closed, so the server cuts it off to shut down.
+  grpc::ClientContext upload_context;
+  SimplifyDebtsRes upload_res;
+  std::unique_ptr<grpc::ClientWriter<DebtList>> writer =
+      stub_->SimplifyStreamedDebts(&upload_context, &upload_res);
+  ASSERT_TRUE(writer->Write(DebtListOf({ { "alice", "bob", 500 } })));
+
+  server_->Shutdown();
+  EXPECT_FALSE(writer->Finish().ok());
+  // What was uploaded before the cutoff isn't the whole ledger.
+  EXPECT_EQ(server_->CacheStats().entries, 0);
+}
+
+TEST_F(TestAsyncServer, CancelledUploads) {
+  grpc::ClientContext upload_context;
+  SimplifyDebtsRes upload_res;
+  std::unique_ptr<grpc::ClientWriter<DebtList>> writer =
+      stub_->SimplifyStreamedDebts(&upload_context, &upload_res);
+  ASSERT_TRUE(writer->Write(DebtListOf({ { "alice", "bob", 500 } })));
+  upload_context.TryCancel();
+  EXPECT_EQ(writer->Finish().error_code(), grpc::StatusCode::CANCELLED);
+
+  // Shutting down waits for the server to be done with the upload.
+  server_->Shutdown();
+  EXPECT_EQ(server_->CacheStats().entries, 0);
+}
+
+}  // namespace debt_simpl
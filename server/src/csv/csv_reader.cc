@@ -0,0 +1,268 @@
+#include "server/src/csv/csv_reader.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+
+namespace debt_simpl {
+
+namespace {
+
+bool IsDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+// Bytes covered by one `FieldDelimiterMask()`.
+constexpr uint64_t kBlockSize = 64;
+
+bool IsFieldDelimiter(char c) {
+  return c == ',' || c == '\n' || c == '\r';
+}
+
+uint64_t FieldDelimiterMaskScalar(const char* data, uint64_t size) {
+  uint64_t mask = 0;
+  for (uint64_t i = 0; i < size && i < kBlockSize; i++) {
+    mask |= static_cast<uint64_t>(IsFieldDelimiter(data[i])) << i;
+  }
+  return mask;
+}
+
+#if defined(__x86_64__)
+
+// SSE2 is part of x86-64, so this is always available there.
+uint64_t BlockDelimiterMaskSse2(const char* data) {
+  const __m128i comma = _mm_set1_epi8(',');
+  const __m128i newline = _mm_set1_epi8('\n');
+  const __m128i carriage_return = _mm_set1_epi8('\r');
+
+  uint64_t mask = 0;
+  for (uint64_t i = 0; i < kBlockSize; i += 16) {
+    const __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    const __m128i matches =
+        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, comma),
+                                  _mm_cmpeq_epi8(chunk, newline)),
+                     _mm_cmpeq_epi8(chunk, carriage_return));
+    mask |= static_cast<uint64_t>(
+                static_cast<uint16_t>(_mm_movemask_epi8(matches)))
+            << i;
+  }
+  return mask;
+}
+
+// Compiled for AVX2 regardless of the build flags, and only called once the
+// CPU is known to support it.
+__attribute__((target("avx2"))) uint64_t BlockDelimiterMaskAvx2(
+    const char* data) {
+  const __m256i comma = _mm256_set1_epi8(',');
+  const __m256i newline = _mm256_set1_epi8('\n');
+  const __m256i carriage_return = _mm256_set1_epi8('\r');
+
+  uint64_t mask = 0;
+  for (uint64_t i = 0; i < kBlockSize; i += 32) {
+    const __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+    const __m256i matches =
+        _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, comma),
+                                        _mm256_cmpeq_epi8(chunk, newline)),
+                        _mm256_cmpeq_epi8(chunk, carriage_return));
+    mask |= static_cast<uint64_t>(
+                static_cast<uint32_t>(_mm256_movemask_epi8(matches)))
+            << i;
+  }
+  return mask;
+}
+
+#endif  // defined(__x86_64__)
+
+}  // namespace
+
+CsvReader::CsvReader(absl::string_view contents) : contents_(contents) {}
+
+bool CsvReader::NextRow(std::vector<absl::string_view>* fields) {
+  fields->clear();
+  num_unescaped_fields_ = 0;
+  if (pos_ >= contents_.size()) {
+    return false;
+  }
+  row_index_++;
+
+  while (true) {
+    if (contents_[pos_] == '"') {
+      fields->push_back(ReadQuotedField());
+      // Anything between the closing quote and the delimiter is malformed and
+      // dropped.
+      pos_ = FindFieldEnd(pos_);
+    } else {
+      const uint64_t end = FindFieldEnd(pos_);
+      fields->push_back(contents_.substr(pos_, end - pos_));
+      pos_ = end;
+    }
+
+    if (pos_ >= contents_.size()) {
+      return true;
+    }
+    if (contents_[pos_] == ',') {
+      pos_++;
+      if (pos_ == contents_.size()) {
+        // A trailing delimiter ends with an empty field.
+        fields->push_back(absl::string_view());
+        return true;
+      }
+      continue;
+    }
+    if (contents_[pos_] == '\r') {
+      pos_++;
+    }
+    if (pos_ < contents_.size() && contents_[pos_] == '\n') {
+      pos_++;
+    }
+    return true;
+  }
+}
+
+uint64_t CsvReader::RowIndex() const {
+  return row_index_;
+}
+
+absl::string_view CsvReader::ReadQuotedField() {
+  const uint64_t begin = ++pos_;
+  std::string* unescaped = nullptr;
+  uint64_t chunk_begin = begin;
+  uint64_t end;
+  while (true) {
+    const uint64_t quote = contents_.find('"', pos_);
+    if (quote == absl::string_view::npos) {
+      // An unterminated quote runs to the end of the text.
+      end = contents_.size();
+      pos_ = end;
+      break;
+    }
+    if (quote + 1 < contents_.size() && contents_[quote + 1] == '"') {
+      // An escaped quote. Copy everything up to and including the first of
+      // the pair, and continue after the second.
+      if (unescaped == nullptr) {
+        if (num_unescaped_fields_ == unescaped_fields_.size()) {
+          unescaped_fields_.emplace_back();
+        }
+        unescaped = &unescaped_fields_[num_unescaped_fields_++];
+        unescaped->clear();
+      }
+      unescaped->append(contents_.data() + chunk_begin,
+                        quote + 1 - chunk_begin);
+      pos_ = quote + 2;
+      chunk_begin = pos_;
+      continue;
+    }
+    end = quote;
+    pos_ = quote + 1;
+    break;
+  }
+
+  if (unescaped == nullptr) {
+    return contents_.substr(begin, end - begin);
+  }
+  unescaped->append(contents_.data() + chunk_begin, end - chunk_begin);
+  return *unescaped;
+}
+
+uint64_t CsvReader::FindFieldEnd(uint64_t pos) {
+  while (pos < contents_.size()) {
+    const uint64_t block = pos & ~uint64_t{ kBlockSize - 1 };
+    if (block != mask_block_) {
+      mask_block_ = block;
+      mask_ = FieldDelimiterMask(contents_, block);
+    }
+    const uint64_t remaining = mask_ >> (pos - block);
+    if (remaining != 0) {
+      return pos + __builtin_ctzll(remaining);
+    }
+    pos = block + kBlockSize;
+  }
+  return contents_.size();
+}
+
+uint64_t FieldDelimiterMask(absl::string_view text, uint64_t offset) {
+  if (offset + kBlockSize > text.size()) {
+    return FieldDelimiterMaskScalar(text.data() + offset,
+                                    text.size() - offset);
+  }
+#if defined(__x86_64__)
+  using BlockDelimiterMask = uint64_t (*)(const char* data);
+  static const BlockDelimiterMask block_mask =
+      __builtin_cpu_supports("avx2")
+          ? static_cast<BlockDelimiterMask>(&BlockDelimiterMaskAvx2)
+          : &BlockDelimiterMaskSse2;
+  return block_mask(text.data() + offset);
+#else
+  return FieldDelimiterMaskScalar(text.data() + offset, kBlockSize);
+#endif
+}
+
+absl::StatusOr<int64_t> ParseCents(absl::string_view amount) {
+  const absl::string_view original_amount = amount;
+  const auto invalid = [original_amount]() {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Invalid amount \"%s\"", original_amount));
+  };
+
+  amount = absl::StripAsciiWhitespace(amount);
+  bool negative = false;
+  if (!amount.empty() && (amount[0] == '-' || amount[0] == '+')) {
+    negative = amount[0] == '-';
+    amount.remove_prefix(1);
+  }
+
+  // Largest whole amount whose cents still fit, with room for rounding up.
+  constexpr int64_t kMaxUnits = (INT64_MAX - 100) / 100;
+  int64_t units = 0;
+  uint64_t num_digits = 0;
+  uint64_t i = 0;
+  for (; i < amount.size() && IsDigit(amount[i]); i++) {
+    units = units * 10 + (amount[i] - '0');
+    if (units > kMaxUnits) {
+      return absl::OutOfRangeError(
+          absl::StrFormat("Amount \"%s\" out of range", original_amount));
+    }
+    num_digits++;
+  }
+
+  int64_t cents = 0;
+  if (i < amount.size() && amount[i] == '.') {
+    i++;
+    uint64_t num_fraction_digits = 0;
+    for (; i < amount.size() && IsDigit(amount[i]); i++) {
+      const int64_t digit = amount[i] - '0';
+      if (num_fraction_digits < 2) {
+        cents = cents * 10 + digit;
+      } else if (num_fraction_digits == 2 && digit >= 5) {
+        // At least half a cent remains, whatever digits follow.
+        cents++;
+      }
+      num_fraction_digits++;
+    }
+    if (num_fraction_digits == 1) {
+      cents *= 10;
+    }
+    num_digits += num_fraction_digits;
+  }
+
+  if (num_digits == 0 || i != amount.size()) {
+    return invalid();
+  }
+
+  const int64_t total = units * 100 + cents;
+  return negative ? -total : total;
+}
+
+}  // namespace debt_simpl
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+
+namespace debt_simpl {
+
+// Splits CSV text into rows of fields without copying it.
+//
+// Fields are returned as views into the text, except for quoted fields
+// containing escaped quotes (""), which are unescaped into a buffer owned by
+// the reader. Those views stay valid until the next call to `NextRow()`.
+class CsvReader {
+ public:
+  explicit CsvReader(absl::string_view contents);
+
+  // Reads the next row into `fields`, returning false once there are no rows
+  // left. Both "\n" and "\r\n" end a row.
+  bool NextRow(std::vector<absl::string_view>* fields);
+
+  // Returns the 0-based index of the row last returned by `NextRow()`.
+  uint64_t RowIndex() const;
+
+ private:
+  // Reads a quoted field starting at the opening quote at `pos_`, leaving
+  // `pos_` just past the closing quote.
+  absl::string_view ReadQuotedField();
+
+  // Returns the position of the first field or row delimiter at or after
+  // `pos`, or the end of the text if there is none.
+  uint64_t FindFieldEnd(uint64_t pos);
+
+  absl::string_view contents_;
+  uint64_t pos_ = 0;
+  uint64_t row_index_ = UINT64_MAX;
+
+  // Unescaped quoted fields of the current row. A deque never relocates its
+  // elements, so adding a field doesn't invalidate views of the others.
+  std::deque<std::string> unescaped_fields_;
+  uint64_t num_unescaped_fields_ = 0;
+
+  // `FieldDelimiterMask()` of the 64-byte block starting at `mask_block_`.
+  // Fields are usually much shorter than a block, so one mask serves many of
+  // them.
+  uint64_t mask_block_ = UINT64_MAX;
+  uint64_t mask_ = 0;
+};
+
+// Returns a mask whose bit `i` is set if `text[offset + i]` is a field or row
+// delimiter (',', '\n' or '\r'), for the up to 64 bytes starting at `offset`.
+// Full blocks are compared 32 or 16 bytes at a time with AVX2 or SSE2,
+// whichever the CPU supports.
+uint64_t FieldDelimiterMask(absl::string_view text, uint64_t offset);
+
+// Parses a decimal amount of money such as "-12.5" or "3.07" into an exact
+// number of cents, without going through floating point. Digits past the
+// cents are rounded half away from zero.
+absl::StatusOr<int64_t> ParseCents(absl::string_view amount);
+
+}  // namespace debt_simpl
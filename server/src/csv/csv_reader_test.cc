@@ -0,0 +1,131 @@
+#include "server/src/csv/csv_reader.h"
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "server/src/expense_simplifier/utils.h"
+
+namespace debt_simpl {
+
+using ::testing::ElementsAre;
+using ::testing::Not;
+
+class TestCsvReader : public ::testing::Test {
+ protected:
+  // Returns all rows of `contents`.
+  static std::vector<std::vector<std::string>> ReadAll(
+      absl::string_view contents) {
+    CsvReader reader(contents);
+    std::vector<std::vector<std::string>> rows;
+    std::vector<absl::string_view> fields;
+    while (reader.NextRow(&fields)) {
+      rows.emplace_back(fields.begin(), fields.end());
+    }
+    return rows;
+  }
+};
+
+TEST_F(TestCsvReader, Empty) {
+  EXPECT_TRUE(ReadAll("").empty());
+}
+
+TEST_F(TestCsvReader, SimpleRows) {
+  EXPECT_THAT(ReadAll("a,b,c\n1,2,3\n"),
+              ElementsAre(ElementsAre("a", "b", "c"),
+                          ElementsAre("1", "2", "3")));
+}
+
+TEST_F(TestCsvReader, MissingFinalNewline) {
+  EXPECT_THAT(ReadAll("a,b\n1,2"),
+              ElementsAre(ElementsAre("a", "b"), ElementsAre("1", "2")));
+}
+
+TEST_F(TestCsvReader, CarriageReturns) {
+  EXPECT_THAT(ReadAll("a,b\r\n1,2\r\n"),
+              ElementsAre(ElementsAre("a", "b"), ElementsAre("1", "2")));
+}
+
+TEST_F(TestCsvReader, EmptyFields) {
+  EXPECT_THAT(ReadAll(",a,,\n\n"),
+              ElementsAre(ElementsAre("", "a", "", ""), ElementsAre("")));
+}
+
+TEST_F(TestCsvReader, QuotedFields) {
+  EXPECT_THAT(ReadAll("\"a,b\",\"say \"\"hi\"\"\",\"\"\n\"x\ny\",z\n"),
+              ElementsAre(ElementsAre("a,b", "say \"hi\"", ""),
+                          ElementsAre("x\ny", "z")));
+}
+
+TEST_F(TestCsvReader, UnescapedFieldsStayValid) {
+  CsvReader reader("\"\"\"a\"\"\",\"b\"\"\",\"\"\"c\"\n");
+  std::vector<absl::string_view> fields;
+  ASSERT_TRUE(reader.NextRow(&fields));
+
+  EXPECT_THAT(fields, ElementsAre("\"a\"", "b\"", "\"c"));
+  EXPECT_EQ(reader.RowIndex(), 0);
+  EXPECT_FALSE(reader.NextRow(&fields));
+}
+
+TEST_F(TestCsvReader, FieldDelimiterMask) {
+  std::mt19937 rng(0);
+  const absl::string_view alphabet = "ab,\n\r\"0.";
+  std::string text(1000, ' ');
+  for (char& c : text) {
+    c = alphabet[rng() % alphabet.size()];
+  }
+
+  for (uint64_t offset = 0; offset < text.size(); offset++) {
+    uint64_t expected = 0;
+    for (uint64_t i = 0; i < 64 && offset + i < text.size(); i++) {
+      const char c = text[offset + i];
+      if (c == ',' || c == '\n' || c == '\r') {
+        expected |= uint64_t{ 1 } << i;
+      }
+    }
+    EXPECT_EQ(FieldDelimiterMask(text, offset), expected) << offset;
+  }
+}
+
+TEST_F(TestCsvReader, FieldsSpanningBlocks) {
+  const std::string long_field(150, 'x');
+  const std::string contents =
+      "a," + long_field + ",b\n" + long_field + "\n,,\n";
+
+  EXPECT_THAT(ReadAll(contents),
+              ElementsAre(ElementsAre("a", long_field, "b"),
+                          ElementsAre(long_field), ElementsAre("", "", "")));
+}
+
+TEST_F(TestCsvReader, ParseCents) {
+  EXPECT_THAT(ParseCents("12.50"), IsOkAndHolds(1250));
+  EXPECT_THAT(ParseCents("-3.07"), IsOkAndHolds(-307));
+  EXPECT_THAT(ParseCents("+7"), IsOkAndHolds(700));
+  EXPECT_THAT(ParseCents("0.1"), IsOkAndHolds(10));
+  EXPECT_THAT(ParseCents(".25"), IsOkAndHolds(25));
+  EXPECT_THAT(ParseCents(" 4.00 "), IsOkAndHolds(400));
+  // Values that aren't exactly representable as doubles stay exact.
+  EXPECT_THAT(ParseCents("1234567890123.29"), IsOkAndHolds(123456789012329));
+}
+
+TEST_F(TestCsvReader, ParseCentsRoundsHalfAwayFromZero) {
+  EXPECT_THAT(ParseCents("0.125"), IsOkAndHolds(13));
+  EXPECT_THAT(ParseCents("0.1249999"), IsOkAndHolds(12));
+  EXPECT_THAT(ParseCents("-0.995"), IsOkAndHolds(-100));
+}
+
+TEST_F(TestCsvReader, ParseCentsInvalid) {
+  EXPECT_THAT(ParseCents(""), Not(IsOk()));
+  EXPECT_THAT(ParseCents("-"), Not(IsOk()));
+  EXPECT_THAT(ParseCents("."), Not(IsOk()));
+  EXPECT_THAT(ParseCents("1.2.3"), Not(IsOk()));
+  EXPECT_THAT(ParseCents("12a"), Not(IsOk()));
+  EXPECT_THAT(ParseCents("99999999999999999999"), Not(IsOk()));
+}
+
+}  // namespace debt_simpl
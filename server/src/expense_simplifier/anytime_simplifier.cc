@@ -0,0 +1,201 @@
+#include "server/src/expense_simplifier/anytime_simplifier.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+#include "proto/debts.pb.h"
+#include "server/src/expense_simplifier/debt_graph.h"
+#include "server/src/expense_simplifier/expense_simplifier.h"
+
+namespace debt_simpl {
+
+namespace {
+
+// How many search nodes are visited between deadline checks.
+constexpr uint64_t kNodesPerDeadlineCheck = 1024;
+
+}  // namespace
+
+AnytimeSimplifier::AnytimeSimplifier(DebtGraph&& graph,
+                                     const ExpenseSimplifierOptions& options) {
+  ExpenseSimplifier simplifier(std::move(graph), options);
+  users_ = simplifier.MinimalTransactions();
+
+  auto initial = std::make_shared<const DebtList>(users_.AllDebts());
+  best_size_ = static_cast<uint32_t>(initial->transactions_size());
+  best_ = std::move(initial);
+
+  std::vector<std::pair<Cents, uint64_t>> balances;
+  for (uint64_t id = 0; id < users_.NumUsers(); id++) {
+    const Cents total_debt = users_.DebtGraphInternal::TotalDebt(id);
+    if (total_debt != 0) {
+      balances.emplace_back(total_debt, id);
+    }
+  }
+  // Settling the largest balances first makes the first results the search
+  // finds about as good as matching the largest balances greedily.
+  std::sort(balances.begin(), balances.end(),
+            [](const auto& a, const auto& b) {
+              return std::abs(a.first) > std::abs(b.first);
+            });
+  for (const auto& [balance, id] : balances) {
+    balances_.push_back(balance);
+    ids_.push_back(id);
+  }
+  num_nonzero_balances_ = static_cast<uint32_t>(balances_.size());
+}
+
+bool AnytimeSimplifier::Improve(absl::Time deadline) {
+  if (IsOptimal()) {
+    return true;
+  }
+  deadline_ = deadline;
+  nodes_until_deadline_check_ = 0;
+  if (!Search(0)) {
+    return false;
+  }
+  // Every settlement that could have beaten the best known result was ruled
+  // out.
+  absl::MutexLock lock(&mutex_);
+  optimal_ = true;
+  return true;
+}
+
+std::shared_ptr<const DebtList> AnytimeSimplifier::BestTransactions() const {
+  absl::MutexLock lock(&mutex_);
+  return best_;
+}
+
+bool AnytimeSimplifier::IsOptimal() const {
+  absl::MutexLock lock(&mutex_);
+  return optimal_;
+}
+
+uint32_t AnytimeSimplifier::NumBalances() const {
+  return static_cast<uint32_t>(balances_.size());
+}
+
+bool AnytimeSimplifier::Search(uint32_t first) {
+  if (nodes_until_deadline_check_-- == 0) {
+    nodes_until_deadline_check_ = kNodesPerDeadlineCheck;
+    if (absl::Now() > deadline_) {
+      return false;
+    }
+  }
+
+  const uint32_t n = static_cast<uint32_t>(balances_.size());
+  while (first < n && balances_[first] == 0) {
+    first++;
+  }
+  if (first == n) {
+    if (transfers_.size() < best_size_) {
+      PublishTransfers();
+    }
+    return true;
+  }
+  // The bound takes a pass over the balances left, so it is only computed
+  // once the most it can be, with no pairs of opposite balances left, would
+  // prune the branch.
+  const uint32_t num_left = num_nonzero_balances_;
+  if (transfers_.size() + num_left - num_left / 3 >= best_size_ &&
+      transfers_.size() + TransfersLeftLowerBound(first) >= best_size_) {
+    return true;
+  }
+
+  // Settles `balances_[first]` with a transfer to or from `other`, searches
+  // the rest, then undoes the transfer.
+  const Cents balance = balances_[first];
+  const auto settle_with = [&](uint32_t other) {
+    transfers_.push_back(balance > 0 ? Transfer{ first, other, balance }
+                                     : Transfer{ other, first, -balance });
+    balances_[other] += balance;
+    balances_[first] = 0;
+    const uint32_t num_settled = balances_[other] == 0 ? 2 : 1;
+    num_nonzero_balances_ -= num_settled;
+    const bool finished = Search(first + 1);
+    num_nonzero_balances_ += num_settled;
+    balances_[first] = balance;
+    balances_[other] -= balance;
+    transfers_.pop_back();
+    return finished;
+  };
+
+  // Some optimal settlement pays off opposite balances with each other, so
+  // there is no need to look any further if there is one.
+  for (uint32_t other = first + 1; other < n; other++) {
+    if (balances_[other] == -balance) {
+      return settle_with(other);
+    }
+  }
+
+  // Users with the same balance lead to the same settlements, so only the
+  // first of them is tried.
+  std::vector<Cents> tried;
+  for (uint32_t other = first + 1; other < n; other++) {
+    const Cents other_balance = balances_[other];
+    if ((other_balance > 0) == (balance > 0) || other_balance == 0 ||
+        std::find(tried.begin(), tried.end(), other_balance) != tried.end()) {
+      continue;
+    }
+    tried.push_back(other_balance);
+    if (!settle_with(other)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint32_t AnytimeSimplifier::TransfersLeftLowerBound(uint32_t first) {
+  // Settling r balances takes r minus the number of zero-sum groups they are
+  // split into, and only pairs of opposite balances make groups smaller than
+  // 3.
+  positive_counts_.clear();
+  uint32_t num_balances = 0;
+  for (uint32_t i = first; i < balances_.size(); i++) {
+    if (balances_[i] > 0) {
+      positive_counts_[balances_[i]]++;
+      num_balances++;
+    }
+  }
+  uint32_t num_pairs = 0;
+  for (uint32_t i = first; i < balances_.size(); i++) {
+    if (balances_[i] >= 0) {
+      continue;
+    }
+    num_balances++;
+    const auto it = positive_counts_.find(-balances_[i]);
+    if (it != positive_counts_.end() && it->second > 0) {
+      it->second--;
+      num_pairs++;
+    }
+  }
+  const uint32_t max_groups = num_pairs + (num_balances - 2 * num_pairs) / 3;
+  return num_balances - max_groups;
+}
+
+void AnytimeSimplifier::PublishTransfers() {
+  auto best = std::make_shared<DebtList>();
+  best->mutable_transactions()->Reserve(static_cast<int>(transfers_.size()));
+  for (const Transfer& transfer : transfers_) {
+    const absl::string_view lender = users_.UserName(ids_[transfer.creditor]);
+    const absl::string_view receiver = users_.UserName(ids_[transfer.debtor]);
+    Transaction& transaction = *best->add_transactions();
+    transaction.set_lender(lender.data(), lender.size());
+    transaction.set_receiver(receiver.data(), receiver.size());
+    transaction.set_cents(transfer.cents);
+  }
+  best_size_ = static_cast<uint32_t>(transfers_.size());
+
+  absl::MutexLock lock(&mutex_);
+  best_ = std::move(best);
+}
+
+}  // namespace debt_simpl
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+#include "proto/debts.pb.h"
+#include "server/src/expense_simplifier/debt_graph.h"
+#include "server/src/expense_simplifier/expense_simplifier.h"
+
+namespace debt_simpl {
+
+// Searches for fewer transactions than an ExpenseSimplifier found, for as
+// long as the caller can wait, with the best found so far available at any
+// point.
+//
+// The search settles net balances directly, so anyone may end up paying
+// anyone. It is a branch-and-bound over the ways to settle each balance in
+// one transfer to a user of the opposite sign, which covers an optimal
+// settlement. Branches are pruned when the transfers so far plus a lower bound
+// on the ones left, taken from the remaining balances, can't beat the best.
+class AnytimeSimplifier {
+ public:
+  // Simplifies `graph` with `options`, which is the best known result until
+  // the search finds a better one.
+  explicit AnytimeSimplifier(DebtGraph&& graph,
+                             const ExpenseSimplifierOptions& options = {});
+
+  AnytimeSimplifier(const AnytimeSimplifier&) = delete;
+  AnytimeSimplifier& operator=(const AnytimeSimplifier&) = delete;
+
+  // Searches until `deadline`, or until the best known result is proven to
+  // have the fewest transactions possible, and returns whether it is. Calls
+  // must not overlap. Each starts the search over, though it only looks for
+  // results better than the best known one.
+  bool Improve(absl::Time deadline);
+
+  // Returns the best known result. Can be called from any thread, including
+  // while `Improve()` runs on another.
+  std::shared_ptr<const DebtList> BestTransactions() const;
+
+  // Returns whether the best known result has the fewest transactions
+  // possible. Thread-safe like `BestTransactions()`.
+  bool IsOptimal() const;
+
+  // Returns the number of nonzero balances the search settles, which is how
+  // deep it recurses.
+  uint32_t NumBalances() const;
+
+ private:
+  struct Transfer {
+    uint32_t debtor;
+    uint32_t creditor;
+    Cents cents;
+  };
+
+  // Settles `balances_[first]` in every promising way, then the balances
+  // after it. Returns false if the deadline passed.
+  bool Search(uint32_t first);
+
+  // Returns a lower bound on the transfers settling the balances from
+  // `first` on.
+  uint32_t TransfersLeftLowerBound(uint32_t first);
+
+  // Publishes `transfers_` as the best known result.
+  void PublishTransfers();
+
+  // The users of the ledger, for their names.
+  DebtGraph users_;
+
+  // Nonzero net balances of the ledger, largest first, and their user ids.
+  // Transfers move balances around as the search goes, and are undone as it
+  // backtracks.
+  std::vector<Cents> balances_;
+  std::vector<uint64_t> ids_;
+  std::vector<Transfer> transfers_;
+  uint32_t num_nonzero_balances_;
+
+  // The number of transactions of the best known result, as seen by the
+  // search thread.
+  uint32_t best_size_;
+  absl::Time deadline_;
+  uint64_t nodes_until_deadline_check_ = 0;
+
+  // Scratch space of `TransfersLeftLowerBound()`.
+  absl::flat_hash_map<Cents, uint32_t> positive_counts_;
+
+  mutable absl::Mutex mutex_;
+  std::shared_ptr<const DebtList> best_ ABSL_GUARDED_BY(mutex_);
+  bool optimal_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+}  // namespace debt_simpl
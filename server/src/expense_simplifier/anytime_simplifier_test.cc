@@ -0,0 +1,122 @@
+#include "server/src/expense_simplifier/anytime_simplifier.h"
+
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+
+#include "proto/debts.pb.h"
+#include "server/src/expense_simplifier/debt_graph.h"
+#include "server/src/expense_simplifier/expense_simplifier.h"
+#include "server/src/expense_simplifier/random_ledger_testing.h"
+#include "server/src/expense_simplifier/utils.h"
+
+namespace debt_simpl {
+
+class TestAnytimeSimplifier : public ::testing::Test {
+ protected:
+  // Checks that `transactions` settle the same net balances as `original`.
+  static void ExpectSettles(const DebtGraph& original,
+                            const DebtList& transactions) {
+    absl::StatusOr<DebtGraph> settled = DebtGraph::BuildFromProto(transactions);
+    ASSERT_THAT(settled, IsOk());
+    for (uint64_t id = 0; id < original.NumUsers(); id++) {
+      const absl::string_view name = original.UserName(id);
+      const Cents balance = original.DebtGraphInternal::TotalDebt(id);
+      absl::StatusOr<Cents> settled_balance = settled->TotalDebt(name);
+      EXPECT_EQ(settled_balance.ok() ? *settled_balance : 0, balance) << name;
+    }
+  }
+};
+
+TEST_F(TestAnytimeSimplifier, StartsFromExpenseSimplifierResult) {
+  DebtGraph graph = RandomGraph(20, 60, /*seed=*/0, /*max_cents=*/20);
+  DebtGraph copy = graph;
+  ExpenseSimplifier simplifier(std::move(copy));
+
+  AnytimeSimplifier anytime(std::move(graph));
+  EXPECT_EQ(anytime.BestTransactions()->transactions_size(),
+            simplifier.MinimalTransactions().AllDebts().transactions_size());
+  EXPECT_FALSE(anytime.IsOptimal());
+}
+
+TEST_F(TestAnytimeSimplifier, ImprovesChainToOneTransaction) {
+  DebtGraph graph;
+  ASSERT_THAT(graph.AddTransaction("a", "b", 100), IsOk());
+  ASSERT_THAT(graph.AddTransaction("b", "c", 100), IsOk());
+  ASSERT_THAT(graph.AddTransaction("c", "d", 100), IsOk());
+
+  AnytimeSimplifier anytime(std::move(graph));
+  // Debts are only rerouted over existing edges at first.
+  EXPECT_EQ(anytime.BestTransactions()->transactions_size(), 3);
+  // Only a and d are out of balance.
+  EXPECT_EQ(anytime.NumBalances(), 2);
+
+  EXPECT_TRUE(anytime.Improve(absl::InfiniteFuture()));
+  EXPECT_TRUE(anytime.IsOptimal());
+  const std::shared_ptr<const DebtList> best = anytime.BestTransactions();
+  ASSERT_EQ(best->transactions_size(), 1);
+  EXPECT_EQ(best->transactions(0).lender(), "a");
+  EXPECT_EQ(best->transactions(0).receiver(), "d");
+  EXPECT_EQ(best->transactions(0).cents(), 100);
+}
+
+TEST_F(TestAnytimeSimplifier, MatchesExactSolver) {
+  for (uint32_t seed = 0; seed < 20; seed++) {
+    DebtGraph graph = RandomGraph(12, 30, seed, /*max_cents=*/20);
+    const DebtGraph original = graph;
+    DebtGraph copy = graph;
+    ExpenseSimplifier exact(std::move(copy),
+                            { .mode = SimplificationMode::kMinTransactions });
+    ASSERT_TRUE(exact.IsExact());
+
+    AnytimeSimplifier anytime(std::move(graph));
+    SCOPED_TRACE(absl::StrFormat("seed %d", seed));
+    EXPECT_TRUE(anytime.Improve(absl::InfiniteFuture()));
+    const std::shared_ptr<const DebtList> best = anytime.BestTransactions();
+    EXPECT_EQ(best->transactions_size(),
+              exact.MinimalTransactions().AllDebts().transactions_size());
+    ExpectSettles(original, *best);
+  }
+}
+
+TEST_F(TestAnytimeSimplifier, StopsAtDeadline) {
+  DebtGraph graph = RandomGraph(300, 3000, /*seed=*/1, /*max_cents=*/20);
+  const DebtGraph original = graph;
+  AnytimeSimplifier anytime(std::move(graph));
+  const int initial_size = anytime.BestTransactions()->transactions_size();
+
+  const absl::Time start = absl::Now();
+  EXPECT_FALSE(anytime.Improve(start + absl::Milliseconds(50)));
+  EXPECT_LT(absl::Now() - start, absl::Seconds(5));
+
+  EXPECT_FALSE(anytime.IsOptimal());
+  const std::shared_ptr<const DebtList> best = anytime.BestTransactions();
+  EXPECT_LE(best->transactions_size(), initial_size);
+  ExpectSettles(original, *best);
+}
+
+TEST_F(TestAnytimeSimplifier, BestTransactionsReadWhileSearching) {
+  DebtGraph graph = RandomGraph(300, 3000, /*seed=*/2, /*max_cents=*/20);
+  const DebtGraph original = graph;
+  AnytimeSimplifier anytime(std::move(graph));
+
+  std::thread search(
+      [&]() { anytime.Improve(absl::Now() + absl::Milliseconds(100)); });
+  int previous_size = anytime.BestTransactions()->transactions_size();
+  for (int i = 0; i < 20; i++) {
+    const std::shared_ptr<const DebtList> best = anytime.BestTransactions();
+    // The best known result only ever gets better.
+    EXPECT_LE(best->transactions_size(), previous_size);
+    previous_size = best->transactions_size();
+    absl::SleepFor(absl::Milliseconds(5));
+  }
+  search.join();
+  ExpectSettles(original, *anytime.BestTransactions());
+}
+
+}  // namespace debt_simpl
@@ -0,0 +1,72 @@
+#include "server/src/expense_simplifier/batch_simplifier.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+
+#include "proto/debts.pb.h"
+#include "server/src/expense_simplifier/debt_graph.h"
+#include "server/src/expense_simplifier/expense_simplifier.h"
+#include "server/src/expense_simplifier/utils.h"
+
+namespace debt_simpl {
+
+namespace {
+
+// Ledgers handed to a single task by `SimplifyAll()`. Small groups simplify in
+// microseconds, so scheduling each on its own would mostly measure the pool.
+constexpr uint64_t kLedgersPerTask = 16;
+
+}  // namespace
+
+BatchSimplifier::BatchSimplifier(const BatchSimplifierOptions& options)
+    : simplifier_options_(options.simplifier_options),
+      workspaces_(std::max<uint32_t>(options.num_threads, 1)),
+      pool_(std::max<uint32_t>(options.num_threads, 1)) {
+  simplifier_options_.num_threads = 1;
+}
+
+void BatchSimplifier::Simplify(DebtList debt_list, Callback done) {
+  pool_.Schedule([this, debt_list = std::move(debt_list),
+                  done = std::move(done)]() {
+    done(SimplifyOnWorker(debt_list));
+  });
+}
+
+void BatchSimplifier::Wait() {
+  pool_.Wait();
+}
+
+std::vector<absl::StatusOr<DebtList>> BatchSimplifier::SimplifyAll(
+    absl::Span<const DebtList> debt_lists) {
+  std::vector<absl::StatusOr<DebtList>> results(debt_lists.size());
+  for (uint64_t begin = 0; begin < debt_lists.size();
+       begin += kLedgersPerTask) {
+    const uint64_t end =
+        std::min<uint64_t>(begin + kLedgersPerTask, debt_lists.size());
+    pool_.Schedule([this, debt_lists, &results, begin, end]() {
+      for (uint64_t i = begin; i < end; i++) {
+        results[i] = SimplifyOnWorker(debt_lists[i]);
+      }
+    });
+  }
+  pool_.Wait();
+  return results;
+}
+
+absl::StatusOr<DebtList> BatchSimplifier::SimplifyOnWorker(
+    const DebtList& debt_list) {
+  DEFINE_OR_RETURN(DebtGraph, graph, DebtGraph::BuildFromProto(debt_list));
+
+  SimplifierWorkspace& workspace =
+      workspaces_[ThreadPool::CurrentWorkerIndex()];
+  ExpenseSimplifier simplifier(std::move(graph), simplifier_options_,
+                               &workspace);
+  return simplifier.MinimalTransactions().AllDebts();
+}
+
+}  // namespace debt_simpl
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+
+#include "proto/debts.pb.h"
+#include "server/src/expense_simplifier/expense_simplifier.h"
+#include "server/src/expense_simplifier/thread_pool.h"
+
+namespace debt_simpl {
+
+struct BatchSimplifierOptions {
+  // The number of worker threads ledgers are spread over.
+  uint32_t num_threads = 1;
+
+  // The options every ledger is simplified with. `num_threads` is ignored,
+  // since each ledger is simplified on the single worker that picked it up.
+  ExpenseSimplifierOptions simplifier_options;
+};
+
+// Simplifies many independent ledgers in parallel on a work-stealing pool.
+//
+// Every worker keeps its own residual graph and max-flow buffers, which are
+// reused from one ledger to the next, so simplifying a small ledger doesn't
+// pay for allocating them again.
+class BatchSimplifier {
+ public:
+  using Callback = std::function<void(absl::StatusOr<DebtList>)>;
+
+  explicit BatchSimplifier(const BatchSimplifierOptions& options = {});
+
+  BatchSimplifier(const BatchSimplifier&) = delete;
+  BatchSimplifier& operator=(const BatchSimplifier&) = delete;
+
+  // Schedules `debt_list` to be simplified. `done` is called with the minimal
+  // transactions settling it, from whichever worker simplified it.
+  void Simplify(DebtList debt_list, Callback done);
+
+  // Blocks until every ledger scheduled with `Simplify()` has been simplified
+  // and its callback has returned.
+  void Wait();
+
+  // Simplifies every ledger in `debt_lists`, returning the minimal
+  // transactions of each in the same order.
+  std::vector<absl::StatusOr<DebtList>> SimplifyAll(
+      absl::Span<const DebtList> debt_lists);
+
+ private:
+  absl::StatusOr<DebtList> SimplifyOnWorker(const DebtList& debt_list);
+
+  ExpenseSimplifierOptions simplifier_options_;
+
+  // One per worker, indexed by `ThreadPool::CurrentWorkerIndex()`. Declared
+  // before `pool_` so that the workers are joined before these are destroyed.
+  std::vector<SimplifierWorkspace> workspaces_;
+
+  ThreadPool pool_;
+};
+
+}  // namespace debt_simpl
@@ -0,0 +1,97 @@
+#include "server/src/expense_simplifier/batch_simplifier.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "absl/synchronization/mutex.h"
+#include "gtest/gtest.h"
+
+#include "proto/debts.pb.h"
+#include "server/src/expense_simplifier/debt_graph.h"
+#include "server/src/expense_simplifier/expense_simplifier.h"
+#include "server/src/expense_simplifier/random_ledger_testing.h"
+#include "server/src/expense_simplifier/utils.h"
+
+namespace debt_simpl {
+
+class TestBatchSimplifier : public ::testing::Test {
+ protected:
+  // Returns the debts in `debt_list`, keyed by (lender, receiver).
+  static std::map<std::pair<std::string, std::string>, Cents> Debts(
+      const DebtList& debt_list) {
+    std::map<std::pair<std::string, std::string>, Cents> debts;
+    for (const Transaction& t : debt_list.transactions()) {
+      debts[{ t.lender(), t.receiver() }] += t.cents();
+    }
+    return debts;
+  }
+
+  // Simplifies `debt_list` on its own, the way callers did before batching.
+  static DebtList SimplifyAlone(const DebtList& debt_list,
+                                const ExpenseSimplifierOptions& options) {
+    absl::StatusOr<DebtGraph> graph = DebtGraph::BuildFromProto(debt_list);
+    EXPECT_THAT(graph, IsOk());
+    ExpenseSimplifier simplifier(std::move(*graph), options);
+    return simplifier.MinimalTransactions().AllDebts();
+  }
+};
+
+TEST_F(TestBatchSimplifier, Empty) {
+  BatchSimplifier batch({ .num_threads = 2 });
+
+  EXPECT_TRUE(batch.SimplifyAll({}).empty());
+}
+
+TEST_F(TestBatchSimplifier, SimplifyAllMatchesIndividualRuns) {
+  for (const MaxFlowAlgorithm algorithm :
+       { MaxFlowAlgorithm::kBlockingFlow, MaxFlowAlgorithm::kPushRelabel }) {
+    const ExpenseSimplifierOptions options = { .max_flow_algorithm =
+                                                   algorithm };
+    std::vector<DebtList> ledgers;
+    for (uint32_t seed = 0; seed < 100; seed++) {
+      ledgers.push_back(RandomLedger(2 + seed % 10, seed % 40, seed));
+    }
+
+    BatchSimplifier batch(
+        { .num_threads = 4, .simplifier_options = options });
+    const std::vector<absl::StatusOr<DebtList>> results =
+        batch.SimplifyAll(ledgers);
+
+    ASSERT_EQ(results.size(), ledgers.size());
+    for (uint64_t i = 0; i < ledgers.size(); i++) {
+      SCOPED_TRACE(absl::StrFormat("algorithm %d, ledger %d",
+                                   static_cast<int>(algorithm), i));
+      ASSERT_THAT(results[i], IsOk());
+      EXPECT_EQ(Debts(*results[i]),
+                Debts(SimplifyAlone(ledgers[i], options)));
+    }
+  }
+}
+
+TEST_F(TestBatchSimplifier, StreamedLedgersCallBack) {
+  BatchSimplifier batch({ .num_threads = 3 });
+  absl::Mutex mutex;
+  std::map<uint64_t, DebtList> results;
+  for (uint64_t i = 0; i < 50; i++) {
+    batch.Simplify(RandomLedger(5, 20, i),
+                   [&mutex, &results, i](absl::StatusOr<DebtList> result) {
+                     ASSERT_THAT(result, IsOk());
+                     absl::MutexLock lock(&mutex);
+                     results[i] = *std::move(result);
+                   });
+  }
+  batch.Wait();
+
+  absl::MutexLock lock(&mutex);
+  ASSERT_EQ(results.size(), 50);
+  for (const auto& [i, result] : results) {
+    EXPECT_EQ(Debts(result), Debts(SimplifyAlone(RandomLedger(5, 20, i), {})));
+  }
+}
+
+}  // namespace debt_simpl
@@ -0,0 +1,219 @@
+#include "server/src/expense_simplifier/csr_graph.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "server/src/expense_simplifier/debt_graph.h"
+
+namespace debt_simpl {
+
+CsrDebtGraph::CsrDebtGraph(const DebtGraphInternal& graph) {
+  Assign(graph);
+}
+
+void CsrDebtGraph::Assign(const DebtGraphInternal& graph) {
+  const uint64_t num_users = graph.NumUsers();
+
+  arcs_.clear();
+  for (uint64_t receiver_id = 0; receiver_id < num_users; receiver_id++) {
+    for (const auto& [lender_id, debt] : graph.AllDebts(receiver_id)) {
+      AddArcs(receiver_id, lender_id, debt);
+    }
+  }
+  BuildFromArcs(num_users);
+
+  total_debts_.resize(num_users);
+  for (uint64_t id = 0; id < num_users; id++) {
+    total_debts_[id] = graph.TotalDebt(id);
+  }
+}
+
+void CsrDebtGraph::Assign(uint64_t num_users,
+                          const std::vector<DebtGraphEdge>& debts) {
+  arcs_.clear();
+  for (const DebtGraphEdge& edge : debts) {
+    AddArcs(edge.receiver_id, edge.lender_id, edge.debt);
+  }
+  BuildFromArcs(num_users);
+
+  total_debts_.assign(num_users, 0);
+  for (const DebtGraphEdge& edge : debts) {
+    if (edge.debt > 0) {
+      total_debts_[edge.receiver_id] += edge.debt;
+      total_debts_[edge.lender_id] -= edge.debt;
+    }
+  }
+}
+
+void CsrDebtGraph::AddArcs(uint64_t receiver_id, uint64_t lender_id,
+                           Cents debt) {
+  // Every positive debt contributes a forward arc carrying the debt and a
+  // backwards arc with no capacity. Pairs of users may appear twice if both
+  // directions were listed, which is resolved when merging in
+  // `BuildFromArcs()`.
+  if (debt <= 0) {
+    return;
+  }
+  arcs_.push_back(
+      Arc{ .from = receiver_id, .to = lender_id, .capacity = debt });
+  arcs_.push_back(Arc{ .from = lender_id, .to = receiver_id, .capacity = 0 });
+}
+
+void CsrDebtGraph::BuildFromArcs(uint64_t num_users) {
+  std::sort(arcs_.begin(), arcs_.end(), [](const Arc& a1, const Arc& a2) {
+    return a1.from != a2.from ? a1.from < a2.from : a1.to < a2.to;
+  });
+
+  offsets_.assign(num_users + 1, 0);
+  neighbors_.clear();
+  capacities_.clear();
+  neighbors_.reserve(arcs_.size());
+  capacities_.reserve(arcs_.size());
+  for (const Arc& arc : arcs_) {
+    if (!neighbors_.empty() && offsets_[arc.from + 1] != 0 &&
+        neighbors_.back() == arc.to) {
+      capacities_.back() += arc.capacity;
+      continue;
+    }
+    neighbors_.push_back(arc.to);
+    capacities_.push_back(arc.capacity);
+    offsets_[arc.from + 1]++;
+  }
+  for (uint64_t id = 0; id < num_users; id++) {
+    offsets_[id + 1] += offsets_[id];
+  }
+
+  backwards_edges_.resize(neighbors_.size());
+  for (uint64_t edge = 0; edge < neighbors_.size(); edge++) {
+    backwards_edges_[edge] = capacities_[edge] == 0;
+  }
+
+  reverse_edges_.resize(neighbors_.size());
+  for (uint64_t id = 0; id < num_users; id++) {
+    for (uint64_t edge = EdgeBegin(id); edge < EdgeEnd(id); edge++) {
+      reverse_edges_[edge] = FindEdge(neighbors_[edge], id);
+    }
+  }
+
+  pushed_edges_.clear();
+}
+
+CsrDebtGraph::CsrDebtGraph(const CsrDebtGraph& graph,
+                           const std::vector<uint64_t>& user_ids,
+                           const std::vector<uint64_t>& local_ids) {
+  offsets_.reserve(user_ids.size() + 1);
+  offsets_.push_back(0);
+  total_debts_.reserve(user_ids.size());
+  for (const uint64_t id : user_ids) {
+    offsets_.push_back(offsets_.back() + graph.EdgeEnd(id) -
+                       graph.EdgeBegin(id));
+    total_debts_.push_back(graph.TotalDebt(id));
+  }
+
+  // Since `user_ids` is sorted, renumbering keeps every row sorted, and since
+  // it is closed under adjacency, every row is copied whole.
+  const uint64_t num_edges = offsets_.back();
+  neighbors_.reserve(num_edges);
+  capacities_.reserve(num_edges);
+  reverse_edges_.reserve(num_edges);
+  backwards_edges_.reserve(num_edges);
+  for (const uint64_t id : user_ids) {
+    for (uint64_t edge = graph.EdgeBegin(id); edge < graph.EdgeEnd(id);
+         edge++) {
+      const uint64_t neighbor_id = graph.Neighbor(edge);
+      const uint64_t reverse_edge = graph.ReverseEdge(edge);
+      neighbors_.push_back(local_ids[neighbor_id]);
+      capacities_.push_back(graph.Capacity(edge));
+      reverse_edges_.push_back(offsets_[local_ids[neighbor_id]] +
+                               reverse_edge - graph.EdgeBegin(neighbor_id));
+      backwards_edges_.push_back(graph.backwards_edges_[edge]);
+    }
+  }
+}
+
+uint64_t CsrDebtGraph::NumUsers() const {
+  return static_cast<uint64_t>(total_debts_.size());
+}
+
+uint64_t CsrDebtGraph::NumEdges() const {
+  return static_cast<uint64_t>(neighbors_.size());
+}
+
+void CsrDebtGraph::PushFlowOnEdge(uint64_t edge, Cents amount) {
+  capacities_[edge] -= amount;
+  capacities_[reverse_edges_[edge]] += amount;
+  pushed_edges_.push_back(edge);
+}
+
+void CsrDebtGraph::SettleFlows() {
+  for (const uint64_t edge : pushed_edges_) {
+    for (const uint64_t e : { edge, reverse_edges_[edge] }) {
+      if (backwards_edges_[e]) {
+        capacities_[e] = 0;
+      }
+    }
+  }
+  pushed_edges_.clear();
+}
+
+uint64_t CsrDebtGraph::FindEdge(uint64_t from, uint64_t to) const {
+  const auto begin = neighbors_.begin() + EdgeBegin(from);
+  const auto end = neighbors_.begin() + EdgeEnd(from);
+  const auto it = std::lower_bound(begin, end, to);
+  if (it == end || *it != to) {
+    return kNoEdge;
+  }
+  return static_cast<uint64_t>(it - neighbors_.begin());
+}
+
+Cents CsrDebtGraph::Debt(uint64_t receiver_id, uint64_t lender_id) const {
+  const uint64_t edge = FindEdge(receiver_id, lender_id);
+  return edge == kNoEdge ? 0 : capacities_[edge];
+}
+
+Cents CsrDebtGraph::TotalDebt(uint64_t id) const {
+  return total_debts_[id];
+}
+
+void CsrDebtGraph::PushFlow(uint64_t from, uint64_t to, Cents amount) {
+  // Adding debt from `from` to `to` is the same as pushing flow from `to` to
+  // `from` in the residual graph.
+  PushFlowOnEdge(FindEdge(to, from), amount);
+  total_debts_[from] += amount;
+  total_debts_[to] -= amount;
+}
+
+void CsrDebtGraph::EraseEdge(uint64_t user1_id, uint64_t user2_id) {
+  const uint64_t edge = FindEdge(user1_id, user2_id);
+  if (edge == kNoEdge) {
+    return;
+  }
+  const uint64_t reverse_edge = reverse_edges_[edge];
+  total_debts_[user1_id] -= capacities_[edge];
+  total_debts_[user2_id] -= capacities_[reverse_edge];
+  capacities_[edge] = 0;
+  capacities_[reverse_edge] = 0;
+}
+
+CsrDebtGraph::EdgeRange CsrDebtGraph::AllDebts(uint64_t user_id) const {
+  return EdgeRange(this, EdgeBegin(user_id), EdgeEnd(user_id));
+}
+
+std::vector<DebtGraphEdge> CsrDebtGraph::AllDebts() const {
+  std::vector<DebtGraphEdge> edges;
+  for (uint64_t receiver_id = 0; receiver_id < NumUsers(); receiver_id++) {
+    for (uint64_t edge = EdgeBegin(receiver_id); edge < EdgeEnd(receiver_id);
+         edge++) {
+      if (capacities_[edge] <= 0) {
+        continue;
+      }
+      edges.push_back(DebtGraphEdge{ .receiver_id = receiver_id,
+                                     .lender_id = neighbors_[edge],
+                                     .debt = capacities_[edge] });
+    }
+  }
+  return edges;
+}
+
+}  // namespace debt_simpl
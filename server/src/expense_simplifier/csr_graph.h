@@ -0,0 +1,196 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "server/src/expense_simplifier/debt_graph.h"
+
+namespace debt_simpl {
+
+// A residual debt graph stored in compressed-sparse-row form.
+//
+// The outgoing edges of user `id` occupy the index range
+// [EdgeBegin(id), EdgeEnd(id)) of the packed neighbor and capacity arrays, and
+// are sorted by neighbor id. Every edge has a paired reverse edge, so pushing
+// flow along an edge only touches two array slots.
+//
+// The capacity of the edge from `receiver_id` to `lender_id` is the debt
+// `receiver_id` owes `lender_id`, which matches the semantics of
+// `AugmentedDebtGraph`.
+class CsrDebtGraph {
+ public:
+  // An iterable view over the outgoing edges of a single user, yielding
+  // (neighbor id, capacity) pairs.
+  class EdgeRange {
+   public:
+    class Iterator {
+     public:
+      Iterator(const CsrDebtGraph* graph, uint64_t edge)
+          : graph_(graph), edge_(edge) {}
+
+      std::pair<uint64_t, Cents> operator*() const {
+        return { graph_->Neighbor(edge_), graph_->Capacity(edge_) };
+      }
+
+      Iterator& operator++() {
+        edge_++;
+        return *this;
+      }
+
+      bool operator!=(const Iterator& other) const {
+        return edge_ != other.edge_;
+      }
+
+     private:
+      const CsrDebtGraph* graph_;
+      uint64_t edge_;
+    };
+
+    EdgeRange(const CsrDebtGraph* graph, uint64_t begin, uint64_t end)
+        : graph_(graph), begin_(begin), end_(end) {}
+
+    Iterator begin() const {
+      return Iterator(graph_, begin_);
+    }
+    Iterator end() const {
+      return Iterator(graph_, end_);
+    }
+
+   private:
+    const CsrDebtGraph* graph_;
+    uint64_t begin_;
+    uint64_t end_;
+  };
+
+  CsrDebtGraph() = default;
+
+  CsrDebtGraph(const CsrDebtGraph&) = default;
+  CsrDebtGraph& operator=(const CsrDebtGraph&) = default;
+  CsrDebtGraph(CsrDebtGraph&&) = default;
+  CsrDebtGraph& operator=(CsrDebtGraph&&) = default;
+
+  // Constructs a CSR graph from `graph`. Only positive debts become edge
+  // capacities; credits are dropped the same way `AugmentedDebtGraph` drops
+  // them, and all backwards edges are initialized to 0.
+  explicit CsrDebtGraph(const DebtGraphInternal& graph);
+
+  // Replaces the contents of this graph with `graph`, like the constructor
+  // above, but reuses the buffers already allocated by this graph. Useful when
+  // simplifying many small ledgers one after another.
+  void Assign(const DebtGraphInternal& graph);
+
+  // Replaces the contents of this graph with a graph of `num_users` users
+  // owing the given debts. Non-positive debts are dropped.
+  void Assign(uint64_t num_users, const std::vector<DebtGraphEdge>& debts);
+
+  // Constructs the subgraph of `graph` induced by `user_ids`, which must be
+  // sorted and closed under adjacency, like a connected component. User
+  // `user_ids[i]` becomes user `i` of the subgraph, and `local_ids[id]` must
+  // be the position of `id` in `user_ids` for every `id` in `user_ids`.
+  CsrDebtGraph(const CsrDebtGraph& graph, const std::vector<uint64_t>& user_ids,
+               const std::vector<uint64_t>& local_ids);
+
+  // Returns the total number of users in the graph.
+  uint64_t NumUsers() const;
+
+  // Returns the total number of directed edges in the graph, including
+  // backwards edges.
+  uint64_t NumEdges() const;
+
+  // Returns the index of the first outgoing edge of `user_id`.
+  uint64_t EdgeBegin(uint64_t user_id) const {
+    return offsets_[user_id];
+  }
+
+  // Returns one past the index of the last outgoing edge of `user_id`.
+  uint64_t EdgeEnd(uint64_t user_id) const {
+    return offsets_[user_id + 1];
+  }
+
+  // Returns the user at the other end of edge `edge`.
+  uint64_t Neighbor(uint64_t edge) const {
+    return neighbors_[edge];
+  }
+
+  // Returns the remaining capacity of edge `edge`.
+  Cents Capacity(uint64_t edge) const {
+    return capacities_[edge];
+  }
+
+  // Returns the index of the edge going in the opposite direction of `edge`.
+  uint64_t ReverseEdge(uint64_t edge) const {
+    return reverse_edges_[edge];
+  }
+
+  // Pushes `amount` of flow along edge `edge`, reducing its capacity and
+  // increasing the capacity of its reverse edge.
+  void PushFlowOnEdge(uint64_t edge, Cents amount);
+
+  // Commits all flow pushed since the last call. The debts reduced by that
+  // flow stay reduced, but the capacity gained by backwards edges is dropped,
+  // so later max-flow computations can't undo flow that was already settled.
+  void SettleFlows();
+
+  // Returns the index of the edge from `from` to `to`, or `kNoEdge` if the two
+  // users aren't connected.
+  uint64_t FindEdge(uint64_t from, uint64_t to) const;
+
+  // Returns the debt `receiver_id` owes `lender_id`.
+  Cents Debt(uint64_t receiver_id, uint64_t lender_id) const;
+
+  // Returns the total debt this user owes.
+  Cents TotalDebt(uint64_t id) const;
+
+  // Pushes flow of money from `from` to `to`. This adds `amount` debt owed to
+  // `to` by `from`. The two users must already share an edge.
+  void PushFlow(uint64_t from, uint64_t to, Cents amount);
+
+  // Zeroes the capacity of the edge between the two users in both directions,
+  // if one exists.
+  void EraseEdge(uint64_t user1_id, uint64_t user2_id);
+
+  // Returns the outgoing edges of `user_id` and their capacities.
+  EdgeRange AllDebts(uint64_t user_id) const;
+
+  // Returns all edges with positive capacity in the graph.
+  std::vector<DebtGraphEdge> AllDebts() const;
+
+  static constexpr uint64_t kNoEdge = UINT64_MAX;
+
+ private:
+  struct Arc {
+    uint64_t from;
+    uint64_t to;
+    Cents capacity;
+  };
+
+  // Queues the forward and backwards arcs of a debt for `BuildFromArcs()`.
+  void AddArcs(uint64_t receiver_id, uint64_t lender_id, Cents debt);
+
+  // Rebuilds the edge arrays from the queued arcs, leaving `total_debts_` to
+  // the caller.
+  void BuildFromArcs(uint64_t num_users);
+
+  // offsets_[id] is the index of the first outgoing edge of user `id`, and
+  // offsets_[NumUsers()] == NumEdges().
+  std::vector<uint64_t> offsets_;
+
+  std::vector<uint64_t> neighbors_;
+  std::vector<Cents> capacities_;
+  std::vector<uint64_t> reverse_edges_;
+
+  // True for edges which started with no capacity of their own, i.e. edges
+  // whose capacity only ever comes from undoing flow.
+  std::vector<bool> backwards_edges_;
+
+  // Edges flow has been pushed along since the last `SettleFlows()`.
+  std::vector<uint64_t> pushed_edges_;
+
+  std::vector<Cents> total_debts_;
+
+  // Arcs queued by `AddArcs()`, kept around to reuse their buffer.
+  std::vector<Arc> arcs_;
+};
+
+}  // namespace debt_simpl
@@ -0,0 +1,264 @@
+#include "server/src/expense_simplifier/csr_graph.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "gmock/gmock.h"
+#include "google/protobuf/text_format.h"
+#include "gtest/gtest.h"
+
+#include "server/src/expense_simplifier/debt_graph.h"
+#include "server/src/expense_simplifier/utils.h"
+
+namespace debt_simpl {
+
+using google::protobuf::TextFormat;
+using ::testing::AllOf;
+using ::testing::ElementsAre;
+using ::testing::Field;
+using ::testing::UnorderedElementsAre;
+
+class TestCsrDebtGraph : public ::testing::Test {
+ protected:
+  absl::StatusOr<DebtGraph> CreateFromString(
+      absl::string_view debt_list_proto) {
+    DebtList debt_list;
+    if (!TextFormat::ParseFromString(debt_list_proto, &debt_list)) {
+      return absl::InternalError(
+          absl::StrFormat("Failed to construct DebtList proto from string %s",
+                          debt_list_proto));
+    }
+
+    return DebtGraph::BuildFromProto(debt_list);
+  }
+};
+
+TEST_F(TestCsrDebtGraph, Empty) {
+  CsrDebtGraph graph{ DebtGraph() };
+
+  EXPECT_EQ(graph.NumUsers(), 0);
+  EXPECT_EQ(graph.NumEdges(), 0);
+  EXPECT_TRUE(graph.AllDebts().empty());
+}
+
+TEST_F(TestCsrDebtGraph, SingleTransaction) {
+  ASSERT_OK_AND_DEFINE(DebtGraph, debt_graph, CreateFromString(R"(
+    transactions {
+      lender: "alice"
+      receiver: "bob"
+      cents: 100
+    })"));
+  ASSERT_OK_AND_DEFINE(uint64_t, alice_id, debt_graph.FindUserId("alice"));
+  ASSERT_OK_AND_DEFINE(uint64_t, bob_id, debt_graph.FindUserId("bob"));
+
+  CsrDebtGraph graph(debt_graph);
+
+  EXPECT_EQ(graph.NumUsers(), 2);
+  EXPECT_EQ(graph.NumEdges(), 2);
+  EXPECT_EQ(graph.Debt(bob_id, alice_id), 100);
+  EXPECT_EQ(graph.Debt(alice_id, bob_id), 0);
+  EXPECT_EQ(graph.TotalDebt(bob_id), 100);
+  EXPECT_EQ(graph.TotalDebt(alice_id), -100);
+
+  const uint64_t edge = graph.FindEdge(bob_id, alice_id);
+  ASSERT_NE(edge, CsrDebtGraph::kNoEdge);
+  EXPECT_EQ(graph.Neighbor(edge), alice_id);
+  EXPECT_EQ(graph.Neighbor(graph.ReverseEdge(edge)), bob_id);
+  EXPECT_EQ(graph.ReverseEdge(graph.ReverseEdge(edge)), edge);
+}
+
+TEST_F(TestCsrDebtGraph, NeighborsSorted) {
+  ASSERT_OK_AND_DEFINE(DebtGraph, debt_graph, CreateFromString(R"(
+    transactions {
+      lender: "a"
+      receiver: "d"
+      cents: 100
+    }
+    transactions {
+      lender: "b"
+      receiver: "d"
+      cents: 200
+    }
+    transactions {
+      lender: "c"
+      receiver: "d"
+      cents: 300
+    })"));
+  ASSERT_OK_AND_DEFINE(uint64_t, a_id, debt_graph.FindUserId("a"));
+  ASSERT_OK_AND_DEFINE(uint64_t, b_id, debt_graph.FindUserId("b"));
+  ASSERT_OK_AND_DEFINE(uint64_t, c_id, debt_graph.FindUserId("c"));
+  ASSERT_OK_AND_DEFINE(uint64_t, d_id, debt_graph.FindUserId("d"));
+
+  CsrDebtGraph graph(debt_graph);
+
+  std::vector<std::pair<uint64_t, Cents>> d_edges;
+  for (const auto& [neighbor_id, capacity] : graph.AllDebts(d_id)) {
+    d_edges.push_back({ neighbor_id, capacity });
+  }
+  EXPECT_THAT(d_edges,
+              ElementsAre(std::pair<uint64_t, Cents>{ a_id, 100 },
+                          std::pair<uint64_t, Cents>{ b_id, 200 },
+                          std::pair<uint64_t, Cents>{ c_id, 300 }));
+}
+
+TEST_F(TestCsrDebtGraph, PushFlow) {
+  ASSERT_OK_AND_DEFINE(DebtGraph, debt_graph, CreateFromString(R"(
+    transactions {
+      lender: "alice"
+      receiver: "bob"
+      cents: 100
+    })"));
+  ASSERT_OK_AND_DEFINE(uint64_t, alice_id, debt_graph.FindUserId("alice"));
+  ASSERT_OK_AND_DEFINE(uint64_t, bob_id, debt_graph.FindUserId("bob"));
+
+  CsrDebtGraph graph(debt_graph);
+  graph.PushFlow(alice_id, bob_id, 30);
+
+  EXPECT_EQ(graph.Debt(bob_id, alice_id), 70);
+  EXPECT_EQ(graph.Debt(alice_id, bob_id), 30);
+  EXPECT_EQ(graph.TotalDebt(bob_id), 70);
+  EXPECT_EQ(graph.TotalDebt(alice_id), -70);
+}
+
+TEST_F(TestCsrDebtGraph, SettleFlowsDropsBackwardsCapacity) {
+  ASSERT_OK_AND_DEFINE(DebtGraph, debt_graph, CreateFromString(R"(
+    transactions {
+      lender: "alice"
+      receiver: "bob"
+      cents: 100
+    })"));
+  ASSERT_OK_AND_DEFINE(uint64_t, alice_id, debt_graph.FindUserId("alice"));
+  ASSERT_OK_AND_DEFINE(uint64_t, bob_id, debt_graph.FindUserId("bob"));
+
+  CsrDebtGraph graph(debt_graph);
+  graph.PushFlowOnEdge(graph.FindEdge(bob_id, alice_id), 30);
+  graph.SettleFlows();
+
+  EXPECT_EQ(graph.Debt(bob_id, alice_id), 70);
+  EXPECT_EQ(graph.Debt(alice_id, bob_id), 0);
+}
+
+TEST_F(TestCsrDebtGraph, EraseEdge) {
+  ASSERT_OK_AND_DEFINE(DebtGraph, debt_graph, CreateFromString(R"(
+    transactions {
+      lender: "alice"
+      receiver: "bob"
+      cents: 100
+    }
+    transactions {
+      lender: "bob"
+      receiver: "charlie"
+      cents: 50
+    })"));
+  ASSERT_OK_AND_DEFINE(uint64_t, alice_id, debt_graph.FindUserId("alice"));
+  ASSERT_OK_AND_DEFINE(uint64_t, bob_id, debt_graph.FindUserId("bob"));
+  ASSERT_OK_AND_DEFINE(uint64_t, charlie_id, debt_graph.FindUserId("charlie"));
+
+  CsrDebtGraph graph(debt_graph);
+  graph.EraseEdge(alice_id, bob_id);
+
+  EXPECT_EQ(graph.Debt(bob_id, alice_id), 0);
+  EXPECT_EQ(graph.Debt(alice_id, bob_id), 0);
+  EXPECT_THAT(graph.AllDebts(),
+              UnorderedElementsAre(
+                  AllOf(Field(&DebtGraphEdge::receiver_id, charlie_id),
+                        Field(&DebtGraphEdge::lender_id, bob_id),
+                        Field(&DebtGraphEdge::debt, 50))));
+}
+
+TEST_F(TestCsrDebtGraph, CreditsDropped) {
+  ASSERT_OK_AND_DEFINE(DebtGraph, debt_graph, CreateFromString(R"(
+    transactions {
+      lender: "alice"
+      receiver: "bob"
+      cents: 100
+    }
+    transactions {
+      lender: "bob"
+      receiver: "alice"
+      cents: 40
+    })"));
+  ASSERT_OK_AND_DEFINE(uint64_t, alice_id, debt_graph.FindUserId("alice"));
+  ASSERT_OK_AND_DEFINE(uint64_t, bob_id, debt_graph.FindUserId("bob"));
+
+  CsrDebtGraph graph(debt_graph);
+
+  EXPECT_EQ(graph.NumEdges(), 2);
+  EXPECT_EQ(graph.Debt(bob_id, alice_id), 60);
+  EXPECT_EQ(graph.Debt(alice_id, bob_id), 0);
+}
+
+TEST_F(TestCsrDebtGraph, Subgraph) {
+  ASSERT_OK_AND_DEFINE(DebtGraph, debt_graph, CreateFromString(R"(
+    transactions {
+      lender: "alice"
+      receiver: "bob"
+      cents: 100
+    }
+    transactions {
+      lender: "charlie"
+      receiver: "dave"
+      cents: 30
+    }
+    transactions {
+      lender: "dave"
+      receiver: "eve"
+      cents: 20
+    })"));
+  ASSERT_OK_AND_DEFINE(uint64_t, charlie_id, debt_graph.FindUserId("charlie"));
+  ASSERT_OK_AND_DEFINE(uint64_t, dave_id, debt_graph.FindUserId("dave"));
+  ASSERT_OK_AND_DEFINE(uint64_t, eve_id, debt_graph.FindUserId("eve"));
+
+  CsrDebtGraph graph(debt_graph);
+  const std::vector<uint64_t> user_ids = { charlie_id, dave_id, eve_id };
+  std::vector<uint64_t> local_ids(graph.NumUsers(), 0);
+  for (uint64_t i = 0; i < user_ids.size(); i++) {
+    local_ids[user_ids[i]] = i;
+  }
+
+  CsrDebtGraph subgraph(graph, user_ids, local_ids);
+
+  EXPECT_EQ(subgraph.NumUsers(), 3);
+  EXPECT_EQ(subgraph.NumEdges(), 4);
+  EXPECT_EQ(subgraph.Debt(1, 0), 30);
+  EXPECT_EQ(subgraph.Debt(2, 1), 20);
+  EXPECT_EQ(subgraph.TotalDebt(0), -30);
+  EXPECT_EQ(subgraph.TotalDebt(1), 10);
+  EXPECT_EQ(subgraph.TotalDebt(2), 20);
+  for (uint64_t id = 0; id < subgraph.NumUsers(); id++) {
+    for (uint64_t edge = subgraph.EdgeBegin(id); edge < subgraph.EdgeEnd(id);
+         edge++) {
+      EXPECT_EQ(subgraph.Neighbor(subgraph.ReverseEdge(edge)), id);
+    }
+  }
+}
+
+TEST_F(TestCsrDebtGraph, AssignFromEdges) {
+  CsrDebtGraph graph;
+  graph.Assign(
+      3, { DebtGraphEdge{ .receiver_id = 0, .lender_id = 1, .debt = 40 },
+           DebtGraphEdge{ .receiver_id = 2, .lender_id = 1, .debt = 10 },
+           DebtGraphEdge{ .receiver_id = 1, .lender_id = 0, .debt = 0 } });
+
+  EXPECT_EQ(graph.NumUsers(), 3);
+  EXPECT_EQ(graph.NumEdges(), 4);
+  EXPECT_EQ(graph.Debt(0, 1), 40);
+  EXPECT_EQ(graph.Debt(2, 1), 10);
+  EXPECT_EQ(graph.TotalDebt(0), 40);
+  EXPECT_EQ(graph.TotalDebt(1), -50);
+  EXPECT_EQ(graph.TotalDebt(2), 10);
+
+  // Reassigning replaces the old contents entirely.
+  graph.Assign(
+      2, { DebtGraphEdge{ .receiver_id = 1, .lender_id = 0, .debt = 5 } });
+
+  EXPECT_EQ(graph.NumUsers(), 2);
+  EXPECT_EQ(graph.NumEdges(), 2);
+  EXPECT_EQ(graph.Debt(1, 0), 5);
+  EXPECT_EQ(graph.Debt(0, 1), 0);
+  EXPECT_EQ(graph.TotalDebt(0), -5);
+}
+
+}  // namespace debt_simpl
@@ -3,10 +3,12 @@
 #include <algorithm>
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include "absl/status/statusor.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
+#include "google/protobuf/arena.h"
 
 #include "proto/debts.pb.h"
 #include "server/src/expense_simplifier/utils.h"
@@ -133,6 +135,21 @@ absl::StatusOr<DebtGraph> DebtGraph::BuildFromProto(const DebtList& debt_list) {
   return graph;
 }
 
+// static
+absl::StatusOr<DebtGraph> DebtGraph::BuildFromSerializedProto(
+    absl::string_view serialized_debt_list) {
+  google::protobuf::Arena arena;
+  DebtList* debt_list =
+      google::protobuf::Arena::CreateMessage<DebtList>(&arena);
+  if (!debt_list->ParseFromArray(
+          serialized_debt_list.data(),
+          static_cast<int>(serialized_debt_list.size()))) {
+    return absl::InvalidArgumentError("Failed to parse serialized DebtList");
+  }
+
+  return BuildFromProto(*debt_list);
+}
+
 absl::StatusOr<Cents> DebtGraph::AmountOwed(absl::string_view to,
                                             absl::string_view from) const {
   uint64_t to_id, from_id;
@@ -148,49 +165,73 @@ absl::StatusOr<Cents> DebtGraph::TotalDebt(absl::string_view user) const {
 }
 
 absl::Status DebtGraph::AddTransaction(const Transaction& t) {
-  uint64_t lender_id = FindOrAssignUserId(t.lender());
-  uint64_t receiver_id = FindOrAssignUserId(t.receiver());
+  return AddTransaction(t.lender(), t.receiver(), t.cents());
+}
+
+absl::Status DebtGraph::AddTransaction(absl::string_view lender,
+                                       absl::string_view receiver,
+                                       Cents cents) {
+  uint64_t lender_id = FindOrAssignUserId(lender);
+  uint64_t receiver_id = FindOrAssignUserId(receiver);
 
-  PushFlow(receiver_id, lender_id, t.cents());
+  PushFlow(receiver_id, lender_id, cents);
   return absl::OkStatus();
 }
 
 absl::StatusOr<uint64_t> DebtGraph::FindUserId(
     absl::string_view username) const {
-  const auto it = id_map_.find(username);
-  if (it == id_map_.end()) {
+  const uint64_t id = user_names_.Find(username);
+  if (id == UserNameArena::kNotFound) {
     return absl::InternalError(absl::StrFormat("No such user %s", username));
   }
-  return it->second;
+  return id;
+}
+
+absl::string_view DebtGraph::UserName(uint64_t id) const {
+  return user_names_.Name(id);
 }
 
 const DebtList DebtGraph::AllDebts() const {
   DebtList debts;
-  absl::flat_hash_map<uint64_t, std::string> id_to_username;
-  for (const auto& [username, id] : id_map_) {
-    id_to_username.insert({ id, username });
-  }
+  AppendAllDebts(&debts);
+  return debts;
+}
+
+DebtList* DebtGraph::AllDebts(google::protobuf::Arena* arena) const {
+  DebtList* debts = google::protobuf::Arena::CreateMessage<DebtList>(arena);
+  AppendAllDebts(debts);
+  return debts;
+}
+
+void DebtGraph::AppendAllDebts(DebtList* debts) const {
+  const std::vector<DebtGraphEdge> edges = DebtGraphInternal::AllDebts();
+  const uint64_t num_debts =
+      std::count_if(edges.begin(), edges.end(),
+                    [](const DebtGraphEdge& edge) { return edge.debt > 0; });
+  debts->mutable_transactions()->Reserve(
+      debts->transactions_size() + static_cast<int>(num_debts));
 
-  for (const auto& edge : DebtGraphInternal::AllDebts()) {
+  for (const auto& edge : edges) {
     if (edge.debt <= 0) {
       continue;
     }
-    Transaction& transaction = *debts.add_transactions();
-    transaction.set_lender(id_to_username[edge.lender_id]);
-    transaction.set_receiver(id_to_username[edge.receiver_id]);
+    // Transactions of an arena-allocated list are allocated on the same arena,
+    // and so are the copies of the names set here.
+    Transaction& transaction = *debts->add_transactions();
+    const absl::string_view lender = user_names_.Name(edge.lender_id);
+    const absl::string_view receiver = user_names_.Name(edge.receiver_id);
+    transaction.set_lender(lender.data(), lender.size());
+    transaction.set_receiver(receiver.data(), receiver.size());
     transaction.set_cents(edge.debt);
   }
-
-  return debts;
 }
 
-uint64_t DebtGraph::FindOrAssignUserId(std::string username) {
-  const auto [it, inserted] =
-      id_map_.insert({ username, static_cast<uint64_t>(id_map_.size()) });
-  if (inserted) {
+uint64_t DebtGraph::FindOrAssignUserId(absl::string_view username) {
+  const uint64_t id = user_names_.FindOrInsert(username);
+  if (id == NumUsers()) {
     AddNewUser();
   }
-  return it->second;
+  return id;
 }
 
 AugmentedDebtGraph::AugmentedDebtGraph(const DebtGraph& graph)
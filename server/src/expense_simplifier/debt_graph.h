@@ -7,8 +7,10 @@
 #include "absl/container/flat_hash_map.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "google/protobuf/arena.h"
 
 #include "proto/debts.pb.h"
+#include "server/src/expense_simplifier/user_name_arena.h"
 
 namespace debt_simpl {
 
@@ -52,6 +54,8 @@ class DebtGraphInternal {
 
   DebtGraphInternal(const DebtGraphInternal&) = default;
   DebtGraphInternal& operator=(const DebtGraphInternal&) = default;
+  DebtGraphInternal(DebtGraphInternal&&) = default;
+  DebtGraphInternal& operator=(DebtGraphInternal&&) = default;
 
   // Returns the total number of users in the graph. Id's will span the range
   // [0, NumUsers()).
@@ -97,6 +101,7 @@ class DebtGraphInternal {
 };
 
 class DebtGraph : public DebtGraphInternal {
+  friend class LedgerSnapshot;
   friend class TestExpenseSimplifier;
 
  public:
@@ -104,9 +109,17 @@ class DebtGraph : public DebtGraphInternal {
 
   DebtGraph(const DebtGraph&) = default;
   DebtGraph& operator=(const DebtGraph&) = default;
+  DebtGraph(DebtGraph&&) = default;
+  DebtGraph& operator=(DebtGraph&&) = default;
 
   static absl::StatusOr<DebtGraph> BuildFromProto(const DebtList& debt_list);
 
+  // Parses a serialized DebtList and builds a graph from it. The parsed list
+  // lives on an arena which is released in one go once the graph is built,
+  // rather than freeing every transaction and name separately.
+  static absl::StatusOr<DebtGraph> BuildFromSerializedProto(
+      absl::string_view serialized_debt_list);
+
   // Returns the amount of money `from` owes `to`.
   absl::StatusOr<Cents> AmountOwed(absl::string_view to,
                                    absl::string_view from) const;
@@ -117,20 +130,37 @@ class DebtGraph : public DebtGraphInternal {
 
   absl::Status AddTransaction(const Transaction& t);
 
+  // Records that `receiver` borrowed `cents` from `lender`, like the overload
+  // above, for callers that parse transactions without building protos.
+  absl::Status AddTransaction(absl::string_view lender,
+                              absl::string_view receiver, Cents cents);
+
   // Given a user's name, returns the unique id of the user, or an error if
   // that user doesn't exist.
   absl::StatusOr<uint64_t> FindUserId(absl::string_view username) const;
 
+  // Returns the name of the user with id `id`, which must be in
+  // [0, NumUsers()).
+  absl::string_view UserName(uint64_t id) const;
+
   // Returns all debts between all users in the graph.
   const DebtList AllDebts() const;
 
+  // Same as above, but allocates the list, its transactions and their names
+  // on `arena`, so a large export costs a handful of block allocations
+  // instead of several per transaction.
+  DebtList* AllDebts(google::protobuf::Arena* arena) const;
+
  private:
+  // Appends all debts between all users in the graph to `debts`.
+  void AppendAllDebts(DebtList* debts) const;
+
   // Given a user's name, returns the unique id of the user, creating a new
   // username-id binding if one doesn't already exist for this user.
-  uint64_t FindOrAssignUserId(std::string username);
+  uint64_t FindOrAssignUserId(absl::string_view username);
 
-  // Map of user names to unique id's.
-  absl::flat_hash_map<std::string, uint64_t> id_map_;
+  // Interned user names, whose ids are the user ids of the graph.
+  UserNameArena user_names_;
 };
 
 class AugmentedDebtGraph : public DebtGraphInternal {
@@ -1,10 +1,12 @@
 #include "server/src/expense_simplifier/debt_graph.h"
 
 #include <cstdint>
+#include <string>
 
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
 #include "gmock/gmock.h"
+#include "google/protobuf/arena.h"
 #include "google/protobuf/text_format.h"
 #include "gtest/gtest.h"
 
@@ -129,6 +131,42 @@ TEST_F(TestDebtGraph, TwoTransactions) {
   EXPECT_THAT(graph.TotalDebt("joe"), IsOkAndHolds(50));
 }
 
+TEST_F(TestDebtGraph, BuildFromSerializedProto) {
+  DebtList debt_list;
+  Transaction& t = *debt_list.add_transactions();
+  t.set_lender("alice");
+  t.set_receiver("bob");
+  t.set_cents(100);
+
+  const std::string serialized = debt_list.SerializeAsString();
+  DebtGraph graph;
+  ASSERT_OK_AND_ASSIGN(graph, DebtGraph::BuildFromSerializedProto(serialized));
+
+  EXPECT_THAT(graph.AmountOwed("alice", "bob"), IsOkAndHolds(100));
+  EXPECT_THAT(DebtGraph::BuildFromSerializedProto("\xff\xff"), Not(IsOk()));
+}
+
+TEST_F(TestDebtGraph, AllDebtsOnArena) {
+  DebtGraph graph;
+  ASSERT_OK_AND_ASSIGN(graph, CreateFromString(R"(
+    transactions {
+      lender: "alice"
+      receiver: "bob"
+      cents: 100
+    }
+    transactions {
+      lender: "bob"
+      receiver: "joe"
+      cents: 50
+    })"));
+
+  google::protobuf::Arena arena;
+  const DebtList* debts = graph.AllDebts(&arena);
+
+  EXPECT_EQ(debts->GetArena(), &arena);
+  EXPECT_EQ(debts->SerializeAsString(), graph.AllDebts().SerializeAsString());
+}
+
 TEST_F(TestAugmentedDebtGraph, TotalDebt) {
   DebtGraph graph;
   ASSERT_OK_AND_ASSIGN(graph, CreateFromString(R"(
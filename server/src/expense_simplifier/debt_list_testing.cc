@@ -0,0 +1,37 @@
+#include "server/src/expense_simplifier/debt_list_testing.h"
+
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "gtest/gtest.h"
+
+#include "proto/debts.pb.h"
+#include "server/src/expense_simplifier/debt_graph.h"
+#include "server/src/expense_simplifier/utils.h"
+
+namespace debt_simpl {
+
+DebtList DebtListOf(
+    const std::vector<std::tuple<std::string, std::string, Cents>>& debts) {
+  DebtList debt_list;
+  for (const auto& [lender, receiver, cents] : debts) {
+    Transaction& t = *debt_list.add_transactions();
+    t.set_lender(lender);
+    t.set_receiver(receiver);
+    t.set_cents(cents);
+  }
+  return debt_list;
+}
+
+DebtGraph GraphOf(
+    const std::vector<std::tuple<std::string, std::string, Cents>>& debts) {
+  absl::StatusOr<DebtGraph> graph =
+      DebtGraph::BuildFromProto(DebtListOf(debts));
+  EXPECT_THAT(graph, IsOk());
+  return *std::move(graph);
+}
+
+}  // namespace debt_simpl
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "proto/debts.pb.h"
+#include "server/src/expense_simplifier/debt_graph.h"
+
+namespace debt_simpl {
+
+// Returns the ledger of `debts`, given as (lender, receiver, cents).
+DebtList DebtListOf(
+    const std::vector<std::tuple<std::string, std::string, Cents>>& debts);
+
+// Same as above, as a graph.
+DebtGraph GraphOf(
+    const std::vector<std::tuple<std::string, std::string, Cents>>& debts);
+
+}  // namespace debt_simpl
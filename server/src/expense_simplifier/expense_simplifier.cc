@@ -1,29 +1,243 @@
 #include "server/src/expense_simplifier/expense_simplifier.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+
+#include "server/src/expense_simplifier/csr_graph.h"
 #include "server/src/expense_simplifier/debt_graph.h"
 #include "server/src/expense_simplifier/layered_graph.h"
+#include "server/src/expense_simplifier/push_relabel.h"
+#include "server/src/expense_simplifier/thread_pool.h"
+#include "server/src/expense_simplifier/zero_sum_partition.h"
 
 namespace debt_simpl {
 
-ExpenseSimplifier::ExpenseSimplifier(DebtGraph&& graph)
-    : simplified_expenses_(std::move(graph)) {
-  AugmentedDebtGraph augmented_graph(simplified_expenses_);
-  simplified_expenses_.Clear();
-  BuildMinimalTransactions(std::move(augmented_graph));
+namespace {
+
+// Computes a maximum flow from `source` to `sink` by repeatedly saturating
+// blocking flows in layered graphs, and applies it to `graph`.
+Cents BlockingFlowMaxFlow(CsrDebtGraph* graph, uint64_t source, uint64_t sink,
+                          BlockingFlowWorkspace* workspace) {
+  Cents total_flow = 0;
+  while (true) {
+    const LayeredGraph& blocking_flow =
+        LayeredGraph::ConstructBlockingFlow(*graph, source, sink, workspace);
+    if (blocking_flow.size() == 0) {
+      break;
+    }
+
+    uint64_t payer_id;
+    for (const LayeredGraphNode& node : blocking_flow) {
+      if (node.type == LayeredGraphNodeType::Head) {
+        payer_id = node.head.id;
+        continue;
+      }
+
+      const uint64_t neighbor_id =
+          blocking_flow[node.neighbor.neighbor_head_idx].head.id;
+      graph->PushFlow(neighbor_id, payer_id, node.neighbor.flow);
+    }
+
+    total_flow += blocking_flow.ComputeFlow();
+  }
+  return total_flow;
+}
+
+}  // namespace
+
+ExpenseSimplifier::ExpenseSimplifier(DebtGraph&& graph,
+                                     const ExpenseSimplifierOptions& options)
+    : options_(options), simplified_expenses_(std::move(graph)) {
+  SimplifierWorkspace workspace;
+  BuildMinimalTransactions(&workspace, nullptr);
+}
+
+ExpenseSimplifier::ExpenseSimplifier(DebtGraph&& graph,
+                                     const ExpenseSimplifierOptions& options,
+                                     SimplifierWorkspace* workspace)
+    : options_(options), simplified_expenses_(std::move(graph)) {
+  BuildMinimalTransactions(workspace, nullptr);
+}
+
+ExpenseSimplifier::ExpenseSimplifier(
+    DebtGraph&& graph, const ExpenseSimplifierOptions& options,
+    SimplifierWorkspace* workspace, const SettledDebtCallback& on_settled_debt)
+    : options_(options), simplified_expenses_(std::move(graph)) {
+  BuildMinimalTransactions(workspace, on_settled_debt);
 }
 
 const DebtGraph& ExpenseSimplifier::MinimalTransactions() const {
   return simplified_expenses_;
 }
 
-void ExpenseSimplifier::BuildMinimalTransactions(AugmentedDebtGraph&& graph) {
-  std::vector<DebtGraphEdge> edges = graph.AllDebts();
+bool ExpenseSimplifier::IsExact() const {
+  return exact_;
+}
+
+void ExpenseSimplifier::BuildMinimalTransactions(
+    SimplifierWorkspace* workspace,
+    const SettledDebtCallback& on_settled_debt) {
+  switch (options_.mode) {
+    case SimplificationMode::kExistingEdges:
+      break;
+    case SimplificationMode::kNetBalances:
+      SettleNetBalances(on_settled_debt);
+      return;
+    case SimplificationMode::kMinTransactions:
+      SettleMinTransactions(on_settled_debt);
+      return;
+  }
+
+  CsrDebtGraph& residual_graph = workspace->residual_graph;
+  residual_graph.Assign(simplified_expenses_);
+  simplified_expenses_.Clear();
+
+  // Clearing the graph keeps its users, so names can be looked up while it is
+  // rebuilt.
+  SettledEdgeCallback on_settled_edge;
+  if (on_settled_debt) {
+    on_settled_edge = [this, &on_settled_debt](const DebtGraphEdge& edge) {
+      on_settled_debt(simplified_expenses_.UserName(edge.lender_id),
+                      simplified_expenses_.UserName(edge.receiver_id),
+                      edge.debt);
+    };
+  }
+
+  std::vector<DebtGraphEdge> settled_edges;
+  if (options_.num_threads <= 1) {
+    settled_edges = SettleEdges(&residual_graph, options_.max_flow_algorithm,
+                                workspace, on_settled_edge);
+  } else {
+    settled_edges = SettleComponentsInParallel(residual_graph, workspace,
+                                               on_settled_edge);
+  }
+
+  for (const DebtGraphEdge& edge : settled_edges) {
+    simplified_expenses_.PushFlow(edge.receiver_id, edge.lender_id, edge.debt);
+  }
+}
+
+void ExpenseSimplifier::SettleNetBalances(
+    const SettledDebtCallback& on_settled_debt) {
+  std::vector<Balance> debtors;
+  std::vector<Balance> creditors;
+  for (uint64_t id = 0; id < simplified_expenses_.NumUsers(); id++) {
+    const Cents total_debt =
+        simplified_expenses_.DebtGraphInternal::TotalDebt(id);
+    if (total_debt > 0) {
+      debtors.emplace_back(total_debt, id);
+    } else if (total_debt < 0) {
+      creditors.emplace_back(-total_debt, id);
+    }
+  }
+
+  // Clearing the graph keeps its users, so names can be looked up while it is
+  // rebuilt.
+  simplified_expenses_.Clear();
+  MatchLargestBalances(std::move(debtors), std::move(creditors),
+                       on_settled_debt);
+}
+
+void ExpenseSimplifier::SettleMinTransactions(
+    const SettledDebtCallback& on_settled_debt) {
+  std::vector<uint64_t> ids;
+  std::vector<Cents> balances;
+  for (uint64_t id = 0; id < simplified_expenses_.NumUsers(); id++) {
+    const Cents total_debt =
+        simplified_expenses_.DebtGraphInternal::TotalDebt(id);
+    if (total_debt != 0) {
+      ids.push_back(id);
+      balances.push_back(total_debt);
+    }
+  }
+
+  const std::optional<std::vector<uint32_t>> subsets =
+      PartitionIntoZeroSumSubsets(balances, options_.max_exact_balances,
+                                  absl::Now() + options_.exact_time_budget);
+  if (!subsets.has_value()) {
+    SettleNetBalances(on_settled_debt);
+    return;
+  }
+  exact_ = true;
+
+  uint32_t num_subsets = 0;
+  for (const uint32_t subset : *subsets) {
+    num_subsets = std::max(num_subsets, subset + 1);
+  }
+  std::vector<std::vector<Balance>> debtors(num_subsets);
+  std::vector<std::vector<Balance>> creditors(num_subsets);
+  for (size_t i = 0; i < ids.size(); i++) {
+    if (balances[i] > 0) {
+      debtors[(*subsets)[i]].emplace_back(balances[i], ids[i]);
+    } else {
+      creditors[(*subsets)[i]].emplace_back(-balances[i], ids[i]);
+    }
+  }
+
+  // Each subset of k users is settled on its own, in at most k - 1
+  // transactions.
+  simplified_expenses_.Clear();
+  for (uint32_t subset = 0; subset < num_subsets; subset++) {
+    MatchLargestBalances(std::move(debtors[subset]),
+                         std::move(creditors[subset]), on_settled_debt);
+  }
+}
+
+void ExpenseSimplifier::MatchLargestBalances(
+    std::vector<Balance> debtors, std::vector<Balance> creditors,
+    const SettledDebtCallback& on_settled_debt) {
+  // Ties go to the larger id, which keeps results deterministic.
+  std::priority_queue<Balance> debtor_heap(std::less<Balance>(),
+                                           std::move(debtors));
+  std::priority_queue<Balance> creditor_heap(std::less<Balance>(),
+                                             std::move(creditors));
+
+  // Every transfer evens out at least one of the two users, so there are at
+  // most n - 1 of them.
+  while (!debtor_heap.empty() && !creditor_heap.empty()) {
+    auto [owed, debtor_id] = debtor_heap.top();
+    debtor_heap.pop();
+    auto [credit, creditor_id] = creditor_heap.top();
+    creditor_heap.pop();
+
+    const Cents cents = std::min(owed, credit);
+    simplified_expenses_.PushFlow(debtor_id, creditor_id, cents);
+    if (on_settled_debt) {
+      on_settled_debt(simplified_expenses_.UserName(creditor_id),
+                      simplified_expenses_.UserName(debtor_id), cents);
+    }
+
+    if (owed > cents) {
+      debtor_heap.emplace(owed - cents, debtor_id);
+    }
+    if (credit > cents) {
+      creditor_heap.emplace(credit - cents, creditor_id);
+    }
+  }
+}
+
+// static
+std::vector<DebtGraphEdge> ExpenseSimplifier::SettleEdges(
+    CsrDebtGraph* graph, MaxFlowAlgorithm algorithm,
+    SimplifierWorkspace* workspace,
+    const SettledEdgeCallback& on_settled_edge) {
+  std::vector<DebtGraphEdge> edges = graph->AllDebts();
   std::sort(edges.begin(), edges.end(),
-            [&graph](const DebtGraphEdge& e1, const DebtGraphEdge& e2) {
-              Cents dl1 = graph.TotalDebt(e1.lender_id);
-              Cents dr1 = graph.TotalDebt(e1.receiver_id);
-              Cents dl2 = graph.TotalDebt(e2.lender_id);
-              Cents dr2 = graph.TotalDebt(e2.receiver_id);
+            [graph](const DebtGraphEdge& e1, const DebtGraphEdge& e2) {
+              Cents dl1 = graph->TotalDebt(e1.lender_id);
+              Cents dr1 = graph->TotalDebt(e1.receiver_id);
+              Cents dl2 = graph->TotalDebt(e2.lender_id);
+              Cents dr2 = graph->TotalDebt(e2.receiver_id);
 
               uint32_t score1 = (dl1 < 0) + (dr1 > 0);
               uint32_t score2 = (dl2 < 0) + (dr2 > 0);
@@ -35,6 +249,7 @@ void ExpenseSimplifier::BuildMinimalTransactions(AugmentedDebtGraph&& graph) {
                                                  : e1.debt < e2.debt);
             });
 
+  std::vector<DebtGraphEdge> settled_edges;
   while (!edges.empty()) {
     const DebtGraphEdge edge = edges.back();
     edges.pop_back();
@@ -42,37 +257,173 @@ void ExpenseSimplifier::BuildMinimalTransactions(AugmentedDebtGraph&& graph) {
     const uint64_t lender_id = edge.lender_id;
     const uint64_t receiver_id = edge.receiver_id;
 
-    const Cents debt = graph.Debt(receiver_id, lender_id);
+    const Cents debt = graph->Debt(receiver_id, lender_id);
     if (debt == 0) {
       continue;
     }
 
-    uint64_t total_flow = 0;
-    while (true) {
-      const LayeredGraph blocking_flow =
-          LayeredGraph::ConstructBlockingFlow(graph, receiver_id, lender_id);
-      if (blocking_flow.size() == 0) {
+    Cents total_flow = 0;
+    switch (algorithm) {
+      case MaxFlowAlgorithm::kBlockingFlow: {
+        total_flow = BlockingFlowMaxFlow(graph, receiver_id, lender_id,
+                                         &workspace->blocking_flow);
         break;
       }
+      case MaxFlowAlgorithm::kPushRelabel: {
+        total_flow =
+            workspace->push_relabel.MaxFlow(graph, receiver_id, lender_id);
+        break;
+      }
+    }
 
-      uint64_t payer_id;
-      for (const LayeredGraphNode& node : blocking_flow) {
-        if (node.type == LayeredGraphNodeType::Head) {
-          payer_id = node.head.id;
-          continue;
-        }
+    graph->SettleFlows();
+    graph->EraseEdge(lender_id, receiver_id);
+    settled_edges.push_back(DebtGraphEdge{ .receiver_id = receiver_id,
+                                           .lender_id = lender_id,
+                                           .debt = total_flow });
+    if (on_settled_edge) {
+      on_settled_edge(settled_edges.back());
+    }
+  }
+  return settled_edges;
+}
+
+std::vector<DebtGraphEdge> ExpenseSimplifier::SettleComponentsInParallel(
+    const CsrDebtGraph& graph, SimplifierWorkspace* workspace,
+    const SettledEdgeCallback& on_settled_edge) const {
+  const uint64_t num_users = graph.NumUsers();
 
-        const uint64_t neighbor_id =
-            blocking_flow[node.neighbor.neighbor_head_idx].head.id;
-        graph.PushFlow(neighbor_id, payer_id, node.neighbor.flow);
+  // Label every user with its component and its index within it. Users are
+  // visited in increasing id order, so each component's user list is sorted.
+  constexpr uint64_t kUnassigned = UINT64_MAX;
+  std::vector<uint64_t> component_of(num_users, kUnassigned);
+  std::vector<uint64_t> local_ids(num_users);
+  std::vector<std::vector<uint64_t>> components;
+  std::vector<uint64_t> queue;
+  for (uint64_t root = 0; root < num_users; root++) {
+    if (component_of[root] != kUnassigned ||
+        graph.EdgeBegin(root) == graph.EdgeEnd(root)) {
+      continue;
+    }
+
+    const uint64_t component = components.size();
+    components.emplace_back();
+    queue.clear();
+    queue.push_back(root);
+    component_of[root] = component;
+    for (uint64_t i = 0; i < queue.size(); i++) {
+      const uint64_t id = queue[i];
+      for (uint64_t edge = graph.EdgeBegin(id); edge < graph.EdgeEnd(id);
+           edge++) {
+        const uint64_t neighbor_id = graph.Neighbor(edge);
+        if (component_of[neighbor_id] == kUnassigned) {
+          component_of[neighbor_id] = component;
+          queue.push_back(neighbor_id);
+        }
       }
+    }
+  }
+  for (uint64_t id = 0; id < num_users; id++) {
+    if (component_of[id] != kUnassigned) {
+      std::vector<uint64_t>& users = components[component_of[id]];
+      local_ids[id] = users.size();
+      users.push_back(id);
+    }
+  }
+
+  // Group small components into tasks so that ledgers made of many tiny
+  // groups don't pay scheduling overhead per component.
+  constexpr uint64_t kMinEdgesPerTask = 1024;
+  std::vector<std::vector<uint64_t>> tasks;
+  uint64_t task_edges = kMinEdgesPerTask;
+  for (uint64_t component = 0; component < components.size(); component++) {
+    if (task_edges >= kMinEdgesPerTask) {
+      tasks.emplace_back();
+      task_edges = 0;
+    }
+    tasks.back().push_back(component);
+    for (const uint64_t id : components[component]) {
+      task_edges += graph.EdgeEnd(id) - graph.EdgeBegin(id);
+    }
+  }
 
-      total_flow += blocking_flow.ComputeFlow();
+  std::vector<std::vector<DebtGraphEdge>> component_results(components.size());
+  absl::Mutex callback_mutex;
+  std::atomic<uint64_t> next_task = 0;
+  const auto settle_tasks = [&](SimplifierWorkspace* workspace) {
+    for (uint64_t i = next_task++; i < tasks.size(); i = next_task++) {
+      for (const uint64_t component : tasks[i]) {
+        const std::vector<uint64_t>& users = components[component];
+        CsrDebtGraph subgraph(graph, users, local_ids);
+        SettledEdgeCallback on_settled_subgraph_edge;
+        if (on_settled_edge) {
+          on_settled_subgraph_edge = [&](const DebtGraphEdge& edge) {
+            absl::MutexLock lock(&callback_mutex);
+            on_settled_edge(
+                DebtGraphEdge{ .receiver_id = users[edge.receiver_id],
+                               .lender_id = users[edge.lender_id],
+                               .debt = edge.debt });
+          };
+        }
+        std::vector<DebtGraphEdge>& result = component_results[component];
+        result = SettleEdges(&subgraph, options_.max_flow_algorithm,
+                             workspace, on_settled_subgraph_edge);
+        for (DebtGraphEdge& edge : result) {
+          edge.receiver_id = users[edge.receiver_id];
+          edge.lender_id = users[edge.lender_id];
+        }
+      }
     }
+  };
+
+  std::optional<ThreadPool> own_pool;
+  ThreadPool* pool = options_.thread_pool;
+  if (pool == nullptr) {
+    pool = &own_pool.emplace(options_.num_threads - 1);
+  }
+  const uint64_t num_helpers = std::min<uint64_t>(
+      { options_.num_threads - 1, pool->NumThreads(),
+        std::max<uint64_t>(tasks.size(), 1) - 1 });
+
+  // The pool may be busy, or even be running this call, so the calling
+  // thread settles tasks too rather than waiting on helpers that may never
+  // start. Helpers that start once it is done return without touching
+  // anything of this call but `helpers`.
+  struct Helpers {
+    absl::Mutex mutex;
+    uint64_t num_running ABSL_GUARDED_BY(mutex) = 0;
+    bool done ABSL_GUARDED_BY(mutex) = false;
+  };
+  auto helpers = std::make_shared<Helpers>();
+  std::vector<SimplifierWorkspace> workspaces(pool->NumThreads());
+  for (uint64_t i = 0; i < num_helpers; i++) {
+    pool->Schedule([&, helpers]() {
+      {
+        absl::MutexLock lock(&helpers->mutex);
+        if (helpers->done) {
+          return;
+        }
+        helpers->num_running++;
+      }
+      settle_tasks(&workspaces[ThreadPool::CurrentWorkerIndex()]);
+      absl::MutexLock lock(&helpers->mutex);
+      helpers->num_running--;
+    });
+  }
+  settle_tasks(workspace);
+  {
+    absl::MutexLock lock(&helpers->mutex);
+    helpers->done = true;
+    helpers->mutex.Await(absl::Condition(
+        +[](uint64_t* num_running) { return *num_running == 0; },
+        &helpers->num_running));
+  }
 
-    graph.EraseEdge(lender_id, receiver_id);
-    simplified_expenses_.PushFlow(receiver_id, lender_id, total_flow);
+  std::vector<DebtGraphEdge> settled_edges;
+  for (const std::vector<DebtGraphEdge>& result : component_results) {
+    settled_edges.insert(settled_edges.end(), result.begin(), result.end());
   }
+  return settled_edges;
 }
 
 }  // namespace debt_simpl
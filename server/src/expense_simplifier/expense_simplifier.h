@@ -1,23 +1,158 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <utility>
 #include <vector>
 
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+
+#include "server/src/expense_simplifier/csr_graph.h"
 #include "server/src/expense_simplifier/debt_graph.h"
+#include "server/src/expense_simplifier/layered_graph.h"
+#include "server/src/expense_simplifier/push_relabel.h"
+#include "server/src/expense_simplifier/thread_pool.h"
 
 namespace debt_simpl {
 
+enum class MaxFlowAlgorithm {
+  // Dinic-style blocking flows over layered graphs. Works well on sparse
+  // ledgers with short augmenting paths.
+  kBlockingFlow,
+  // Highest-label push-relabel with global relabeling and the gap heuristic.
+  // Works well on dense ledgers where everyone owes everyone.
+  kPushRelabel,
+};
+
+enum class SimplificationMode {
+  // Reroutes debts over the edges of the ledger with max-flow, so nobody ends
+  // up paying someone they didn't already have a debt with.
+  kExistingEdges,
+  // Settles net balances directly, with the largest debtor paying the largest
+  // creditor until everyone is even. Anyone may end up paying anyone, but it
+  // takes O(n log n) time and needs at most n - 1 transactions for n users.
+  kNetBalances,
+  // Settles net balances directly like `kNetBalances`, but in the fewest
+  // transactions possible, by splitting the users into the most groups whose
+  // balances sum to zero. The search is exponential in the number of users
+  // left once opposite balances are paired off, so past
+  // `max_exact_balances` of them or `exact_time_budget`, it falls back to
+  // `kNetBalances`.
+  kMinTransactions,
+};
+
+struct ExpenseSimplifierOptions {
+  SimplificationMode mode = SimplificationMode::kExistingEdges;
+
+  // Bounds the search of `kMinTransactions` mode. 20 balances take about
+  // 10ms and 1 MiB to search, and every 5 more about 40 times as much.
+  uint32_t max_exact_balances = 20;
+  absl::Duration exact_time_budget = absl::Milliseconds(50);
+
+  // The max-flow engine used to reroute each debt.
+  MaxFlowAlgorithm max_flow_algorithm = MaxFlowAlgorithm::kBlockingFlow;
+
+  // The number of threads used to simplify independent parts of the graph, in
+  // `kExistingEdges` mode.
+  // Weakly connected components never share an edge, so they are solved
+  // concurrently and their results merged once all are done. With 1 thread,
+  // everything runs on the calling thread.
+  uint32_t num_threads = 1;
+
+  // The pool the other `num_threads` - 1 threads are taken from, which may be
+  // busy with other work, including the simplification itself. If null, a
+  // pool is made for each simplification. Must outlive the simplifier.
+  ThreadPool* thread_pool = nullptr;
+};
+
+// Scratch state of the residual graph and max-flow engines, reused across every
+// edge simplified with it. Each thread simplifying a graph needs its own.
+struct SimplifierWorkspace {
+  CsrDebtGraph residual_graph;
+  BlockingFlowWorkspace blocking_flow;
+  PushRelabelMaxFlow push_relabel;
+};
+
 class ExpenseSimplifier {
+  friend class IncrementalSimplifier;
   friend class TestExpenseSimplifier;
 
  public:
-  explicit ExpenseSimplifier(DebtGraph&& graph);
+  // Receives a debt of the minimal transactions, that `receiver` owes `lender`
+  // `cents`.
+  using SettledDebtCallback = std::function<void(
+      absl::string_view lender, absl::string_view receiver, Cents cents)>;
+
+  explicit ExpenseSimplifier(DebtGraph&& graph,
+                             const ExpenseSimplifierOptions& options = {});
+
+  // Same as above, but builds the residual graph and runs the single-threaded
+  // max-flow computations in `workspace`, reusing whatever buffers an earlier
+  // simplification left allocated there.
+  ExpenseSimplifier(DebtGraph&& graph, const ExpenseSimplifierOptions& options,
+                    SimplifierWorkspace* workspace);
+
+  // Same as above, but also passes every debt of the minimal transactions to
+  // `on_settled_debt` as soon as it is final, long before the whole graph is
+  // simplified. With several threads, it is called from the workers, though
+  // never concurrently.
+  ExpenseSimplifier(DebtGraph&& graph, const ExpenseSimplifierOptions& options,
+                    SimplifierWorkspace* workspace,
+                    const SettledDebtCallback& on_settled_debt);
 
   const DebtGraph& MinimalTransactions() const;
 
+  // Returns whether `kMinTransactions` mode found the fewest transactions,
+  // rather than falling back to `kNetBalances`.
+  bool IsExact() const;
+
  private:
-  void BuildMinimalTransactions(AugmentedDebtGraph&& graph);
+  // Called with each settled edge, in the ids of the graph being settled.
+  using SettledEdgeCallback = std::function<void(const DebtGraphEdge& edge)>;
+
+  void BuildMinimalTransactions(SimplifierWorkspace* workspace,
+                                const SettledDebtCallback& on_settled_debt);
+
+  // (amount, user id) of what a user owes or is owed on balance.
+  using Balance = std::pair<Cents, uint64_t>;
+
+  // Replaces the debts of `simplified_expenses_` with transfers from the
+  // users who owe money on balance to the ones who are owed, matching the
+  // largest of each first.
+  void SettleNetBalances(const SettledDebtCallback& on_settled_debt);
+
+  // Same as above, but first splits the users into the most groups whose
+  // balances sum to zero, and settles each on its own.
+  void SettleMinTransactions(const SettledDebtCallback& on_settled_debt);
+
+  // Adds transfers from `debtors` to `creditors`, whose balances sum to the
+  // same, to `simplified_expenses_`, largest balances first.
+  void MatchLargestBalances(std::vector<Balance> debtors,
+                            std::vector<Balance> creditors,
+                            const SettledDebtCallback& on_settled_debt);
+
+  // Reroutes the debt of every edge in `graph` onto as few edges as possible,
+  // returning the debts that remain. `graph` is left empty. Edges are never
+  // settled twice, so each is final once passed to `on_settled_edge`, if set.
+  static std::vector<DebtGraphEdge> SettleEdges(
+      CsrDebtGraph* graph, MaxFlowAlgorithm algorithm,
+      SimplifierWorkspace* workspace,
+      const SettledEdgeCallback& on_settled_edge = nullptr);
+
+  // Splits `graph` into weakly connected components and settles them
+  // concurrently on the calling thread, which uses `workspace`, and up to
+  // `options_.num_threads` - 1 workers of the pool, passing settled edges to
+  // `on_settled_edge` one at a time.
+  std::vector<DebtGraphEdge> SettleComponentsInParallel(
+      const CsrDebtGraph& graph, SimplifierWorkspace* workspace,
+      const SettledEdgeCallback& on_settled_edge) const;
+
+  ExpenseSimplifierOptions options_;
 
   DebtGraph simplified_expenses_;
+
+  bool exact_ = false;
 };
 
 }  // namespace debt_simpl
@@ -0,0 +1,307 @@
+#include <cstdint>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+#include "benchmark/benchmark.h"
+
+#include "proto/debts.pb.h"
+#include "server/src/expense_simplifier/csr_graph.h"
+#include "server/src/expense_simplifier/debt_graph.h"
+#include "server/src/expense_simplifier/expense_simplifier.h"
+#include "server/src/expense_simplifier/layered_graph.h"
+#include "server/src/expense_simplifier/ledger_snapshot.h"
+#include "server/src/expense_simplifier/zero_sum_partition.h"
+#include "server/src/ledger_generator/ledger_generator.h"
+
+namespace debt_simpl {
+namespace {
+
+enum class LedgerShape {
+  // Every user lends to the next one.
+  kChain,
+  // One user lends to everyone else.
+  kStar,
+  // Every pair of users has lent to each other.
+  kClique,
+  // Random transactions between users picked from a Zipf distribution, so a
+  // few users take part in most of them, like in real group ledgers.
+  kPowerLaw,
+  // Power-law ledgers of many groups of 10 users, sparsely linked to each
+  // other, like a service hosting many groups.
+  kGroups,
+};
+
+// Transactions per user in generated ledgers.
+constexpr uint64_t kPowerLawDegree = 4;
+
+constexpr uint64_t kUsersPerGroup = 10;
+
+const char* ShapeName(LedgerShape shape) {
+  switch (shape) {
+    case LedgerShape::kChain:
+      return "chain";
+    case LedgerShape::kStar:
+      return "star";
+    case LedgerShape::kClique:
+      return "clique";
+    case LedgerShape::kPowerLaw:
+      return "power_law";
+    case LedgerShape::kGroups:
+      return "groups";
+  }
+  return "";
+}
+
+void AddTransaction(uint64_t lender, uint64_t receiver, Cents cents,
+                    DebtList* ledger) {
+  Transaction& t = *ledger->add_transactions();
+  t.set_lender(absl::StrCat("user", lender));
+  t.set_receiver(absl::StrCat("user", receiver));
+  t.set_cents(cents);
+}
+
+DebtList BuildLedger(LedgerShape shape, uint64_t num_users) {
+  std::mt19937_64 rng(num_users);
+  std::uniform_int_distribution<Cents> cents(1, 100000);
+
+  DebtList ledger;
+  switch (shape) {
+    case LedgerShape::kChain: {
+      for (uint64_t i = 0; i + 1 < num_users; i++) {
+        AddTransaction(i, i + 1, cents(rng), &ledger);
+      }
+      break;
+    }
+    case LedgerShape::kStar: {
+      for (uint64_t i = 1; i < num_users; i++) {
+        AddTransaction(0, i, cents(rng), &ledger);
+      }
+      break;
+    }
+    case LedgerShape::kClique: {
+      for (uint64_t i = 0; i < num_users; i++) {
+        for (uint64_t j = i + 1; j < num_users; j++) {
+          AddTransaction(i, j, cents(rng), &ledger);
+        }
+      }
+      break;
+    }
+    case LedgerShape::kPowerLaw:
+    case LedgerShape::kGroups: {
+      const bool groups = shape == LedgerShape::kGroups;
+      absl::StatusOr<DebtList> generated = GenerateDebtList({
+          .num_users = num_users,
+          .num_transactions = kPowerLawDegree * num_users,
+          .degree_distribution = DegreeDistribution::kPowerLaw,
+          .num_groups = groups ? num_users / kUsersPerGroup : 1,
+          .cross_group_probability = groups ? 0.01 : 0.0,
+          .seed = num_users,
+      });
+      ledger = *std::move(generated);
+      break;
+    }
+  }
+  return ledger;
+}
+
+// Benchmark functions run several times while calibrating iteration counts,
+// so ledgers are built once per shape and size.
+const DebtList& Ledger(LedgerShape shape, uint64_t num_users) {
+  static auto* ledgers =
+      new std::map<std::pair<LedgerShape, uint64_t>, DebtList>();
+  const auto key = std::make_pair(shape, num_users);
+  auto it = ledgers->find(key);
+  if (it == ledgers->end()) {
+    it = ledgers->emplace(key, BuildLedger(shape, num_users)).first;
+  }
+  return it->second;
+}
+
+DebtGraph Graph(LedgerShape shape, uint64_t num_users) {
+  absl::StatusOr<DebtGraph> graph =
+      DebtGraph::BuildFromProto(Ledger(shape, num_users));
+  return *std::move(graph);
+}
+
+// Registers every shape at 10, 100, ... up to `max_users` users, except for
+// cliques, whose number of transactions is quadratic, which stop at
+// `max_clique_users`. Any extra arguments are appended after the shape and
+// user count.
+void AllShapes(benchmark::internal::Benchmark* benchmark, int64_t max_users,
+               int64_t max_clique_users,
+               const std::vector<int64_t>& extra_args = {}) {
+  for (const LedgerShape shape :
+       { LedgerShape::kChain, LedgerShape::kStar, LedgerShape::kClique,
+         LedgerShape::kPowerLaw, LedgerShape::kGroups }) {
+    for (int64_t num_users = 10; num_users <= max_users; num_users *= 10) {
+      if (shape == LedgerShape::kClique && num_users > max_clique_users) {
+        break;
+      }
+      std::vector<int64_t> args = { static_cast<int64_t>(shape), num_users };
+      args.insert(args.end(), extra_args.begin(), extra_args.end());
+      benchmark->Args(args);
+    }
+  }
+  benchmark->Unit(benchmark::kMicrosecond);
+}
+
+void BM_BuildFromProto(benchmark::State& state) {
+  const LedgerShape shape = static_cast<LedgerShape>(state.range(0));
+  const DebtList& ledger = Ledger(shape, state.range(1));
+
+  for (auto _ : state) {
+    absl::StatusOr<DebtGraph> graph = DebtGraph::BuildFromProto(ledger);
+    benchmark::DoNotOptimize(graph);
+  }
+  state.SetItemsProcessed(state.iterations() * ledger.transactions_size());
+  state.SetLabel(ShapeName(shape));
+}
+BENCHMARK(BM_BuildFromProto)
+    ->ArgNames({ "shape", "users" })
+    ->Apply([](benchmark::internal::Benchmark* b) {
+      AllShapes(b, 1000000, 1000);
+    });
+
+void BM_LoadLedgerSnapshot(benchmark::State& state) {
+  const LedgerShape shape = static_cast<LedgerShape>(state.range(0));
+  const DebtGraph graph = Graph(shape, state.range(1));
+  const std::string buffer = LedgerSnapshot::Serialize(graph);
+
+  for (auto _ : state) {
+    absl::StatusOr<LedgerSnapshot> snapshot =
+        LedgerSnapshot::FromBuffer(buffer);
+    absl::StatusOr<DebtGraph> loaded = snapshot->ToDebtGraph();
+    benchmark::DoNotOptimize(loaded);
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          LedgerSnapshot::FromBuffer(buffer)->NumDebts());
+  state.SetLabel(ShapeName(shape));
+}
+// Compare with BM_BuildFromProto: both end with the same graph.
+BENCHMARK(BM_LoadLedgerSnapshot)
+    ->ArgNames({ "shape", "users" })
+    ->Apply([](benchmark::internal::Benchmark* b) {
+      AllShapes(b, 1000000, 1000);
+    });
+
+void BM_ConstructBlockingFlow(benchmark::State& state) {
+  const LedgerShape shape = static_cast<LedgerShape>(state.range(0));
+  const DebtList& ledger = Ledger(shape, state.range(1));
+  const DebtGraph graph = Graph(shape, state.range(1));
+  const CsrDebtGraph residual_graph(graph);
+
+  // Route the first transaction's debt, which has at least the direct edge
+  // between its users to work with.
+  const uint64_t source = *graph.FindUserId(ledger.transactions(0).receiver());
+  const uint64_t sink = *graph.FindUserId(ledger.transactions(0).lender());
+  BlockingFlowWorkspace workspace;
+  for (auto _ : state) {
+    const LayeredGraph& blocking_flow = LayeredGraph::ConstructBlockingFlow(
+        residual_graph, source, sink, &workspace);
+    benchmark::DoNotOptimize(blocking_flow.size());
+  }
+  state.SetLabel(ShapeName(shape));
+}
+BENCHMARK(BM_ConstructBlockingFlow)
+    ->ArgNames({ "shape", "users" })
+    ->Apply([](benchmark::internal::Benchmark* b) {
+      AllShapes(b, 1000000, 1000);
+    });
+
+// Arguments: shape, users, max-flow algorithm, threads.
+void BM_ExpenseSimplifier(benchmark::State& state) {
+  const LedgerShape shape = static_cast<LedgerShape>(state.range(0));
+  const DebtGraph graph = Graph(shape, state.range(1));
+  const ExpenseSimplifierOptions options = {
+    .max_flow_algorithm = static_cast<MaxFlowAlgorithm>(state.range(2)),
+    .num_threads = static_cast<uint32_t>(state.range(3)),
+  };
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    DebtGraph copy = graph;
+    state.ResumeTiming();
+
+    ExpenseSimplifier simplifier(std::move(copy), options);
+    benchmark::DoNotOptimize(simplifier.MinimalTransactions());
+  }
+  state.SetLabel(absl::StrCat(
+      ShapeName(shape),
+      options.max_flow_algorithm == MaxFlowAlgorithm::kBlockingFlow
+          ? "/blocking_flow"
+          : "/push_relabel",
+      "/threads:", options.num_threads));
+}
+// Simplification settles every edge with its own max-flow computation, so the
+// largest sizes are left to the cheaper benchmarks above.
+BENCHMARK(BM_ExpenseSimplifier)
+    ->ArgNames({ "shape", "users", "algorithm", "threads" })
+    ->Apply([](benchmark::internal::Benchmark* b) {
+      for (const MaxFlowAlgorithm algorithm :
+           { MaxFlowAlgorithm::kBlockingFlow,
+             MaxFlowAlgorithm::kPushRelabel }) {
+        AllShapes(b, 10000, 100, { static_cast<int64_t>(algorithm), 1 });
+      }
+      AllShapes(b, 10000, 100,
+                { static_cast<int64_t>(MaxFlowAlgorithm::kBlockingFlow), 4 });
+    })
+    ->UseRealTime();
+
+void BM_NetBalances(benchmark::State& state) {
+  const LedgerShape shape = static_cast<LedgerShape>(state.range(0));
+  const DebtGraph graph = Graph(shape, state.range(1));
+  const ExpenseSimplifierOptions options = {
+    .mode = SimplificationMode::kNetBalances,
+  };
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    DebtGraph copy = graph;
+    state.ResumeTiming();
+
+    ExpenseSimplifier simplifier(std::move(copy), options);
+    benchmark::DoNotOptimize(simplifier.MinimalTransactions());
+  }
+  state.SetLabel(ShapeName(shape));
+}
+// Greedy matching never runs max-flow, so it keeps up with graph building.
+BENCHMARK(BM_NetBalances)
+    ->ArgNames({ "shape", "users" })
+    ->Apply([](benchmark::internal::Benchmark* b) {
+      AllShapes(b, 1000000, 1000);
+    })
+    ->UseRealTime();
+
+void BM_ZeroSumPartition(benchmark::State& state) {
+  // Random balances rarely split into many zero-sum subsets, nor have
+  // opposites to pair off, so this is close to the worst case.
+  std::mt19937_64 rng(0);
+  std::uniform_int_distribution<Cents> cents(-10000, 10000);
+  std::vector<Cents> balances(state.range(0));
+  Cents total = 0;
+  for (size_t i = 0; i + 1 < balances.size(); i++) {
+    balances[i] = cents(rng);
+    total += balances[i];
+  }
+  balances.back() = -total;
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(PartitionIntoZeroSumSubsets(
+        balances, balances.size(), absl::InfiniteFuture()));
+  }
+}
+BENCHMARK(BM_ZeroSumPartition)
+    ->ArgName("balances")
+    ->DenseRange(10, 25, 5)
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace debt_simpl
+
+BENCHMARK_MAIN();
@@ -1,13 +1,20 @@
 #include "server/src/expense_simplifier/expense_simplifier.h"
 
+#include <algorithm>
 #include <iostream>
+#include <map>
+#include <optional>
 #include <stdint.h>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "google/protobuf/text_format.h"
 #include "gtest/gtest.h"
 
 #include "server/src/expense_simplifier/debt_graph.h"
+#include "server/src/expense_simplifier/random_ledger_testing.h"
+#include "server/src/expense_simplifier/thread_pool.h"
 #include "server/src/expense_simplifier/utils.h"
 
 namespace debt_simpl {
@@ -17,7 +24,8 @@ using google::protobuf::TextFormat;
 class TestExpenseSimplifier : public ::testing::Test {
  protected:
   absl::StatusOr<ExpenseSimplifier> CreateFromString(
-      absl::string_view debt_list_proto) {
+      absl::string_view debt_list_proto,
+      const ExpenseSimplifierOptions& options = {}) {
     DebtList debt_list;
     if (!TextFormat::ParseFromString(debt_list_proto, &debt_list)) {
       return absl::InternalError(
@@ -27,7 +35,23 @@ class TestExpenseSimplifier : public ::testing::Test {
 
     DEFINE_OR_RETURN(DebtGraph, graph, DebtGraph::BuildFromProto(debt_list));
 
-    return ExpenseSimplifier(std::move(graph));
+    return ExpenseSimplifier(std::move(graph), options);
+  }
+
+  // Checks that `simplified` settles the same net balances as `original`
+  // using only debts between users who already owed each other.
+  static void ExpectValidSimplification(const DebtGraph& original,
+                                        const DebtGraph& simplified) {
+    ASSERT_EQ(original.NumUsers(), simplified.NumUsers());
+    for (uint64_t id = 0; id < original.NumUsers(); id++) {
+      EXPECT_EQ(original.DebtGraphInternal::TotalDebt(id),
+                simplified.DebtGraphInternal::TotalDebt(id));
+    }
+    for (const DebtGraphEdge& edge : simplified.DebtGraphInternal::AllDebts()) {
+      if (edge.debt > 0) {
+        EXPECT_GT(original.Debt(edge.receiver_id, edge.lender_id), 0);
+      }
+    }
   }
 };
 
@@ -284,4 +308,238 @@ TEST_F(TestExpenseSimplifier, UndoFlow) {
               IsOkAndHolds(1));
 }
 
+TEST_F(TestExpenseSimplifier, PushRelabelTriangleReduced) {
+  ASSERT_OK_AND_DEFINE(
+      ExpenseSimplifier, solver,
+      CreateFromString(R"(
+    transactions {
+      lender: "a"
+      receiver: "b"
+      cents: 100
+    }
+    transactions {
+      lender: "b"
+      receiver: "c"
+      cents: 100
+    }
+    transactions {
+      lender: "a"
+      receiver: "c"
+      cents: 100
+    })",
+          { .max_flow_algorithm = MaxFlowAlgorithm::kPushRelabel }));
+
+  EXPECT_THAT(solver.MinimalTransactions().AmountOwed("a", "b"),
+              IsOkAndHolds(0));
+  EXPECT_THAT(solver.MinimalTransactions().AmountOwed("b", "c"),
+              IsOkAndHolds(0));
+  EXPECT_THAT(solver.MinimalTransactions().AmountOwed("a", "c"),
+              IsOkAndHolds(200));
+}
+
+TEST_F(TestExpenseSimplifier, RandomGraphsSimplified) {
+  for (const MaxFlowAlgorithm algorithm :
+       { MaxFlowAlgorithm::kBlockingFlow, MaxFlowAlgorithm::kPushRelabel }) {
+    for (uint32_t seed = 0; seed < 20; seed++) {
+      DebtGraph graph = RandomGraph(20, 100, seed);
+      const DebtGraph original = graph;
+
+      ExpenseSimplifier solver(std::move(graph),
+                               { .max_flow_algorithm = algorithm });
+      SCOPED_TRACE(absl::StrFormat("algorithm %d, seed %d",
+                                   static_cast<int>(algorithm), seed));
+      ExpectValidSimplification(original, solver.MinimalTransactions());
+    }
+  }
+}
+
+TEST_F(TestExpenseSimplifier, ComponentsSimplifiedInParallel) {
+  for (const MaxFlowAlgorithm algorithm :
+       { MaxFlowAlgorithm::kBlockingFlow, MaxFlowAlgorithm::kPushRelabel }) {
+    for (uint32_t seed = 0; seed < 10; seed++) {
+      // Sparse enough to fall apart into many components of varying size.
+      DebtGraph graph = RandomGraph(400, 300, seed);
+      const DebtGraph original = graph;
+
+      ExpenseSimplifier solver(
+          std::move(graph),
+          { .max_flow_algorithm = algorithm, .num_threads = 4 });
+      SCOPED_TRACE(absl::StrFormat("algorithm %d, seed %d",
+                                   static_cast<int>(algorithm), seed));
+      ExpectValidSimplification(original, solver.MinimalTransactions());
+    }
+  }
+}
+
+TEST_F(TestExpenseSimplifier, ComponentsSimplifiedOnSharedPool) {
+  ThreadPool pool(2);
+  constexpr uint32_t kNumGraphs = 8;
+  std::vector<DebtGraph> originals;
+  std::vector<std::optional<DebtGraph>> simplified(kNumGraphs);
+  for (uint32_t seed = 0; seed < kNumGraphs; seed++) {
+    originals.push_back(RandomGraph(400, 300, seed));
+  }
+  // Every worker is busy with a simplification that wants the pool to itself.
+  for (uint32_t i = 0; i < kNumGraphs; i++) {
+    pool.Schedule([&, i]() {
+      DebtGraph graph = originals[i];
+      ExpenseSimplifier solver(std::move(graph),
+                               { .num_threads = 4, .thread_pool = &pool });
+      simplified[i] = solver.MinimalTransactions();
+    });
+  }
+  pool.Wait();
+
+  for (uint32_t i = 0; i < kNumGraphs; i++) {
+    SCOPED_TRACE(absl::StrFormat("seed %d", i));
+    ExpectValidSimplification(originals[i], *simplified[i]);
+  }
+}
+
+TEST_F(TestExpenseSimplifier, SettledDebtsStreamedToCallback) {
+  for (const uint32_t num_threads : { 1, 4 }) {
+    DebtGraph graph = RandomGraph(200, 300, /*seed=*/num_threads);
+
+    std::map<std::pair<std::string, std::string>, Cents> streamed;
+    SimplifierWorkspace workspace;
+    ExpenseSimplifier solver(
+        std::move(graph), { .num_threads = num_threads }, &workspace,
+        [&](absl::string_view lender, absl::string_view receiver,
+            Cents cents) {
+          // Every debt is only reported once it is final.
+          const bool inserted =
+              streamed
+                  .emplace(std::make_pair(std::string(lender),
+                                          std::string(receiver)),
+                           cents)
+                  .second;
+          EXPECT_TRUE(inserted) << lender << " <- " << receiver;
+        });
+
+    SCOPED_TRACE(absl::StrFormat("%d threads", num_threads));
+    const DebtList minimal = solver.MinimalTransactions().AllDebts();
+    EXPECT_EQ(streamed.size(), minimal.transactions_size());
+    for (const Transaction& t : minimal.transactions()) {
+      EXPECT_EQ(streamed[std::make_pair(t.lender(), t.receiver())], t.cents());
+    }
+  }
+}
+
+TEST_F(TestExpenseSimplifier, NetBalancesChainCollapsed) {
+  ASSERT_OK_AND_DEFINE(ExpenseSimplifier, solver, CreateFromString(R"(
+    transactions {
+      lender: "a"
+      receiver: "b"
+      cents: 100
+    }
+    transactions {
+      lender: "b"
+      receiver: "c"
+      cents: 100
+    }
+    transactions {
+      lender: "c"
+      receiver: "d"
+      cents: 100
+    })", { .mode = SimplificationMode::kNetBalances }));
+
+  // d pays a directly, though they never transacted.
+  EXPECT_THAT(solver.MinimalTransactions().AmountOwed("a", "d"),
+              IsOkAndHolds(100));
+  EXPECT_EQ(solver.MinimalTransactions().AllDebts().transactions_size(), 1);
+}
+
+TEST_F(TestExpenseSimplifier, NetBalancesRandomGraphsSettled) {
+  for (uint32_t seed = 0; seed < 20; seed++) {
+    DebtGraph graph = RandomGraph(50, 200, seed);
+    const DebtGraph original = graph;
+
+    uint64_t num_unsettled_users = 0;
+    for (uint64_t id = 0; id < original.NumUsers(); id++) {
+      if (original.DebtGraphInternal::TotalDebt(id) != 0) {
+        num_unsettled_users++;
+      }
+    }
+
+    uint64_t num_streamed = 0;
+    SimplifierWorkspace workspace;
+    ExpenseSimplifier solver(
+        std::move(graph), { .mode = SimplificationMode::kNetBalances },
+        &workspace,
+        [&](absl::string_view, absl::string_view, Cents) { num_streamed++; });
+
+    SCOPED_TRACE(absl::StrFormat("seed %d", seed));
+    const DebtGraph& simplified = solver.MinimalTransactions();
+    for (uint64_t id = 0; id < original.NumUsers(); id++) {
+      EXPECT_EQ(original.DebtGraphInternal::TotalDebt(id),
+                simplified.DebtGraphInternal::TotalDebt(id));
+    }
+    const int num_transactions = simplified.AllDebts().transactions_size();
+    EXPECT_LT(num_transactions, std::max<uint64_t>(num_unsettled_users, 1));
+    EXPECT_EQ(num_streamed, num_transactions);
+  }
+}
+
+TEST_F(TestExpenseSimplifier, MinTransactionsBeatsGreedyMatching) {
+  // Balances of a: 4, b: 3, c: 3, d: -6, e: -4. Matching the largest first
+  // takes 4 transactions, while {a, e} and {b, c, d} settle in 3.
+  constexpr absl::string_view kLedger = R"(
+    transactions { lender: "d" receiver: "a" cents: 2 }
+    transactions { lender: "e" receiver: "a" cents: 2 }
+    transactions { lender: "d" receiver: "b" cents: 3 }
+    transactions { lender: "d" receiver: "c" cents: 1 }
+    transactions { lender: "e" receiver: "c" cents: 2 }
+  )";
+  ASSERT_OK_AND_DEFINE(
+      ExpenseSimplifier, greedy,
+      CreateFromString(kLedger, { .mode = SimplificationMode::kNetBalances }));
+  ASSERT_OK_AND_DEFINE(
+      ExpenseSimplifier, exact,
+      CreateFromString(kLedger,
+                       { .mode = SimplificationMode::kMinTransactions }));
+
+  EXPECT_EQ(greedy.MinimalTransactions().AllDebts().transactions_size(), 4);
+  EXPECT_EQ(exact.MinimalTransactions().AllDebts().transactions_size(), 3);
+  EXPECT_TRUE(exact.IsExact());
+  EXPECT_THAT(exact.MinimalTransactions().AmountOwed("e", "a"),
+              IsOkAndHolds(4));
+}
+
+TEST_F(TestExpenseSimplifier, MinTransactionsRandomGraphsSettled) {
+  for (uint32_t seed = 0; seed < 20; seed++) {
+    DebtGraph graph = RandomGraph(12, 30, seed);
+    const DebtGraph original = graph;
+    DebtGraph greedy_graph = graph;
+
+    ExpenseSimplifier exact(std::move(graph),
+                            { .mode = SimplificationMode::kMinTransactions });
+    ExpenseSimplifier greedy(std::move(greedy_graph),
+                             { .mode = SimplificationMode::kNetBalances });
+
+    SCOPED_TRACE(absl::StrFormat("seed %d", seed));
+    EXPECT_TRUE(exact.IsExact());
+    for (uint64_t id = 0; id < original.NumUsers(); id++) {
+      EXPECT_EQ(original.DebtGraphInternal::TotalDebt(id),
+                exact.MinimalTransactions().DebtGraphInternal::TotalDebt(id));
+    }
+    EXPECT_LE(exact.MinimalTransactions().AllDebts().transactions_size(),
+              greedy.MinimalTransactions().AllDebts().transactions_size());
+  }
+}
+
+TEST_F(TestExpenseSimplifier, MinTransactionsFallsBackToGreedyMatching) {
+  DebtGraph graph = RandomGraph(50, 200, /*seed=*/0);
+  const DebtGraph original = graph;
+
+  ExpenseSimplifier solver(std::move(graph),
+                           { .mode = SimplificationMode::kMinTransactions,
+                             .max_exact_balances = 5 });
+
+  EXPECT_FALSE(solver.IsExact());
+  for (uint64_t id = 0; id < original.NumUsers(); id++) {
+    EXPECT_EQ(original.DebtGraphInternal::TotalDebt(id),
+              solver.MinimalTransactions().DebtGraphInternal::TotalDebt(id));
+  }
+}
+
 }  // namespace debt_simpl
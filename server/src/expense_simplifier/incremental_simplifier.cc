@@ -0,0 +1,89 @@
+#include "server/src/expense_simplifier/incremental_simplifier.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+
+#include "proto/debts.pb.h"
+#include "server/src/expense_simplifier/csr_graph.h"
+#include "server/src/expense_simplifier/debt_graph.h"
+#include "server/src/expense_simplifier/expense_simplifier.h"
+#include "server/src/expense_simplifier/utils.h"
+
+namespace debt_simpl {
+
+IncrementalSimplifier::IncrementalSimplifier(
+    DebtGraph&& graph, const ExpenseSimplifierOptions& options)
+    : options_(options) {
+  ExpenseSimplifier simplifier(std::move(graph), options_, &workspace_);
+  simplified_expenses_ = simplifier.MinimalTransactions();
+}
+
+absl::Status IncrementalSimplifier::AddTransaction(const Transaction& t) {
+  RETURN_IF_ERROR(simplified_expenses_.AddTransaction(t));
+  if (options_.mode != SimplificationMode::kExistingEdges) {
+    ExpenseSimplifier simplifier(std::move(simplified_expenses_), options_,
+                                 &workspace_);
+    simplified_expenses_ = simplifier.MinimalTransactions();
+    return absl::OkStatus();
+  }
+  DEFINE_OR_RETURN(uint64_t, receiver_id,
+                   simplified_expenses_.FindUserId(t.receiver()));
+
+  ResimplifyComponent(receiver_id);
+  return absl::OkStatus();
+}
+
+const DebtGraph& IncrementalSimplifier::MinimalTransactions() const {
+  return simplified_expenses_;
+}
+
+void IncrementalSimplifier::ResimplifyComponent(uint64_t user_id) {
+  component_.clear();
+  local_ids_.clear();
+  component_pairs_.clear();
+  component_debts_.clear();
+
+  component_.push_back(user_id);
+  local_ids_[user_id] = 0;
+  for (uint64_t i = 0; i < component_.size(); i++) {
+    const uint64_t id = component_[i];
+    for (const auto& [neighbor_id, debt] :
+         simplified_expenses_.DebtGraphInternal::AllDebts(id)) {
+      // Debts cancelled out by the new transaction linger as zero entries,
+      // which don't connect anyone but still need erasing below.
+      component_pairs_.push_back({ id, neighbor_id });
+      if (debt == 0) {
+        continue;
+      }
+      const auto [it, inserted] =
+          local_ids_.insert({ neighbor_id, component_.size() });
+      if (inserted) {
+        component_.push_back(neighbor_id);
+      }
+      if (debt > 0) {
+        component_debts_.push_back(DebtGraphEdge{ .receiver_id = i,
+                                                  .lender_id = it->second,
+                                                  .debt = debt });
+      }
+    }
+  }
+
+  CsrDebtGraph& residual_graph = workspace_.residual_graph;
+  residual_graph.Assign(component_.size(), component_debts_);
+  const std::vector<DebtGraphEdge> settled_edges =
+      ExpenseSimplifier::SettleEdges(&residual_graph,
+                                     options_.max_flow_algorithm, &workspace_);
+
+  for (const auto& [id, neighbor_id] : component_pairs_) {
+    simplified_expenses_.EraseEdge(id, neighbor_id);
+  }
+  for (const DebtGraphEdge& edge : settled_edges) {
+    simplified_expenses_.PushFlow(component_[edge.receiver_id],
+                                  component_[edge.lender_id], edge.debt);
+  }
+}
+
+}  // namespace debt_simpl
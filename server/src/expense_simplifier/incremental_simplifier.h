@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+
+#include "proto/debts.pb.h"
+#include "server/src/expense_simplifier/debt_graph.h"
+#include "server/src/expense_simplifier/expense_simplifier.h"
+
+namespace debt_simpl {
+
+// Keeps the minimal transactions of a ledger up to date as transactions are
+// appended to it, without re-simplifying the whole ledger each time.
+//
+// A new transaction only changes the balances of its two users, so in
+// `kExistingEdges` mode only the component of the current result containing
+// them is re-simplified, with the new debt added to it. Every debt of the
+// current result is between users who already transacted, so rerouting within
+// it keeps that invariant.
+//
+// The other modes settle net balances, which the current result has the same
+// of as the whole ledger, so they re-settle the current result with the new
+// debt added to it. It has at most one debt per user with a balance, however
+// long the ledger grows.
+class IncrementalSimplifier {
+ public:
+  explicit IncrementalSimplifier(DebtGraph&& graph,
+                                 const ExpenseSimplifierOptions& options = {});
+
+  IncrementalSimplifier(const IncrementalSimplifier&) = delete;
+  IncrementalSimplifier& operator=(const IncrementalSimplifier&) = delete;
+
+  // Appends `t` to the ledger and repairs the minimal transactions.
+  absl::Status AddTransaction(const Transaction& t);
+
+  const DebtGraph& MinimalTransactions() const;
+
+ private:
+  // Re-simplifies the connected component of `user_id` in
+  // `simplified_expenses_`.
+  void ResimplifyComponent(uint64_t user_id);
+
+  ExpenseSimplifierOptions options_;
+
+  DebtGraph simplified_expenses_;
+
+  // Reused across calls to `ResimplifyComponent()`.
+  SimplifierWorkspace workspace_;
+  std::vector<uint64_t> component_;
+  absl::flat_hash_map<uint64_t, uint64_t> local_ids_;
+  std::vector<std::pair<uint64_t, uint64_t>> component_pairs_;
+  std::vector<DebtGraphEdge> component_debts_;
+};
+
+}  // namespace debt_simpl
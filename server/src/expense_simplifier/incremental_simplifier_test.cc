@@ -0,0 +1,147 @@
+#include "server/src/expense_simplifier/incremental_simplifier.h"
+
+#include <cstdint>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+
+#include "absl/strings/str_format.h"
+#include "gtest/gtest.h"
+
+#include "proto/debts.pb.h"
+#include "server/src/expense_simplifier/debt_graph.h"
+#include "server/src/expense_simplifier/expense_simplifier.h"
+#include "server/src/expense_simplifier/utils.h"
+
+namespace debt_simpl {
+
+class TestIncrementalSimplifier : public ::testing::Test {
+ protected:
+  static Transaction MakeTransaction(absl::string_view lender,
+                                     absl::string_view receiver, Cents cents) {
+    Transaction t;
+    t.set_lender(std::string(lender));
+    t.set_receiver(std::string(receiver));
+    t.set_cents(cents);
+    return t;
+  }
+};
+
+TEST_F(TestIncrementalSimplifier, Empty) {
+  IncrementalSimplifier simplifier{ DebtGraph() };
+
+  EXPECT_EQ(simplifier.MinimalTransactions().AllDebts().transactions_size(),
+            0);
+}
+
+TEST_F(TestIncrementalSimplifier, DebtsBetweenSamePairNetted) {
+  IncrementalSimplifier simplifier{ DebtGraph() };
+
+  ASSERT_THAT(simplifier.AddTransaction(MakeTransaction("b", "a", 100)),
+              IsOk());
+  EXPECT_THAT(simplifier.MinimalTransactions().AmountOwed("b", "a"),
+              IsOkAndHolds(100));
+
+  ASSERT_THAT(simplifier.AddTransaction(MakeTransaction("a", "b", 30)),
+              IsOk());
+  EXPECT_THAT(simplifier.MinimalTransactions().AmountOwed("b", "a"),
+              IsOkAndHolds(70));
+
+  ASSERT_THAT(simplifier.AddTransaction(MakeTransaction("a", "b", 70)),
+              IsOk());
+  EXPECT_EQ(simplifier.MinimalTransactions().AllDebts().transactions_size(),
+            0);
+}
+
+TEST_F(TestIncrementalSimplifier, AppendedTriangleReduced) {
+  DebtGraph graph;
+  ASSERT_THAT(graph.AddTransaction(MakeTransaction("b", "a", 100)), IsOk());
+  ASSERT_THAT(graph.AddTransaction(MakeTransaction("c", "b", 100)), IsOk());
+  IncrementalSimplifier simplifier(std::move(graph));
+
+  // Now a owes c directly, so the chain through b can be shortcut.
+  ASSERT_THAT(simplifier.AddTransaction(MakeTransaction("c", "a", 50)),
+              IsOk());
+
+  EXPECT_THAT(simplifier.MinimalTransactions().TotalDebt("a"),
+              IsOkAndHolds(150));
+  EXPECT_THAT(simplifier.MinimalTransactions().TotalDebt("b"),
+              IsOkAndHolds(0));
+  EXPECT_THAT(simplifier.MinimalTransactions().TotalDebt("c"),
+              IsOkAndHolds(-150));
+  EXPECT_EQ(simplifier.MinimalTransactions().AllDebts().transactions_size(),
+            1);
+}
+
+TEST_F(TestIncrementalSimplifier, RandomAppendsStayValid) {
+  for (const MaxFlowAlgorithm algorithm :
+       { MaxFlowAlgorithm::kBlockingFlow, MaxFlowAlgorithm::kPushRelabel }) {
+    for (uint32_t seed = 0; seed < 10; seed++) {
+      SCOPED_TRACE(absl::StrFormat("algorithm %d, seed %d",
+                                   static_cast<int>(algorithm), seed));
+      std::mt19937 rng(seed);
+      std::uniform_int_distribution<uint64_t> user(0, 14);
+      std::uniform_int_distribution<Cents> cents(1, 1000);
+
+      DebtGraph ledger;
+      std::set<std::pair<std::string, std::string>> transacted;
+      IncrementalSimplifier simplifier(DebtGraph(),
+                                       { .max_flow_algorithm = algorithm });
+      for (uint64_t i = 0; i < 100; i++) {
+        const Transaction t =
+            MakeTransaction(absl::StrFormat("user%d", user(rng)),
+                            absl::StrFormat("user%d", user(rng)), cents(rng));
+        ASSERT_THAT(ledger.AddTransaction(t), IsOk());
+        ASSERT_THAT(simplifier.AddTransaction(t), IsOk());
+        transacted.insert({ t.lender(), t.receiver() });
+        transacted.insert({ t.receiver(), t.lender() });
+
+        const DebtGraph& simplified = simplifier.MinimalTransactions();
+        const DebtList ledger_debts = ledger.AllDebts();
+        for (const Transaction& debt : ledger_debts.transactions()) {
+          for (const std::string& name : { debt.lender(), debt.receiver() }) {
+            EXPECT_EQ(*ledger.TotalDebt(name), *simplified.TotalDebt(name));
+          }
+        }
+        const DebtList simplified_debts = simplified.AllDebts();
+        for (const Transaction& debt : simplified_debts.transactions()) {
+          EXPECT_TRUE(transacted.count({ debt.lender(), debt.receiver() }));
+        }
+      }
+    }
+  }
+}
+
+TEST_F(TestIncrementalSimplifier, NetBalanceModesSettleBalances) {
+  for (const SimplificationMode mode :
+       { SimplificationMode::kNetBalances,
+         SimplificationMode::kMinTransactions }) {
+    SCOPED_TRACE(absl::StrFormat("mode %d", static_cast<int>(mode)));
+    std::mt19937 rng(0);
+    std::uniform_int_distribution<uint64_t> user(0, 9);
+    std::uniform_int_distribution<Cents> cents(1, 1000);
+
+    DebtGraph ledger;
+    IncrementalSimplifier simplifier(DebtGraph(), { .mode = mode });
+    for (uint64_t i = 0; i < 50; i++) {
+      const Transaction t =
+          MakeTransaction(absl::StrFormat("user%d", user(rng)),
+                          absl::StrFormat("user%d", user(rng)), cents(rng));
+      ASSERT_THAT(ledger.AddTransaction(t), IsOk());
+      ASSERT_THAT(simplifier.AddTransaction(t), IsOk());
+
+      const DebtGraph& simplified = simplifier.MinimalTransactions();
+      for (uint64_t id = 0; id <= 9; id++) {
+        const std::string name = absl::StrFormat("user%d", id);
+        if (ledger.FindUserId(name).ok()) {
+          EXPECT_EQ(*ledger.TotalDebt(name), *simplified.TotalDebt(name));
+        }
+      }
+      // Anyone may pay anyone, so nobody needs more than one debt.
+      EXPECT_LT(simplified.AllDebts().transactions_size(), 10);
+    }
+  }
+}
+
+}  // namespace debt_simpl
@@ -1,11 +1,10 @@
 #include "server/src/expense_simplifier/layered_graph.h"
 
-#include <deque>
 #include <stdint.h>
+#include <utility>
 #include <vector>
 
-#include "absl/container/flat_hash_map.h"
-
+#include "server/src/expense_simplifier/csr_graph.h"
 #include "server/src/expense_simplifier/debt_graph.h"
 
 namespace debt_simpl {
@@ -63,18 +62,48 @@ const std::vector<LayeredGraphNode>& LayeredGraph::NodeList() const {
 // static
 LayeredGraph LayeredGraph::ConstructBlockingFlow(
     const AugmentedDebtGraph& graph, uint64_t source, uint64_t sink) {
-  LayeredGraph layered_graph;
-  std::deque<std::pair<uint64_t, uint32_t>> id_q;
-  id_q.push_back({ source, 0 });
+  BlockingFlowWorkspace workspace;
+  ConstructBlockingFlowImpl(graph, source, sink, &workspace);
+  return std::move(workspace.layered_graph_);
+}
+
+// static
+LayeredGraph LayeredGraph::ConstructBlockingFlow(const CsrDebtGraph& graph,
+                                                 uint64_t source,
+                                                 uint64_t sink) {
+  BlockingFlowWorkspace workspace;
+  ConstructBlockingFlowImpl(graph, source, sink, &workspace);
+  return std::move(workspace.layered_graph_);
+}
+
+// static
+const LayeredGraph& LayeredGraph::ConstructBlockingFlow(
+    const CsrDebtGraph& graph, uint64_t source, uint64_t sink,
+    BlockingFlowWorkspace* workspace) {
+  ConstructBlockingFlowImpl(graph, source, sink, workspace);
+  return workspace->layered_graph_;
+}
+
+// static
+template <typename Graph>
+void LayeredGraph::ConstructBlockingFlowImpl(const Graph& graph,
+                                             uint64_t source, uint64_t sink,
+                                             BlockingFlowWorkspace* workspace) {
+  constexpr uint64_t kUnvisited = BlockingFlowWorkspace::kUnvisited;
+
+  workspace->Prepare(graph.NumUsers());
+  LayeredGraph& layered_graph = workspace->layered_graph_;
+  auto& id_q = workspace->queue_;
   // A map from node id's to first the depth it was discovered at, and later the
   // index in `layered_graph` of the head of the node.
-  absl::flat_hash_map<uint64_t, uint64_t> visited_nodes;
-  visited_nodes.insert({ source, 0 });
+  std::vector<uint64_t>& visited_nodes = workspace->visited_;
+
+  id_q.push_back({ source, 0 });
+  workspace->Visit(source, 0);
   uint32_t sink_depth = UINT32_MAX;
 
-  while (!id_q.empty()) {
-    const auto [node_id, depth] = id_q.front();
-    id_q.pop_front();
+  while (workspace->queue_head_ != id_q.size()) {
+    const auto [node_id, depth] = id_q[workspace->queue_head_++];
 
     // Break once we reach the sink depth. No other exploration here is useful
     // since all shortest paths leading to the sink node have already been
@@ -95,13 +124,12 @@ LayeredGraph LayeredGraph::ConstructBlockingFlow(
         sink_depth = depth + 1;
       }
 
-      const auto neighbor_it = visited_nodes.find(neighbor_id);
-      if (neighbor_it != visited_nodes.end()) {
-        if (neighbor_it->second != depth + 1) {
+      if (visited_nodes[neighbor_id] != kUnvisited) {
+        if (visited_nodes[neighbor_id] != depth + 1) {
           continue;
         }
       } else {
-        visited_nodes.insert({ neighbor_id, static_cast<uint64_t>(depth + 1) });
+        workspace->Visit(neighbor_id, static_cast<uint64_t>(depth + 1));
         id_q.push_back({ neighbor_id, depth + 1 });
       }
 
@@ -123,11 +151,9 @@ LayeredGraph LayeredGraph::ConstructBlockingFlow(
   }
 
   // Remove all visited nodes with depth == sink_depth, except for the sink.
-  for (auto it = visited_nodes.begin(); it != visited_nodes.end();) {
-    if (it->first != sink && it->second == sink_depth) {
-      visited_nodes.erase(it++);
-    } else {
-      it++;
+  for (const uint64_t id : workspace->touched_) {
+    if (id != sink && visited_nodes[id] == sink_depth) {
+      visited_nodes[id] = kUnvisited;
     }
   }
 
@@ -139,21 +165,18 @@ LayeredGraph LayeredGraph::ConstructBlockingFlow(
        it != layered_graph.nodes_.rend(); ++it) {
     if (it->type == LayeredGraphNodeType::Head) {
       if (it->head.id != sink && num_neighbors == 0) {
-        visited_nodes.erase(it->head.id);
+        visited_nodes[it->head.id] = kUnvisited;
         it->type = LayeredGraphNodeType::Tombstone;
         num_tombstones++;
       } else {
-        const auto node_it = visited_nodes.find(it->head.id);
         // Replace the visited_nodes entry with the index of this head assuming
         // all elements will be shifted to the right after removing tombstones.
         uint64_t cur_idx = layered_graph.nodes_.rend() - it - 1;
-        node_it->second = cur_idx + num_tombstones;
+        visited_nodes[it->head.id] = cur_idx + num_tombstones;
       }
       num_neighbors = 0;
     } else {
-      const auto neighbor_it =
-          visited_nodes.find(it->neighbor._internal_neighbor_id);
-      if (neighbor_it == visited_nodes.end()) {
+      if (visited_nodes[it->neighbor._internal_neighbor_id] == kUnvisited) {
         it->type = LayeredGraphNodeType::Tombstone;
         num_tombstones++;
       } else {
@@ -170,13 +193,12 @@ LayeredGraph LayeredGraph::ConstructBlockingFlow(
       case LayeredGraphNodeType::Head:
         break;
       case LayeredGraphNodeType::Neighbor: {
-        const auto node_it =
-            visited_nodes.find(node.neighbor._internal_neighbor_id);
         // Offset the index of each neighbor, which assumed all nodes would
         // shift to the right after removal of tombstones, by the total number
         // of tombstones, which is the difference in indices between shifting to
         // the right and shifting to the left.
-        node.neighbor.neighbor_head_idx = node_it->second - num_tombstones;
+        node.neighbor.neighbor_head_idx =
+            visited_nodes[node.neighbor._internal_neighbor_id] - num_tombstones;
         break;
       }
       case LayeredGraphNodeType::Tombstone:
@@ -187,16 +209,11 @@ LayeredGraph LayeredGraph::ConstructBlockingFlow(
     j++;
   }
   layered_graph.nodes_.resize(layered_graph.nodes_.size() - num_tombstones);
-  layered_graph.nodes_.shrink_to_fit();
+  workspace->ResetVisited();
 
   // Now construct a blocking flow on the graph.
-  struct StackElement {
-    uint64_t node_idx;
-    uint64_t cur_neighbor_idx;
-    Cents flow;
-    Cents capacity;
-  };
-  std::vector<StackElement> stack;
+  using StackElement = BlockingFlowWorkspace::StackElement;
+  std::vector<StackElement>& stack = workspace->stack_;
   if (!layered_graph.nodes_.empty()) {
     stack.push_back(StackElement{
         .node_idx = 0,
@@ -243,8 +260,6 @@ LayeredGraph LayeredGraph::ConstructBlockingFlow(
     stack.push_back(element);
     stack.push_back(neighbor);
   }
-
-  return layered_graph;
 }
 
 Cents LayeredGraph::ComputeFlow() const {
@@ -256,6 +271,28 @@ Cents LayeredGraph::ComputeFlow() const {
   return flow;
 }
 
+void BlockingFlowWorkspace::Prepare(uint64_t num_users) {
+  if (visited_.size() < num_users) {
+    visited_.resize(num_users, kUnvisited);
+  }
+  queue_.clear();
+  queue_head_ = 0;
+  stack_.clear();
+  layered_graph_.nodes_.clear();
+}
+
+void BlockingFlowWorkspace::Visit(uint64_t id, uint64_t value) {
+  visited_[id] = value;
+  touched_.push_back(id);
+}
+
+void BlockingFlowWorkspace::ResetVisited() {
+  for (const uint64_t id : touched_) {
+    visited_[id] = kUnvisited;
+  }
+  touched_.clear();
+}
+
 std::ostream& operator<<(std::ostream& ostr, const LayeredGraph& graph) {
   ostr << "layered graph:" << std::endl;
   for (const auto& node : graph) {
@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <vector>
 
+#include "server/src/expense_simplifier/csr_graph.h"
 #include "server/src/expense_simplifier/debt_graph.h"
 
 namespace debt_simpl {
@@ -56,7 +57,11 @@ struct LayeredGraphNode {
 
 bool operator==(const LayeredGraphNode& a, const LayeredGraphNode& b);
 
+class BlockingFlowWorkspace;
+
 class LayeredGraph {
+  friend class BlockingFlowWorkspace;
+
  public:
   LayeredGraphNode& operator[](size_t i);
   const LayeredGraphNode& operator[](size_t i) const;
@@ -82,6 +87,15 @@ class LayeredGraph {
   // of the header of the neighbor node.
   static LayeredGraph ConstructBlockingFlow(const AugmentedDebtGraph& graph,
                                             uint64_t source, uint64_t sink);
+  static LayeredGraph ConstructBlockingFlow(const CsrDebtGraph& graph,
+                                            uint64_t source, uint64_t sink);
+
+  // Same as above, but reuses the buffers owned by `workspace` instead of
+  // allocating new ones. The returned graph is owned by `workspace` and is
+  // only valid until the next call using the same workspace.
+  static const LayeredGraph& ConstructBlockingFlow(
+      const CsrDebtGraph& graph, uint64_t source, uint64_t sink,
+      BlockingFlowWorkspace* workspace);
 
   // Computes the total flow of money in this graph.
   Cents ComputeFlow() const;
@@ -89,9 +103,67 @@ class LayeredGraph {
  private:
   LayeredGraph() = default;
 
+  // Shared implementation of `ConstructBlockingFlow()` for any graph type
+  // exposing `AllDebts(id)` as a range of (neighbor id, capacity) pairs.
+  template <typename Graph>
+  static void ConstructBlockingFlowImpl(const Graph& graph, uint64_t source,
+                                        uint64_t sink,
+                                        BlockingFlowWorkspace* workspace);
+
   std::vector<LayeredGraphNode> nodes_;
 };
 
+// Scratch buffers for `LayeredGraph::ConstructBlockingFlow()`. Keeping one of
+// these alive across repeated max-flow computations on the same graph avoids
+// reallocating the BFS queue, visited set, layered graph and DFS stack on every
+// call. Between calls only the entries touched by the previous call are reset.
+class BlockingFlowWorkspace {
+  friend class LayeredGraph;
+
+ public:
+  BlockingFlowWorkspace() = default;
+
+  BlockingFlowWorkspace(const BlockingFlowWorkspace&) = delete;
+  BlockingFlowWorkspace& operator=(const BlockingFlowWorkspace&) = delete;
+
+ private:
+  static constexpr uint64_t kUnvisited = UINT64_MAX;
+
+  struct StackElement {
+    uint64_t node_idx;
+    uint64_t cur_neighbor_idx;
+    Cents flow;
+    Cents capacity;
+  };
+
+  // Prepares the workspace for a graph with `num_users` users. Only grows the
+  // visited array, which is otherwise kept all `kUnvisited` between calls.
+  void Prepare(uint64_t num_users);
+
+  // Marks `id` as visited with the given value.
+  void Visit(uint64_t id, uint64_t value);
+
+  // Resets every visited entry touched since the last call to `Prepare()`.
+  void ResetVisited();
+
+  // The BFS queue of (node id, depth) pairs. Entries before `queue_head_` have
+  // already been popped.
+  std::vector<std::pair<uint64_t, uint32_t>> queue_;
+  uint64_t queue_head_ = 0;
+
+  // Indexed by user id. Holds first the depth a node was discovered at, and
+  // later the index in `layered_graph_` of the head of the node, or
+  // `kUnvisited`.
+  std::vector<uint64_t> visited_;
+
+  // All user ids whose `visited_` entry was set during the current call.
+  std::vector<uint64_t> touched_;
+
+  std::vector<StackElement> stack_;
+
+  LayeredGraph layered_graph_;
+};
+
 std::ostream& operator<<(std::ostream&, const LayeredGraph&);
 
 }  // namespace debt_simpl
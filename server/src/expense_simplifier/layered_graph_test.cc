@@ -8,6 +8,7 @@
 #include "google/protobuf/text_format.h"
 #include "gtest/gtest.h"
 
+#include "server/src/expense_simplifier/csr_graph.h"
 #include "server/src/expense_simplifier/debt_graph.h"
 #include "server/src/expense_simplifier/utils.h"
 
@@ -62,6 +63,70 @@ TEST_F(TestBlockingFlow, TestSingleTransaction) {
   EXPECT_THAT(layered_graph.NodeList(), ContainerEq(expected_result));
 }
 
+TEST_F(TestBlockingFlow, TestSingleTransactionCsr) {
+  ASSERT_OK_AND_DEFINE(DebtGraph, graph, CreateFromString(R"(
+    transactions {
+      lender: "alice"
+      receiver: "bob"
+      cents: 100
+    })"));
+
+  ASSERT_OK_AND_DEFINE(uint64_t, alice_id, graph.FindUserId("alice"));
+  ASSERT_OK_AND_DEFINE(uint64_t, bob_id, graph.FindUserId("bob"));
+
+  const CsrDebtGraph csr_graph(graph);
+
+  const auto layered_graph =
+      LayeredGraph::ConstructBlockingFlow(csr_graph, bob_id, alice_id);
+  const std::vector expected_result = {
+    LayeredGraphNode{ .type = LayeredGraphNodeType::Head,
+                      .head = { .id = bob_id, .level = 0 } },
+    LayeredGraphNode{
+        .type = LayeredGraphNodeType::Neighbor,
+        .neighbor = { .neighbor_head_idx = 2, .capacity = 100, .flow = 100 } },
+    LayeredGraphNode{ .type = LayeredGraphNodeType::Head,
+                      .head = { .id = alice_id, .level = 1 } }
+  };
+  EXPECT_THAT(layered_graph.NodeList(), ContainerEq(expected_result));
+}
+
+TEST_F(TestBlockingFlow, TestWorkspaceReused) {
+  ASSERT_OK_AND_DEFINE(DebtGraph, graph, CreateFromString(R"(
+    transactions {
+      lender: "alice"
+      receiver: "bob"
+      cents: 100
+    }
+    transactions {
+      lender: "joe"
+      receiver: "bob"
+      cents: 50
+    })"));
+
+  ASSERT_OK_AND_DEFINE(uint64_t, alice_id, graph.FindUserId("alice"));
+  ASSERT_OK_AND_DEFINE(uint64_t, bob_id, graph.FindUserId("bob"));
+  ASSERT_OK_AND_DEFINE(uint64_t, joe_id, graph.FindUserId("joe"));
+
+  const CsrDebtGraph csr_graph(graph);
+  BlockingFlowWorkspace workspace;
+
+  for (int i = 0; i < 2; i++) {
+    const LayeredGraph& to_alice = LayeredGraph::ConstructBlockingFlow(
+        csr_graph, bob_id, alice_id, &workspace);
+    EXPECT_EQ(to_alice.size(), 3);
+    EXPECT_EQ(to_alice.ComputeFlow(), 100);
+
+    const LayeredGraph& to_joe = LayeredGraph::ConstructBlockingFlow(
+        csr_graph, bob_id, joe_id, &workspace);
+    EXPECT_EQ(to_joe.size(), 3);
+    EXPECT_EQ(to_joe.ComputeFlow(), 50);
+
+    const LayeredGraph& no_path = LayeredGraph::ConstructBlockingFlow(
+        csr_graph, alice_id, joe_id, &workspace);
+    EXPECT_EQ(no_path.size(), 0);
+  }
+}
+
 TEST_F(TestBlockingFlow, TestNoPath) {
   ASSERT_OK_AND_DEFINE(DebtGraph, graph, CreateFromString(R"(
     transactions {
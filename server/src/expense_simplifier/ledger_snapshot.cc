@@ -0,0 +1,287 @@
+#include "server/src/expense_simplifier/ledger_snapshot.h"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+
+#include "server/src/expense_simplifier/debt_graph.h"
+#include "server/src/expense_simplifier/utils.h"
+#include "server/src/util/file_util.h"
+
+namespace debt_simpl {
+
+namespace {
+
+constexpr char kMagic[8] = { 'D', 'S', 'L', 'E', 'D', 'G', 'E', 'R' };
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t num_users;
+  uint64_t num_debts;
+  uint64_t names_size;
+};
+static_assert(sizeof(Header) % 8 == 0,
+              "The arrays following the header must stay 8-byte aligned");
+
+// Returns the number of 8-byte words taken by the arrays of a snapshot of
+// `num_users` users and `num_debts` debts, which come before the names.
+uint64_t NumArrayWords(uint64_t num_users, uint64_t num_debts) {
+  // Total debts, debt offsets, lenders, debts, name offsets and ids by name.
+  return num_users + (num_users + 1) + 2 * num_debts + (num_users + 1) +
+         num_users;
+}
+
+template <typename T>
+void AppendArray(const std::vector<T>& array, std::string* out) {
+  static_assert(sizeof(T) == 8, "Snapshot arrays hold 8-byte integers");
+  out->append(reinterpret_cast<const char*>(array.data()),
+              array.size() * sizeof(T));
+}
+
+}  // namespace
+
+// static
+std::string LedgerSnapshot::Serialize(const DebtGraph& graph) {
+  const uint64_t num_users = graph.NumUsers();
+
+  std::vector<Cents> total_debts(num_users);
+  std::vector<uint64_t> debt_offsets(num_users + 1, 0);
+  std::vector<uint64_t> lenders;
+  std::vector<Cents> debts;
+  std::vector<std::pair<uint64_t, Cents>> row;
+  for (uint64_t receiver_id = 0; receiver_id < num_users; receiver_id++) {
+    total_debts[receiver_id] = graph.DebtGraphInternal::TotalDebt(receiver_id);
+
+    row.clear();
+    for (const auto [lender_id, debt] :
+         graph.DebtGraphInternal::AllDebts(receiver_id)) {
+      if (debt > 0) {
+        row.emplace_back(lender_id, debt);
+      }
+    }
+    std::sort(row.begin(), row.end());
+    for (const auto& [lender_id, debt] : row) {
+      lenders.push_back(lender_id);
+      debts.push_back(debt);
+    }
+    debt_offsets[receiver_id + 1] = lenders.size();
+  }
+
+  std::vector<uint64_t> name_offsets(num_users + 1, 0);
+  std::vector<uint64_t> ids_by_name(num_users);
+  for (uint64_t id = 0; id < num_users; id++) {
+    name_offsets[id + 1] = name_offsets[id] + graph.UserName(id).size();
+    ids_by_name[id] = id;
+  }
+  std::sort(ids_by_name.begin(), ids_by_name.end(),
+            [&graph](uint64_t id1, uint64_t id2) {
+              return graph.UserName(id1) < graph.UserName(id2);
+            });
+
+  Header header = {};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.num_users = num_users;
+  header.num_debts = lenders.size();
+  header.names_size = name_offsets[num_users];
+
+  std::string snapshot;
+  snapshot.reserve(sizeof(Header) +
+                   8 * NumArrayWords(num_users, header.num_debts) +
+                   header.names_size);
+  snapshot.append(reinterpret_cast<const char*>(&header), sizeof(Header));
+  AppendArray(total_debts, &snapshot);
+  AppendArray(debt_offsets, &snapshot);
+  AppendArray(lenders, &snapshot);
+  AppendArray(debts, &snapshot);
+  AppendArray(name_offsets, &snapshot);
+  AppendArray(ids_by_name, &snapshot);
+  for (uint64_t id = 0; id < num_users; id++) {
+    absl::StrAppend(&snapshot, graph.UserName(id));
+  }
+  return snapshot;
+}
+
+// static
+absl::Status LedgerSnapshot::Write(const DebtGraph& graph,
+                                   const std::string& path) {
+  return WriteFileAtomically(path, Serialize(graph));
+}
+
+// static
+absl::StatusOr<LedgerSnapshot> LedgerSnapshot::Open(const std::string& path) {
+  DEFINE_OR_RETURN(MappedFile, file, MappedFile::Open(path));
+  LedgerSnapshot snapshot;
+  snapshot.file_.emplace(std::move(file));
+  const absl::string_view contents = snapshot.file_->contents();
+  RETURN_IF_ERROR(snapshot.Load(contents));
+  // Lookups jump around the arrays, so undo the read-ahead the mapping asks
+  // for, which would fault in pages that are never used.
+  madvise(const_cast<char*>(contents.data()), contents.size(), MADV_RANDOM);
+  return snapshot;
+}
+
+// static
+absl::StatusOr<LedgerSnapshot> LedgerSnapshot::FromBuffer(
+    absl::string_view buffer) {
+  LedgerSnapshot snapshot;
+  RETURN_IF_ERROR(snapshot.Load(buffer));
+  return snapshot;
+}
+
+absl::Status LedgerSnapshot::Load(absl::string_view buffer) {
+  if (reinterpret_cast<uintptr_t>(buffer.data()) % 8 != 0) {
+    return absl::InvalidArgumentError("Snapshot buffer isn't 8-byte aligned");
+  }
+  if (buffer.size() < sizeof(Header)) {
+    return absl::DataLossError("Snapshot is too short for its header");
+  }
+  Header header;
+  std::memcpy(&header, buffer.data(), sizeof(Header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+    return absl::DataLossError("Not a ledger snapshot");
+  }
+  if (header.version != kVersion) {
+    return absl::FailedPreconditionError(
+        absl::StrFormat("Unsupported snapshot version %u, expected %u",
+                        header.version, kVersion));
+  }
+
+  // Bounding the counts by the size first keeps the array sizes from
+  // overflowing.
+  const uint64_t max_words = buffer.size() / 8;
+  if (header.num_users > max_words || header.num_debts > max_words ||
+      header.names_size > buffer.size() ||
+      sizeof(Header) + 8 * NumArrayWords(header.num_users, header.num_debts) +
+              header.names_size !=
+          buffer.size()) {
+    return absl::DataLossError(absl::StrFormat(
+        "Snapshot of %u bytes doesn't match its header of %u users, %u debts "
+        "and %u bytes of names",
+        buffer.size(), header.num_users, header.num_debts,
+        header.names_size));
+  }
+
+  num_users_ = header.num_users;
+  num_debts_ = header.num_debts;
+  names_size_ = header.names_size;
+
+  const uint64_t* words =
+      reinterpret_cast<const uint64_t*>(buffer.data() + sizeof(Header));
+  total_debts_ = reinterpret_cast<const Cents*>(words);
+  words += num_users_;
+  debt_offsets_ = words;
+  words += num_users_ + 1;
+  lenders_ = words;
+  words += num_debts_;
+  debts_ = reinterpret_cast<const Cents*>(words);
+  words += num_debts_;
+  name_offsets_ = words;
+  words += num_users_ + 1;
+  ids_by_name_ = words;
+  words += num_users_;
+  names_ = reinterpret_cast<const char*>(words);
+  return absl::OkStatus();
+}
+
+absl::Status LedgerSnapshot::Validate() const {
+  if (debt_offsets_[0] != 0 || debt_offsets_[num_users_] != num_debts_ ||
+      name_offsets_[0] != 0 || name_offsets_[num_users_] != names_size_) {
+    return absl::DataLossError("Snapshot offsets don't span their arrays");
+  }
+
+  std::vector<Cents> total_debts(num_users_, 0);
+  for (uint64_t receiver_id = 0; receiver_id < num_users_; receiver_id++) {
+    if (debt_offsets_[receiver_id] > debt_offsets_[receiver_id + 1] ||
+        name_offsets_[receiver_id] > name_offsets_[receiver_id + 1]) {
+      return absl::DataLossError(
+          absl::StrFormat("Snapshot offsets of user %u decrease", receiver_id));
+    }
+    const absl::Span<const uint64_t> lenders = Lenders(receiver_id);
+    const absl::Span<const Cents> debts = Debts(receiver_id);
+    for (uint64_t i = 0; i < lenders.size(); i++) {
+      if (lenders[i] >= num_users_ || lenders[i] == receiver_id ||
+          (i > 0 && lenders[i] <= lenders[i - 1]) || debts[i] <= 0) {
+        return absl::DataLossError(absl::StrFormat(
+            "Snapshot has an invalid debt of user %u", receiver_id));
+      }
+      total_debts[receiver_id] += debts[i];
+      total_debts[lenders[i]] -= debts[i];
+    }
+  }
+
+  for (uint64_t id = 0; id < num_users_; id++) {
+    if (total_debts_[id] != total_debts[id]) {
+      return absl::DataLossError(absl::StrFormat(
+          "Snapshot total debt of user %u is %d, but their debts add up to %d",
+          id, total_debts_[id], total_debts[id]));
+    }
+  }
+
+  // Names in strictly increasing order are all different, so the ids are a
+  // permutation of the users.
+  for (uint64_t i = 0; i < num_users_; i++) {
+    if (ids_by_name_[i] >= num_users_ ||
+        (i > 0 &&
+         UserName(ids_by_name_[i]) <= UserName(ids_by_name_[i - 1]))) {
+      return absl::DataLossError(
+          "Snapshot user names aren't unique and sorted");
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<uint64_t> LedgerSnapshot::FindUserId(
+    absl::string_view username) const {
+  const uint64_t* const end = ids_by_name_ + num_users_;
+  const uint64_t* it = std::lower_bound(
+      ids_by_name_, end, username, [this](uint64_t id, absl::string_view name) {
+        return UserName(id) < name;
+      });
+  if (it == end || UserName(*it) != username) {
+    return absl::InternalError(absl::StrFormat("No such user %s", username));
+  }
+  return *it;
+}
+
+Cents LedgerSnapshot::Debt(uint64_t receiver_id, uint64_t lender_id) const {
+  const absl::Span<const uint64_t> lenders = Lenders(receiver_id);
+  const auto it = std::lower_bound(lenders.begin(), lenders.end(), lender_id);
+  if (it == lenders.end() || *it != lender_id) {
+    return 0;
+  }
+  return Debts(receiver_id)[it - lenders.begin()];
+}
+
+absl::StatusOr<DebtGraph> LedgerSnapshot::ToDebtGraph() const {
+  DebtGraph graph;
+  for (uint64_t id = 0; id < num_users_; id++) {
+    if (graph.FindOrAssignUserId(UserName(id)) != id) {
+      return absl::DataLossError(absl::StrFormat(
+          "Snapshot has more than one user named %s", UserName(id)));
+    }
+  }
+  for (uint64_t receiver_id = 0; receiver_id < num_users_; receiver_id++) {
+    const absl::Span<const uint64_t> lenders = Lenders(receiver_id);
+    const absl::Span<const Cents> debts = Debts(receiver_id);
+    for (uint64_t i = 0; i < lenders.size(); i++) {
+      graph.PushFlow(receiver_id, lenders[i], debts[i]);
+    }
+  }
+  return graph;
+}
+
+}  // namespace debt_simpl
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+
+#include "server/src/expense_simplifier/debt_graph.h"
+#include "server/src/util/file_util.h"
+
+namespace debt_simpl {
+
+// A read-only view of a DebtGraph saved in a binary, versioned format that
+// is used in place, straight out of a memory mapping.
+//
+// The format is a fixed header followed by flat arrays of 8-byte integers in
+// host byte order:
+//
+//   - the total debt of every user,
+//   - the positive debts of the graph in compressed-sparse-row form: the
+//     offset of the first debt of every receiver, then the lender and amount
+//     of every debt, sorted by lender within each receiver,
+//   - the offset of every user's name into the names table, and the user ids
+//     sorted by name,
+//   - the names table, holding every name back to back.
+//
+// Opening a snapshot only reads its header, so loading takes constant time
+// and the pages of the arrays are faulted in as they are used.
+class LedgerSnapshot {
+ public:
+  // The version of the format written by `Serialize()`. Snapshots of any
+  // other version are refused.
+  static constexpr uint32_t kVersion = 1;
+
+  // Returns `graph` in the snapshot format.
+  static std::string Serialize(const DebtGraph& graph);
+
+  // Writes a snapshot of `graph` to `path`. The snapshot is written to a
+  // temporary file next to it and synced before it replaces `path`, so a
+  // crash never leaves a partial snapshot behind.
+  static absl::Status Write(const DebtGraph& graph, const std::string& path);
+
+  // Maps the snapshot at `path`.
+  static absl::StatusOr<LedgerSnapshot> Open(const std::string& path);
+
+  // Views the snapshot in `buffer`, which must be 8-byte aligned and outlive
+  // the view.
+  static absl::StatusOr<LedgerSnapshot> FromBuffer(absl::string_view buffer);
+
+  LedgerSnapshot(LedgerSnapshot&&) = default;
+  LedgerSnapshot& operator=(LedgerSnapshot&&) = default;
+  LedgerSnapshot(const LedgerSnapshot&) = delete;
+  LedgerSnapshot& operator=(const LedgerSnapshot&) = delete;
+
+  // Checks that every offset and id in the snapshot is in bounds and that
+  // the total debts agree with the debts. Loading only checks that the arrays
+  // fit in the buffer, so snapshots that weren't written by `Write()` should
+  // be validated before anything else is read from them.
+  absl::Status Validate() const;
+
+  // Returns the total number of users. Ids span the range [0, NumUsers()),
+  // and are the ids of the graph the snapshot was taken of.
+  uint64_t NumUsers() const {
+    return num_users_;
+  }
+
+  // Returns the total number of positive debts.
+  uint64_t NumDebts() const {
+    return num_debts_;
+  }
+
+  // Returns the name of the user with id `id`, which must be in
+  // [0, NumUsers()).
+  absl::string_view UserName(uint64_t id) const {
+    return absl::string_view(names_ + name_offsets_[id],
+                             name_offsets_[id + 1] - name_offsets_[id]);
+  }
+
+  // Given a user's name, returns the unique id of the user, or an error if
+  // that user doesn't exist. Takes O(log NumUsers()) time.
+  absl::StatusOr<uint64_t> FindUserId(absl::string_view username) const;
+
+  // Returns the total debt this user owes. May be negative if they are owed
+  // money.
+  Cents TotalDebt(uint64_t id) const {
+    return total_debts_[id];
+  }
+
+  // Returns the ids of the users `receiver_id` owes money to, in increasing
+  // order, and how much they owe each of them.
+  absl::Span<const uint64_t> Lenders(uint64_t receiver_id) const {
+    return absl::MakeConstSpan(lenders_ + debt_offsets_[receiver_id],
+                               lenders_ + debt_offsets_[receiver_id + 1]);
+  }
+  absl::Span<const Cents> Debts(uint64_t receiver_id) const {
+    return absl::MakeConstSpan(debts_ + debt_offsets_[receiver_id],
+                               debts_ + debt_offsets_[receiver_id + 1]);
+  }
+
+  // Returns the amount of money `receiver_id` owes `lender_id`, which is 0 if
+  // they owe nothing or are owed money instead.
+  Cents Debt(uint64_t receiver_id, uint64_t lender_id) const;
+
+  // Builds a DebtGraph of the snapshot, for simplifying it.
+  absl::StatusOr<DebtGraph> ToDebtGraph() const;
+
+ private:
+  LedgerSnapshot() = default;
+
+  // Points the arrays into `buffer`, checking that they fit in it.
+  absl::Status Load(absl::string_view buffer);
+
+  // The mapping the arrays point into, unless they point into a buffer owned
+  // by the caller.
+  std::optional<MappedFile> file_;
+
+  uint64_t num_users_ = 0;
+  uint64_t num_debts_ = 0;
+  uint64_t names_size_ = 0;
+
+  const Cents* total_debts_ = nullptr;
+  const uint64_t* debt_offsets_ = nullptr;
+  const uint64_t* lenders_ = nullptr;
+  const Cents* debts_ = nullptr;
+  const uint64_t* name_offsets_ = nullptr;
+  const uint64_t* ids_by_name_ = nullptr;
+  const char* names_ = nullptr;
+};
+
+}  // namespace debt_simpl
@@ -0,0 +1,142 @@
+#include "server/src/expense_simplifier/ledger_snapshot.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "proto/debts.pb.h"
+#include "server/src/expense_simplifier/debt_graph.h"
+#include "server/src/expense_simplifier/debt_list_testing.h"
+#include "server/src/expense_simplifier/utils.h"
+
+namespace debt_simpl {
+
+using ::testing::ElementsAre;
+using ::testing::Not;
+
+class TestLedgerSnapshot : public ::testing::Test {
+ protected:
+  // Returns the offset of the total debt of user `id` in a snapshot.
+  static uint64_t TotalDebtOffset(uint64_t id) {
+    return 40 + 8 * id;
+  }
+};
+
+TEST_F(TestLedgerSnapshot, RoundTrip) {
+  const DebtGraph graph = GraphOf({ { "alice", "bob", 500 },
+                                    { "carol", "bob", 300 },
+                                    { "bob", "alice", 200 },
+                                    { "alice", "carol", 100 } });
+  const std::string buffer = LedgerSnapshot::Serialize(graph);
+  ASSERT_OK_AND_DEFINE(LedgerSnapshot, snapshot,
+                       LedgerSnapshot::FromBuffer(buffer));
+  EXPECT_THAT(snapshot.Validate(), IsOk());
+
+  ASSERT_EQ(snapshot.NumUsers(), 3);
+  EXPECT_EQ(snapshot.NumDebts(), 3);
+  for (uint64_t id = 0; id < graph.NumUsers(); id++) {
+    EXPECT_EQ(snapshot.UserName(id), graph.UserName(id));
+    EXPECT_THAT(snapshot.FindUserId(graph.UserName(id)), IsOkAndHolds(id));
+    EXPECT_EQ(snapshot.TotalDebt(id), graph.DebtGraphInternal::TotalDebt(id));
+  }
+  EXPECT_THAT(snapshot.FindUserId("dave"), Not(IsOk()));
+
+  ASSERT_OK_AND_DEFINE(uint64_t, alice, snapshot.FindUserId("alice"));
+  ASSERT_OK_AND_DEFINE(uint64_t, bob, snapshot.FindUserId("bob"));
+  ASSERT_OK_AND_DEFINE(uint64_t, carol, snapshot.FindUserId("carol"));
+  EXPECT_EQ(snapshot.Debt(bob, alice), 300);
+  EXPECT_EQ(snapshot.Debt(alice, bob), 0);
+  EXPECT_THAT(snapshot.Lenders(bob), ElementsAre(alice, carol));
+  EXPECT_THAT(snapshot.Debts(bob), ElementsAre(300, 300));
+
+  ASSERT_OK_AND_DEFINE(DebtGraph, loaded, snapshot.ToDebtGraph());
+  ASSERT_EQ(loaded.NumUsers(), graph.NumUsers());
+  for (uint64_t receiver_id = 0; receiver_id < graph.NumUsers();
+       receiver_id++) {
+    EXPECT_EQ(loaded.UserName(receiver_id), graph.UserName(receiver_id));
+    EXPECT_EQ(loaded.DebtGraphInternal::TotalDebt(receiver_id),
+              graph.DebtGraphInternal::TotalDebt(receiver_id));
+    for (uint64_t lender_id = 0; lender_id < graph.NumUsers(); lender_id++) {
+      EXPECT_EQ(loaded.Debt(receiver_id, lender_id),
+                graph.Debt(receiver_id, lender_id));
+    }
+  }
+  EXPECT_THAT(loaded.TotalDebt("alice"), IsOkAndHolds(-400));
+}
+
+TEST_F(TestLedgerSnapshot, SettledUsersKeepTheirIds) {
+  const DebtGraph graph = GraphOf({ { "alice", "bob", 500 },
+                                    { "bob", "alice", 500 },
+                                    { "carol", "dave", 100 } });
+  const std::string buffer = LedgerSnapshot::Serialize(graph);
+  ASSERT_OK_AND_DEFINE(LedgerSnapshot, snapshot,
+                       LedgerSnapshot::FromBuffer(buffer));
+  EXPECT_THAT(snapshot.Validate(), IsOk());
+  EXPECT_EQ(snapshot.NumUsers(), 4);
+  EXPECT_EQ(snapshot.NumDebts(), 1);
+  EXPECT_THAT(snapshot.FindUserId("carol"), IsOkAndHolds(2));
+  EXPECT_EQ(snapshot.TotalDebt(0), 0);
+}
+
+TEST_F(TestLedgerSnapshot, EmptyGraph) {
+  const std::string buffer = LedgerSnapshot::Serialize(DebtGraph());
+  ASSERT_OK_AND_DEFINE(LedgerSnapshot, snapshot,
+                       LedgerSnapshot::FromBuffer(buffer));
+  EXPECT_THAT(snapshot.Validate(), IsOk());
+  EXPECT_EQ(snapshot.NumUsers(), 0);
+  EXPECT_THAT(snapshot.FindUserId("alice"), Not(IsOk()));
+}
+
+TEST_F(TestLedgerSnapshot, WriteAndOpen) {
+  const std::string path = ::testing::TempDir() + "/ledger_snapshot_test.snap";
+  const DebtGraph graph = GraphOf({ { "alice", "bob", 500 } });
+  ASSERT_THAT(LedgerSnapshot::Write(graph, path), IsOk());
+
+  ASSERT_OK_AND_DEFINE(LedgerSnapshot, snapshot, LedgerSnapshot::Open(path));
+  EXPECT_THAT(snapshot.Validate(), IsOk());
+  EXPECT_THAT(snapshot.FindUserId("bob"), IsOkAndHolds(1));
+  EXPECT_EQ(snapshot.Debt(1, 0), 500);
+
+  // Moving the snapshot keeps the mapping alive.
+  LedgerSnapshot moved = std::move(snapshot);
+  EXPECT_EQ(moved.UserName(0), "alice");
+
+  EXPECT_THAT(LedgerSnapshot::Open(path + ".missing"), Not(IsOk()));
+  std::remove(path.c_str());
+}
+
+TEST_F(TestLedgerSnapshot, RejectsMalformedBuffers) {
+  const std::string buffer =
+      LedgerSnapshot::Serialize(GraphOf({ { "alice", "bob", 500 } }));
+
+  EXPECT_THAT(LedgerSnapshot::FromBuffer(std::string(buffer.size(), 'x')),
+              Not(IsOk()));
+  EXPECT_THAT(LedgerSnapshot::FromBuffer(buffer.substr(0, buffer.size() - 1)),
+              Not(IsOk()));
+  EXPECT_THAT(LedgerSnapshot::FromBuffer(buffer + "extra"), Not(IsOk()));
+
+  std::string future_version = buffer;
+  future_version[8] = LedgerSnapshot::kVersion + 1;
+  EXPECT_EQ(LedgerSnapshot::FromBuffer(future_version).status().code(),
+            absl::StatusCode::kFailedPrecondition);
+}
+
+TEST_F(TestLedgerSnapshot, ValidateCatchesCorruption) {
+  std::string buffer =
+      LedgerSnapshot::Serialize(GraphOf({ { "alice", "bob", 500 } }));
+  const Cents wrong_total = 400;
+  std::memcpy(&buffer[TotalDebtOffset(1)], &wrong_total, sizeof(Cents));
+
+  // Loading doesn't read past the header.
+  ASSERT_OK_AND_DEFINE(LedgerSnapshot, snapshot,
+                       LedgerSnapshot::FromBuffer(buffer));
+  EXPECT_EQ(snapshot.Validate().code(), absl::StatusCode::kDataLoss);
+}
+
+}  // namespace debt_simpl
@@ -0,0 +1,259 @@
+#include "server/src/expense_simplifier/push_relabel.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "server/src/expense_simplifier/csr_graph.h"
+#include "server/src/expense_simplifier/debt_graph.h"
+
+namespace debt_simpl {
+
+Cents PushRelabelMaxFlow::MaxFlow(CsrDebtGraph* graph, uint64_t source,
+                                  uint64_t sink) {
+  graph_ = graph;
+  source_ = source;
+  sink_ = sink;
+  Prepare(graph->NumUsers());
+
+  if (source == sink || !DiscoverComponent(source, sink)) {
+    return 0;
+  }
+
+  num_nodes_ = component_.size();
+  active_heads_.assign(2 * num_nodes_, kNone);
+  bucket_heads_.assign(2 * num_nodes_, kNone);
+  for (const uint64_t id : component_) {
+    excess_[id] = 0;
+  }
+
+  // Saturate every edge out of the source.
+  for (uint64_t edge = graph_->EdgeBegin(source);
+       edge < graph_->EdgeEnd(source); edge++) {
+    const Cents capacity = graph_->Capacity(edge);
+    if (capacity > 0) {
+      Push(source, edge, capacity);
+    }
+  }
+
+  GlobalRelabel();
+
+  while (true) {
+    while (max_active_label_ > 0 &&
+           active_heads_[max_active_label_] == kNone) {
+      max_active_label_--;
+    }
+    const uint64_t id = active_heads_[max_active_label_];
+    if (id == kNone) {
+      break;
+    }
+    active_heads_[max_active_label_] = active_next_[id];
+
+    Discharge(id);
+
+    if (relabels_since_global_ >= num_nodes_) {
+      GlobalRelabel();
+    }
+  }
+
+  return excess_[sink];
+}
+
+void PushRelabelMaxFlow::Prepare(uint64_t num_users) {
+  if (component_stamp_.size() >= num_users) {
+    return;
+  }
+  component_stamp_.resize(num_users, 0);
+  bfs_stamp_.resize(num_users, 0);
+  labels_.resize(num_users);
+  excess_.resize(num_users);
+  current_edge_.resize(num_users);
+  active_next_.resize(num_users);
+  bucket_next_.resize(num_users);
+  bucket_prev_.resize(num_users);
+}
+
+bool PushRelabelMaxFlow::InComponent(uint64_t id) const {
+  return component_stamp_[id] == epoch_;
+}
+
+bool PushRelabelMaxFlow::DiscoverComponent(uint64_t source, uint64_t sink) {
+  epoch_++;
+  component_.clear();
+  component_.push_back(source);
+  component_stamp_[source] = epoch_;
+
+  for (uint64_t i = 0; i < component_.size(); i++) {
+    const uint64_t id = component_[i];
+    for (uint64_t edge = graph_->EdgeBegin(id); edge < graph_->EdgeEnd(id);
+         edge++) {
+      const uint64_t neighbor_id = graph_->Neighbor(edge);
+      if (graph_->Capacity(edge) > 0 && !InComponent(neighbor_id)) {
+        component_stamp_[neighbor_id] = epoch_;
+        component_.push_back(neighbor_id);
+      }
+    }
+  }
+
+  return InComponent(sink);
+}
+
+void PushRelabelMaxFlow::GlobalRelabel() {
+  relabels_since_global_ = 0;
+  std::fill(active_heads_.begin(), active_heads_.end(), kNone);
+  std::fill(bucket_heads_.begin(), bucket_heads_.end(), kNone);
+
+  const uint64_t max_label = 2 * num_nodes_ - 1;
+  for (const uint64_t id : component_) {
+    labels_[id] = max_label;
+  }
+
+  // Labels are distances to the sink in the residual graph for users that can
+  // reach it, and `num_nodes_` plus the distance to the source for the rest.
+  // The source is stamped up front so the first search never passes through
+  // it.
+  bfs_epoch_++;
+  bfs_stamp_[source_] = bfs_epoch_;
+  labels_[source_] = num_nodes_;
+  for (const uint64_t root : { sink_, source_ }) {
+    bfs_queue_.clear();
+    bfs_queue_.push_back(root);
+    bfs_stamp_[root] = bfs_epoch_;
+    labels_[root] = root == sink_ ? 0 : num_nodes_;
+
+    for (uint64_t i = 0; i < bfs_queue_.size(); i++) {
+      const uint64_t id = bfs_queue_[i];
+      for (uint64_t edge = graph_->EdgeBegin(id); edge < graph_->EdgeEnd(id);
+           edge++) {
+        const uint64_t neighbor_id = graph_->Neighbor(edge);
+        if (!InComponent(neighbor_id) ||
+            bfs_stamp_[neighbor_id] == bfs_epoch_ ||
+            graph_->Capacity(graph_->ReverseEdge(edge)) <= 0) {
+          continue;
+        }
+        bfs_stamp_[neighbor_id] = bfs_epoch_;
+        labels_[neighbor_id] = labels_[id] + 1;
+        bfs_queue_.push_back(neighbor_id);
+      }
+    }
+  }
+
+  max_active_label_ = 0;
+  for (const uint64_t id : component_) {
+    if (id == source_) {
+      continue;
+    }
+    current_edge_[id] = graph_->EdgeBegin(id);
+    AddToBucket(id);
+    if (excess_[id] > 0 && id != sink_) {
+      AddActive(id);
+    }
+  }
+}
+
+void PushRelabelMaxFlow::Discharge(uint64_t id) {
+  const uint64_t edge_end = graph_->EdgeEnd(id);
+  while (excess_[id] > 0) {
+    if (current_edge_[id] == edge_end) {
+      Relabel(id);
+      continue;
+    }
+
+    const uint64_t edge = current_edge_[id];
+    const uint64_t neighbor_id = graph_->Neighbor(edge);
+    const Cents capacity = graph_->Capacity(edge);
+    if (capacity > 0 && InComponent(neighbor_id) &&
+        labels_[id] == labels_[neighbor_id] + 1) {
+      const bool was_inactive = excess_[neighbor_id] == 0;
+      Push(id, edge, std::min(excess_[id], capacity));
+      if (was_inactive && neighbor_id != source_ && neighbor_id != sink_) {
+        AddActive(neighbor_id);
+      }
+    } else {
+      current_edge_[id]++;
+    }
+  }
+}
+
+void PushRelabelMaxFlow::Relabel(uint64_t id) {
+  relabels_since_global_++;
+
+  const uint64_t old_label = labels_[id];
+  RemoveFromBucket(id);
+
+  uint64_t new_label = 2 * num_nodes_ - 1;
+  for (uint64_t edge = graph_->EdgeBegin(id); edge < graph_->EdgeEnd(id);
+       edge++) {
+    const uint64_t neighbor_id = graph_->Neighbor(edge);
+    if (graph_->Capacity(edge) > 0 && InComponent(neighbor_id)) {
+      new_label = std::min(new_label, labels_[neighbor_id] + 1);
+    }
+  }
+
+  if (old_label < num_nodes_ && bucket_heads_[old_label] == kNone) {
+    // Gap heuristic: no user is left at `old_label`, so nobody above it can
+    // reach the sink anymore. Lift all of them to `num_nodes_`, from where
+    // their excess can only drain back to the source.
+    for (uint64_t label = old_label + 1; label < num_nodes_; label++) {
+      for (uint64_t node = bucket_heads_[label]; node != kNone;) {
+        const uint64_t next = bucket_next_[node];
+        labels_[node] = num_nodes_;
+        current_edge_[node] = graph_->EdgeBegin(node);
+        AddToBucket(node);
+        node = next;
+      }
+      bucket_heads_[label] = kNone;
+
+      for (uint64_t node = active_heads_[label]; node != kNone;) {
+        const uint64_t next = active_next_[node];
+        AddActive(node);
+        node = next;
+      }
+      active_heads_[label] = kNone;
+    }
+    new_label = std::max(new_label, num_nodes_);
+  }
+
+  labels_[id] = new_label;
+  current_edge_[id] = graph_->EdgeBegin(id);
+  AddToBucket(id);
+}
+
+void PushRelabelMaxFlow::Push(uint64_t from, uint64_t edge, Cents amount) {
+  graph_->PushFlowOnEdge(edge, amount);
+  excess_[from] -= amount;
+  excess_[graph_->Neighbor(edge)] += amount;
+}
+
+void PushRelabelMaxFlow::AddActive(uint64_t id) {
+  const uint64_t label = labels_[id];
+  active_next_[id] = active_heads_[label];
+  active_heads_[label] = id;
+  max_active_label_ = std::max(max_active_label_, label);
+}
+
+void PushRelabelMaxFlow::AddToBucket(uint64_t id) {
+  const uint64_t label = labels_[id];
+  const uint64_t head = bucket_heads_[label];
+  bucket_prev_[id] = kNone;
+  bucket_next_[id] = head;
+  if (head != kNone) {
+    bucket_prev_[head] = id;
+  }
+  bucket_heads_[label] = id;
+}
+
+void PushRelabelMaxFlow::RemoveFromBucket(uint64_t id) {
+  const uint64_t prev = bucket_prev_[id];
+  const uint64_t next = bucket_next_[id];
+  if (prev == kNone) {
+    bucket_heads_[labels_[id]] = next;
+  } else {
+    bucket_next_[prev] = next;
+  }
+  if (next != kNone) {
+    bucket_prev_[next] = prev;
+  }
+}
+
+}  // namespace debt_simpl
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "server/src/expense_simplifier/csr_graph.h"
+#include "server/src/expense_simplifier/debt_graph.h"
+
+namespace debt_simpl {
+
+// Computes maximum flows on a `CsrDebtGraph` with the highest-label
+// push-relabel algorithm, using periodic global relabeling and the gap
+// heuristic.
+//
+// Only users reachable from the source in the residual graph take part in a
+// computation, so repeated calls on a large graph with small connected
+// components don't pay for the whole graph. Buffers are kept between calls.
+class PushRelabelMaxFlow {
+ public:
+  PushRelabelMaxFlow() = default;
+
+  PushRelabelMaxFlow(const PushRelabelMaxFlow&) = delete;
+  PushRelabelMaxFlow& operator=(const PushRelabelMaxFlow&) = delete;
+
+  // Pushes a maximum flow from `source` to `sink` through `graph`, updating
+  // the residual capacities of `graph` in place, and returns the value of the
+  // flow. Total debts recorded in `graph` are not modified.
+  Cents MaxFlow(CsrDebtGraph* graph, uint64_t source, uint64_t sink);
+
+ private:
+  static constexpr uint64_t kNone = UINT64_MAX;
+
+  // Grows the per-user buffers to fit a graph with `num_users` users.
+  void Prepare(uint64_t num_users);
+
+  // Returns true if `id` was discovered by the current computation.
+  bool InComponent(uint64_t id) const;
+
+  // Collects all users reachable from `source` into `component_`. Returns false
+  // if `sink` is not among them.
+  bool DiscoverComponent(uint64_t source, uint64_t sink);
+
+  // Recomputes exact labels with a backwards BFS from the sink, then from the
+  // source for users that can no longer reach the sink, and rebuilds the
+  // buckets.
+  void GlobalRelabel();
+
+  // Pushes excess out of `id` until it has none left or it is relabeled.
+  void Discharge(uint64_t id);
+
+  // Raises the label of `id` to one more than its lowest residual neighbor,
+  // applying the gap heuristic if its old label becomes empty.
+  void Relabel(uint64_t id);
+
+  // Pushes `amount` along edge `edge` out of `from`.
+  void Push(uint64_t from, uint64_t edge, Cents amount);
+
+  void AddActive(uint64_t id);
+  void AddToBucket(uint64_t id);
+  void RemoveFromBucket(uint64_t id);
+
+  CsrDebtGraph* graph_ = nullptr;
+  uint64_t source_;
+  uint64_t sink_;
+
+  // The number of users in the current component. Labels of users that can
+  // still reach the sink are below this, and all labels are below twice this.
+  uint64_t num_nodes_;
+
+  // Number of relabels since the last global relabel.
+  uint64_t relabels_since_global_;
+
+  // Epoch-stamped membership markers, so nothing needs to be cleared between
+  // calls. `component_stamp_[id] == epoch_` iff `id` is in `component_`.
+  uint64_t epoch_ = 0;
+  std::vector<uint64_t> component_stamp_;
+  uint64_t bfs_epoch_ = 0;
+  std::vector<uint64_t> bfs_stamp_;
+
+  std::vector<uint64_t> component_;
+  std::vector<uint64_t> bfs_queue_;
+
+  // Per-user state, indexed by user id.
+  std::vector<uint64_t> labels_;
+  std::vector<Cents> excess_;
+  std::vector<uint64_t> current_edge_;
+  std::vector<uint64_t> active_next_;
+  std::vector<uint64_t> bucket_next_;
+  std::vector<uint64_t> bucket_prev_;
+
+  // Per-label state, indexed by label. `active_heads_[l]` is a singly-linked
+  // stack of users with excess at label `l`, and `bucket_heads_[l]` is a
+  // doubly-linked list of all users at label `l`, used by the gap heuristic.
+  std::vector<uint64_t> active_heads_;
+  std::vector<uint64_t> bucket_heads_;
+
+  // An upper bound on the highest label with active users.
+  uint64_t max_active_label_;
+};
+
+}  // namespace debt_simpl
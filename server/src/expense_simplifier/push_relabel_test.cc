@@ -0,0 +1,180 @@
+#include "server/src/expense_simplifier/push_relabel.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "gmock/gmock.h"
+#include "google/protobuf/text_format.h"
+#include "gtest/gtest.h"
+
+#include "server/src/expense_simplifier/csr_graph.h"
+#include "server/src/expense_simplifier/debt_graph.h"
+#include "server/src/expense_simplifier/layered_graph.h"
+#include "server/src/expense_simplifier/random_ledger_testing.h"
+#include "server/src/expense_simplifier/utils.h"
+
+namespace debt_simpl {
+
+using google::protobuf::TextFormat;
+
+class TestPushRelabel : public ::testing::Test {
+ protected:
+  absl::StatusOr<DebtGraph> CreateFromString(
+      absl::string_view debt_list_proto) {
+    DebtList debt_list;
+    if (!TextFormat::ParseFromString(debt_list_proto, &debt_list)) {
+      return absl::InternalError(
+          absl::StrFormat("Failed to construct DebtList proto from string %s",
+                          debt_list_proto));
+    }
+
+    return DebtGraph::BuildFromProto(debt_list);
+  }
+
+  // Computes the max flow from `source` to `sink` with blocking flows.
+  static Cents BlockingMaxFlow(CsrDebtGraph graph, uint64_t source,
+                               uint64_t sink) {
+    Cents total_flow = 0;
+    while (true) {
+      const LayeredGraph blocking_flow =
+          LayeredGraph::ConstructBlockingFlow(graph, source, sink);
+      if (blocking_flow.size() == 0) {
+        return total_flow;
+      }
+
+      uint64_t payer_id = 0;
+      for (const LayeredGraphNode& node : blocking_flow) {
+        if (node.type == LayeredGraphNodeType::Head) {
+          payer_id = node.head.id;
+          continue;
+        }
+        graph.PushFlow(blocking_flow[node.neighbor.neighbor_head_idx].head.id,
+                       payer_id, node.neighbor.flow);
+      }
+      total_flow += blocking_flow.ComputeFlow();
+    }
+  }
+
+  // Returns the net flow out of each user, derived from how much each edge's
+  // capacity changed between `before` and `after`.
+  static std::vector<Cents> NetOutflows(const CsrDebtGraph& before,
+                                        const CsrDebtGraph& after) {
+    std::vector<Cents> outflows(before.NumUsers(), 0);
+    for (uint64_t id = 0; id < before.NumUsers(); id++) {
+      for (uint64_t edge = before.EdgeBegin(id); edge < before.EdgeEnd(id);
+           edge++) {
+        EXPECT_GE(after.Capacity(edge), 0);
+        outflows[id] += before.Capacity(edge) - after.Capacity(edge);
+      }
+    }
+    return outflows;
+  }
+};
+
+TEST_F(TestPushRelabel, SingleTransaction) {
+  ASSERT_OK_AND_DEFINE(DebtGraph, debt_graph, CreateFromString(R"(
+    transactions {
+      lender: "alice"
+      receiver: "bob"
+      cents: 100
+    })"));
+  ASSERT_OK_AND_DEFINE(uint64_t, alice_id, debt_graph.FindUserId("alice"));
+  ASSERT_OK_AND_DEFINE(uint64_t, bob_id, debt_graph.FindUserId("bob"));
+
+  CsrDebtGraph graph(debt_graph);
+  PushRelabelMaxFlow max_flow;
+
+  EXPECT_EQ(max_flow.MaxFlow(&graph, bob_id, alice_id), 100);
+  EXPECT_EQ(graph.Debt(bob_id, alice_id), 0);
+  EXPECT_EQ(graph.Debt(alice_id, bob_id), 100);
+}
+
+TEST_F(TestPushRelabel, NoPath) {
+  ASSERT_OK_AND_DEFINE(DebtGraph, debt_graph, CreateFromString(R"(
+    transactions {
+      lender: "alice"
+      receiver: "bob"
+      cents: 100
+    }
+    transactions {
+      lender: "joe"
+      receiver: "bob"
+      cents: 100
+    })"));
+  ASSERT_OK_AND_DEFINE(uint64_t, alice_id, debt_graph.FindUserId("alice"));
+  ASSERT_OK_AND_DEFINE(uint64_t, joe_id, debt_graph.FindUserId("joe"));
+
+  CsrDebtGraph graph(debt_graph);
+  PushRelabelMaxFlow max_flow;
+
+  EXPECT_EQ(max_flow.MaxFlow(&graph, alice_id, joe_id), 0);
+  EXPECT_EQ(max_flow.MaxFlow(&graph, alice_id, alice_id), 0);
+}
+
+// Tests that excess which can't reach the sink is returned to the source,
+// leaving a valid flow.
+TEST_F(TestPushRelabel, ExcessReturnedToSource) {
+  ASSERT_OK_AND_DEFINE(DebtGraph, debt_graph, CreateFromString(R"(
+    transactions {
+      lender: "a"
+      receiver: "s"
+      cents: 100
+    }
+    transactions {
+      lender: "t"
+      receiver: "a"
+      cents: 10
+    }
+    transactions {
+      lender: "b"
+      receiver: "s"
+      cents: 50
+    })"));
+  ASSERT_OK_AND_DEFINE(uint64_t, s_id, debt_graph.FindUserId("s"));
+  ASSERT_OK_AND_DEFINE(uint64_t, t_id, debt_graph.FindUserId("t"));
+
+  const CsrDebtGraph initial_graph(debt_graph);
+  CsrDebtGraph graph = initial_graph;
+  PushRelabelMaxFlow max_flow;
+
+  EXPECT_EQ(max_flow.MaxFlow(&graph, s_id, t_id), 10);
+
+  const std::vector<Cents> outflows = NetOutflows(initial_graph, graph);
+  for (uint64_t id = 0; id < graph.NumUsers(); id++) {
+    if (id == s_id) {
+      EXPECT_EQ(outflows[id], 10);
+    } else if (id == t_id) {
+      EXPECT_EQ(outflows[id], -10);
+    } else {
+      EXPECT_EQ(outflows[id], 0);
+    }
+  }
+}
+
+TEST_F(TestPushRelabel, MatchesBlockingFlow) {
+  for (uint32_t seed = 0; seed < 20; seed++) {
+    const DebtGraph debt_graph = RandomGraph(30, 120, seed);
+    const CsrDebtGraph initial_graph(debt_graph);
+    PushRelabelMaxFlow max_flow;
+
+    for (uint64_t source = 0; source < 5; source++) {
+      for (uint64_t sink = 5; sink < 10; sink++) {
+        CsrDebtGraph graph = initial_graph;
+        const Cents flow = max_flow.MaxFlow(&graph, source, sink);
+        EXPECT_EQ(flow, BlockingMaxFlow(initial_graph, source, sink))
+            << "seed " << seed << ", " << source << " -> " << sink;
+
+        const std::vector<Cents> outflows = NetOutflows(initial_graph, graph);
+        for (uint64_t id = 0; id < graph.NumUsers(); id++) {
+          const Cents expected =
+              id == source ? flow : (id == sink ? -flow : 0);
+          EXPECT_EQ(outflows[id], expected);
+        }
+      }
+    }
+  }
+}
+
+}  // namespace debt_simpl
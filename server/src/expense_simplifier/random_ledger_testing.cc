@@ -0,0 +1,44 @@
+#include "server/src/expense_simplifier/random_ledger_testing.h"
+
+#include <cstdint>
+#include <random>
+
+#include "absl/strings/str_format.h"
+#include "gtest/gtest.h"
+
+#include "proto/debts.pb.h"
+#include "server/src/expense_simplifier/debt_graph.h"
+#include "server/src/expense_simplifier/utils.h"
+
+namespace debt_simpl {
+
+DebtList RandomLedger(uint64_t num_users, uint64_t num_transactions,
+                      uint32_t seed, Cents max_cents) {
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<uint64_t> user(0, num_users - 1);
+  std::uniform_int_distribution<Cents> cents(1, max_cents);
+
+  DebtList debt_list;
+  for (uint64_t i = 0; i < num_transactions; i++) {
+    Transaction& t = *debt_list.add_transactions();
+    t.set_lender(absl::StrFormat("user%d", user(rng)));
+    t.set_receiver(absl::StrFormat("user%d", user(rng)));
+    t.set_cents(cents(rng));
+  }
+  return debt_list;
+}
+
+DebtGraph RandomGraph(uint64_t num_users, uint64_t num_transactions,
+                      uint32_t seed, Cents max_cents) {
+  const DebtList ledger =
+      RandomLedger(num_users, num_transactions, seed, max_cents);
+  DebtGraph graph;
+  for (const Transaction& t : ledger.transactions()) {
+    if (t.lender() != t.receiver()) {
+      EXPECT_THAT(graph.AddTransaction(t), IsOk());
+    }
+  }
+  return graph;
+}
+
+}  // namespace debt_simpl
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+
+#include "proto/debts.pb.h"
+#include "server/src/expense_simplifier/debt_graph.h"
+
+namespace debt_simpl {
+
+// Returns a random ledger of `num_transactions` transactions between random
+// pairs of `num_users` users, of 1 to `max_cents` each. The same seed always
+// gives the same ledger.
+DebtList RandomLedger(uint64_t num_users, uint64_t num_transactions,
+                      uint32_t seed, Cents max_cents = 1000);
+
+// Same as above, as a graph, without the transactions the ledger has from a
+// user to themselves.
+DebtGraph RandomGraph(uint64_t num_users, uint64_t num_transactions,
+                      uint32_t seed, Cents max_cents = 1000);
+
+}  // namespace debt_simpl
@@ -0,0 +1,394 @@
+#include "server/src/expense_simplifier/simplification_cache.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+
+#include "proto/debts.pb.h"
+#include "server/src/expense_simplifier/debt_graph.h"
+#include "server/src/expense_simplifier/utils.h"
+#include "server/src/util/file_util.h"
+
+namespace debt_simpl {
+
+namespace {
+
+// Appends the bytes of `value` to `out`. Fingerprints are only ever compared
+// with fingerprints made on the same machine, so byte order doesn't matter.
+template <typename T>
+void AppendRaw(const T& value, std::string* out) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Appends `name`, prefixed with its length so that no two lists of names
+// encode the same.
+void AppendName(absl::string_view name, std::string* out) {
+  AppendRaw(static_cast<uint64_t>(name.size()), out);
+  out->append(name.data(), name.size());
+}
+
+// Appends every positive debt of `graph`, sorted by lender then receiver.
+void AppendDebts(const DebtGraph& graph, std::string* out) {
+  struct Debt {
+    absl::string_view lender;
+    absl::string_view receiver;
+    Cents cents;
+  };
+
+  std::vector<Debt> debts;
+  size_t name_bytes = 0;
+  for (const DebtGraphEdge& edge : graph.DebtGraphInternal::AllDebts()) {
+    // Every debt is recorded in both directions, owed and negated.
+    if (edge.debt <= 0) {
+      continue;
+    }
+    debts.push_back(Debt{
+        .lender = graph.UserName(edge.lender_id),
+        .receiver = graph.UserName(edge.receiver_id),
+        .cents = edge.debt,
+    });
+    name_bytes += debts.back().lender.size() + debts.back().receiver.size();
+  }
+  std::sort(debts.begin(), debts.end(), [](const Debt& a, const Debt& b) {
+    return std::tie(a.lender, a.receiver) < std::tie(b.lender, b.receiver);
+  });
+
+  out->reserve(out->size() + name_bytes +
+               debts.size() * (2 * sizeof(uint64_t) + sizeof(Cents)));
+  for (const Debt& debt : debts) {
+    AppendName(debt.lender, out);
+    AppendName(debt.receiver, out);
+    AppendRaw(debt.cents, out);
+  }
+}
+
+// Appends the nonzero net balance of every user of `graph`, sorted by name.
+void AppendNetBalances(const DebtGraph& graph, std::string* out) {
+  std::vector<std::pair<absl::string_view, Cents>> balances;
+  size_t name_bytes = 0;
+  for (uint64_t id = 0; id < graph.NumUsers(); id++) {
+    const Cents total_debt = graph.DebtGraphInternal::TotalDebt(id);
+    if (total_debt != 0) {
+      balances.emplace_back(graph.UserName(id), total_debt);
+      name_bytes += balances.back().first.size();
+    }
+  }
+  std::sort(balances.begin(), balances.end());
+
+  out->reserve(out->size() + name_bytes +
+               balances.size() * (sizeof(uint64_t) + sizeof(Cents)));
+  for (const auto& [name, total_debt] : balances) {
+    AppendName(name, out);
+    AppendRaw(total_debt, out);
+  }
+}
+
+// A snapshot is a header, then an index of every saved result sorted by
+// fingerprint, then the fingerprints and serialized results the index points
+// into.
+constexpr char kSnapshotMagic[8] = { 'D', 'S', 'C', 'A', 'C', 'H', 'E', '\0' };
+
+// Bumped whenever fingerprints or the format change, so that results are
+// never restored for fingerprints that mean something else now.
+constexpr uint32_t kSnapshotVersion = 1;
+
+struct SnapshotHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t num_entries;
+};
+
+struct SnapshotIndexEntry {
+  uint64_t fingerprint_offset;
+  uint64_t fingerprint_size;
+  uint64_t result_offset;
+  uint64_t result_size;
+};
+
+}  // namespace
+
+class SimplificationCache::Snapshot {
+ public:
+  static absl::StatusOr<std::shared_ptr<const Snapshot>> Open(
+      const std::string& path) {
+    DEFINE_OR_RETURN(MappedFile, file, MappedFile::Open(path));
+    const absl::string_view contents = file.contents();
+    SnapshotHeader header;
+    if (contents.size() < sizeof(header)) {
+      return absl::DataLossError(
+          absl::StrFormat("Cache snapshot %s is too short", path));
+    }
+    std::memcpy(&header, contents.data(), sizeof(header));
+    if (std::memcmp(header.magic, kSnapshotMagic, sizeof(kSnapshotMagic)) !=
+        0) {
+      return absl::DataLossError(
+          absl::StrFormat("%s is not a cache snapshot", path));
+    }
+    if (header.version != kSnapshotVersion) {
+      return absl::FailedPreconditionError(
+          absl::StrFormat("Cache snapshot %s has version %u, expected %u",
+                          path, header.version, kSnapshotVersion));
+    }
+    if (header.num_entries >
+        (contents.size() - sizeof(header)) / sizeof(SnapshotIndexEntry)) {
+      return absl::DataLossError(
+          absl::StrFormat("Cache snapshot %s is truncated", path));
+    }
+    return std::shared_ptr<const Snapshot>(
+        new Snapshot(std::move(file), header.num_entries));
+  }
+
+  uint64_t size() const {
+    return num_entries_;
+  }
+
+  // Reads entry `i` of the index, returning false if it points out of the
+  // file.
+  bool Entry(uint64_t i, absl::string_view* fingerprint,
+             absl::string_view* result) const {
+    const absl::string_view contents = file_.contents();
+    SnapshotIndexEntry entry;
+    std::memcpy(&entry,
+                contents.data() + sizeof(SnapshotHeader) + i * sizeof(entry),
+                sizeof(entry));
+    if (entry.fingerprint_offset > contents.size() ||
+        entry.fingerprint_size > contents.size() - entry.fingerprint_offset ||
+        entry.result_offset > contents.size() ||
+        entry.result_size > contents.size() - entry.result_offset) {
+      return false;
+    }
+    *fingerprint = contents.substr(entry.fingerprint_offset,
+                                   entry.fingerprint_size);
+    *result = contents.substr(entry.result_offset, entry.result_size);
+    return true;
+  }
+
+  // Returns the serialized result saved for `fingerprint`, if any, with a
+  // binary search of the index.
+  std::optional<absl::string_view> Find(absl::string_view fingerprint) const {
+    uint64_t begin = 0;
+    uint64_t end = num_entries_;
+    while (begin < end) {
+      const uint64_t mid = begin + (end - begin) / 2;
+      absl::string_view entry_fingerprint;
+      absl::string_view result;
+      if (!Entry(mid, &entry_fingerprint, &result)) {
+        return std::nullopt;
+      }
+      if (entry_fingerprint == fingerprint) {
+        return result;
+      }
+      if (entry_fingerprint < fingerprint) {
+        begin = mid + 1;
+      } else {
+        end = mid;
+      }
+    }
+    return std::nullopt;
+  }
+
+ private:
+  Snapshot(MappedFile file, uint64_t num_entries)
+      : file_(std::move(file)), num_entries_(num_entries) {}
+
+  const MappedFile file_;
+  const uint64_t num_entries_;
+};
+
+SimplificationCache::SimplificationCache(
+    const SimplificationCacheOptions& options)
+    : options_(options) {}
+
+// static
+std::string SimplificationCache::Fingerprint(const DebtGraph& graph,
+                                             SimplificationMode mode) {
+  std::string fingerprint;
+  AppendRaw(static_cast<uint8_t>(mode), &fingerprint);
+  switch (mode) {
+    case SimplificationMode::kExistingEdges:
+      AppendDebts(graph, &fingerprint);
+      break;
+    case SimplificationMode::kNetBalances:
+    case SimplificationMode::kMinTransactions:
+      AppendNetBalances(graph, &fingerprint);
+      break;
+  }
+  return fingerprint;
+}
+
+std::shared_ptr<const DebtList> SimplificationCache::Lookup(
+    absl::string_view fingerprint) {
+  std::shared_ptr<const Snapshot> snapshot;
+  {
+    absl::MutexLock lock(&mutex_);
+    const auto it = index_.find(fingerprint);
+    if (it != index_.end()) {
+      stats_.hits++;
+      entries_.splice(entries_.begin(), entries_, it->second);
+      return it->second->transactions;
+    }
+    snapshot = snapshot_;
+  }
+
+  // Results are parsed outside the lock, as they can be large. Two lookups of
+  // the same result may both parse it, which is harmless.
+  const std::optional<absl::string_view> serialized =
+      snapshot != nullptr ? snapshot->Find(fingerprint) : std::nullopt;
+  auto transactions = std::make_shared<DebtList>();
+  if (!serialized.has_value() ||
+      !transactions->ParseFromArray(serialized->data(),
+                                    static_cast<int>(serialized->size()))) {
+    absl::MutexLock lock(&mutex_);
+    stats_.misses++;
+    return nullptr;
+  }
+  const size_t bytes = sizeof(Entry) + fingerprint.size() +
+                       transactions->SpaceUsedLong();
+
+  absl::MutexLock lock(&mutex_);
+  stats_.hits++;
+  stats_.restored++;
+  if (options_.max_entries != 0 && bytes <= options_.max_bytes) {
+    InsertShared(std::string(fingerprint), transactions, bytes);
+  }
+  return transactions;
+}
+
+void SimplificationCache::Insert(std::string fingerprint,
+                                 DebtList transactions) {
+  const size_t bytes = sizeof(Entry) + fingerprint.capacity() +
+                       transactions.SpaceUsedLong();
+  if (options_.max_entries == 0 || bytes > options_.max_bytes) {
+    return;
+  }
+  auto shared_transactions =
+      std::make_shared<const DebtList>(std::move(transactions));
+
+  absl::MutexLock lock(&mutex_);
+  InsertShared(std::move(fingerprint), std::move(shared_transactions), bytes);
+}
+
+void SimplificationCache::InsertShared(
+    std::string fingerprint, std::shared_ptr<const DebtList> transactions,
+    size_t bytes) {
+  if (const auto it = index_.find(fingerprint); it != index_.end()) {
+    Erase(it->second);
+  }
+  entries_.push_front(Entry{
+      .fingerprint = std::move(fingerprint),
+      .transactions = std::move(transactions),
+      .bytes = bytes,
+  });
+  index_.emplace(entries_.front().fingerprint, entries_.begin());
+  stats_.entries++;
+  stats_.bytes += bytes;
+
+  while (stats_.entries > options_.max_entries ||
+         stats_.bytes > options_.max_bytes) {
+    Erase(std::prev(entries_.end()));
+  }
+}
+
+SimplificationCache::Stats SimplificationCache::GetStats() const {
+  absl::MutexLock lock(&mutex_);
+  return stats_;
+}
+
+absl::Status SimplificationCache::Save(const std::string& path) const {
+  std::vector<std::pair<std::string, std::shared_ptr<const DebtList>>> live;
+  std::shared_ptr<const Snapshot> snapshot;
+  {
+    absl::MutexLock lock(&mutex_);
+    live.reserve(entries_.size());
+    for (const Entry& entry : entries_) {
+      live.emplace_back(entry.fingerprint, entry.transactions);
+    }
+    snapshot = snapshot_;
+  }
+
+  // Views of the fingerprints and serialized results to save, which point
+  // into `live`, `serialized` and the restored snapshot.
+  std::vector<std::pair<absl::string_view, absl::string_view>> saved;
+  std::vector<std::string> serialized(live.size());
+  absl::flat_hash_set<absl::string_view> saved_fingerprints;
+  size_t saved_bytes = 0;
+  const auto save = [&](absl::string_view fingerprint,
+                        absl::string_view result) {
+    if (saved.size() >= options_.max_entries ||
+        saved_bytes + fingerprint.size() + result.size() > options_.max_bytes ||
+        !saved_fingerprints.insert(fingerprint).second) {
+      return;
+    }
+    saved.emplace_back(fingerprint, result);
+    saved_bytes += fingerprint.size() + result.size();
+  };
+  for (size_t i = 0; i < live.size(); i++) {
+    serialized[i] = live[i].second->SerializeAsString();
+    save(live[i].first, serialized[i]);
+  }
+  for (uint64_t i = 0; snapshot != nullptr && i < snapshot->size(); i++) {
+    absl::string_view fingerprint;
+    absl::string_view result;
+    if (snapshot->Entry(i, &fingerprint, &result)) {
+      save(fingerprint, result);
+    }
+  }
+  std::sort(saved.begin(), saved.end());
+
+  SnapshotHeader header = {};
+  std::memcpy(header.magic, kSnapshotMagic, sizeof(kSnapshotMagic));
+  header.version = kSnapshotVersion;
+  header.num_entries = saved.size();
+
+  std::string contents;
+  const uint64_t data_offset =
+      sizeof(header) + saved.size() * sizeof(SnapshotIndexEntry);
+  contents.reserve(data_offset + saved_bytes);
+  AppendRaw(header, &contents);
+  uint64_t offset = data_offset;
+  for (const auto& [fingerprint, result] : saved) {
+    AppendRaw(SnapshotIndexEntry{ .fingerprint_offset = offset,
+                                  .fingerprint_size = fingerprint.size(),
+                                  .result_offset = offset + fingerprint.size(),
+                                  .result_size = result.size() },
+              &contents);
+    offset += fingerprint.size() + result.size();
+  }
+  for (const auto& [fingerprint, result] : saved) {
+    contents.append(fingerprint.data(), fingerprint.size());
+    contents.append(result.data(), result.size());
+  }
+  return WriteFileAtomically(path, contents);
+}
+
+absl::Status SimplificationCache::Restore(const std::string& path) {
+  DEFINE_OR_RETURN(std::shared_ptr<const Snapshot>, snapshot,
+                   Snapshot::Open(path));
+  absl::MutexLock lock(&mutex_);
+  snapshot_ = std::move(snapshot);
+  return absl::OkStatus();
+}
+
+void SimplificationCache::Erase(std::list<Entry>::iterator it) {
+  stats_.entries--;
+  stats_.bytes -= it->bytes;
+  index_.erase(it->fingerprint);
+  entries_.erase(it);
+}
+
+}  // namespace debt_simpl
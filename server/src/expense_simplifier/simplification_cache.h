@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+
+#include "proto/debts.pb.h"
+#include "server/src/expense_simplifier/debt_graph.h"
+#include "server/src/expense_simplifier/expense_simplifier.h"
+
+namespace debt_simpl {
+
+struct SimplificationCacheOptions {
+  // The least recently used results are evicted once either bound is
+  // exceeded. A result larger than `max_bytes` on its own is never cached.
+  size_t max_entries = 1024;
+  size_t max_bytes = 64 << 20;
+};
+
+// A thread-safe LRU cache of minimal transactions, keyed by the fingerprint
+// of the graph they settle.
+//
+// The simplifier only reroutes debts over the edges of its input, so its
+// result depends on nothing but the net debt between each pair of users, or
+// only on net balances when settling those directly. Two ledgers with the
+// same fingerprint can share a result no matter the order their transactions
+// came in.
+//
+// The cache can be saved to a snapshot and restored from it, so that a
+// restarted server doesn't start cold.
+class SimplificationCache {
+ public:
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    // Hits on results restored from a snapshot, the first time each is used.
+    uint64_t restored = 0;
+    size_t entries = 0;
+    size_t bytes = 0;
+  };
+
+  explicit SimplificationCache(const SimplificationCacheOptions& options = {});
+
+  SimplificationCache(const SimplificationCache&) = delete;
+  SimplificationCache& operator=(const SimplificationCache&) = delete;
+
+  // Returns the canonical encoding of what the result of simplifying `graph`
+  // in `mode` depends on. That is every positive debt, sorted by lender then
+  // receiver name, or only the nonzero net balances, sorted by name, in the
+  // modes settling those directly. Graphs with the same fingerprint simplify
+  // the same, so hits are exact rather than trusting a hash not to collide.
+  static std::string Fingerprint(
+      const DebtGraph& graph,
+      SimplificationMode mode = SimplificationMode::kExistingEdges);
+
+  // Returns the transactions cached for `fingerprint` and marks them most
+  // recently used, or returns nullptr if there are none. Results restored
+  // from a snapshot are parsed and cached the first time they are looked up.
+  std::shared_ptr<const DebtList> Lookup(absl::string_view fingerprint);
+
+  // Caches `transactions` as the result for `fingerprint`, replacing any
+  // previous result, then evicts entries until the cache is within bounds.
+  void Insert(std::string fingerprint, DebtList transactions);
+
+  Stats GetStats() const;
+
+  // Writes the cached results to a snapshot at `path`, most recently used
+  // first, followed by the restored results that weren't looked up since,
+  // until the bounds of the cache are reached.
+  absl::Status Save(const std::string& path) const;
+
+  // Restores the results saved to the snapshot at `path`, replacing any
+  // restored before. The snapshot is mapped rather than read, and each result
+  // is only parsed once it is looked up, so restoring takes constant time no
+  // matter how many results were saved.
+  absl::Status Restore(const std::string& path);
+
+ private:
+  struct Entry {
+    std::string fingerprint;
+    std::shared_ptr<const DebtList> transactions;
+    size_t bytes;
+  };
+
+  // A mapped snapshot written by `Save()`.
+  class Snapshot;
+
+  // Caches `transactions`, of `bytes` bytes, as the result for `fingerprint`
+  // like `Insert()`.
+  void InsertShared(std::string fingerprint,
+                    std::shared_ptr<const DebtList> transactions, size_t bytes)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Erases the entry `it` points to.
+  void Erase(std::list<Entry>::iterator it)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const SimplificationCacheOptions options_;
+
+  mutable absl::Mutex mutex_;
+  // Most recently used first.
+  std::list<Entry> entries_ ABSL_GUARDED_BY(mutex_);
+  // Keys point into the fingerprints of `entries_`, whose nodes never move.
+  absl::flat_hash_map<absl::string_view, std::list<Entry>::iterator> index_
+      ABSL_GUARDED_BY(mutex_);
+  Stats stats_ ABSL_GUARDED_BY(mutex_);
+  // Never modified once restored, so lookups search it without the lock.
+  std::shared_ptr<const Snapshot> snapshot_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace debt_simpl
@@ -0,0 +1,254 @@
+#include "server/src/expense_simplifier/simplification_cache.h"
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "proto/debts.pb.h"
+#include "server/src/expense_simplifier/debt_graph.h"
+#include "server/src/expense_simplifier/debt_list_testing.h"
+#include "server/src/expense_simplifier/expense_simplifier.h"
+#include "server/src/expense_simplifier/utils.h"
+
+namespace debt_simpl {
+
+using ::testing::Not;
+
+class TestSimplificationCache : public ::testing::Test {
+ protected:
+  // Returns the fingerprint of the graph built from `debts`, given as
+  // (lender, receiver, cents).
+  static std::string FingerprintOf(
+      const std::vector<std::tuple<std::string, std::string, Cents>>& debts,
+      SimplificationMode mode = SimplificationMode::kExistingEdges) {
+    return SimplificationCache::Fingerprint(GraphOf(debts), mode);
+  }
+
+  // Returns a result of `num_transactions` transactions.
+  static DebtList Transactions(int num_transactions) {
+    DebtList debt_list;
+    for (int i = 0; i < num_transactions; i++) {
+      Transaction& t = *debt_list.add_transactions();
+      t.set_lender("lender");
+      t.set_receiver("receiver");
+      t.set_cents(i + 1);
+    }
+    return debt_list;
+  }
+
+  // Returns a path for a snapshot of the test, unique to `name`.
+  static std::string SnapshotPath(absl::string_view name) {
+    return absl::StrCat(::testing::TempDir(), "/simplification_cache_test_",
+                        name, ".snap");
+  }
+};
+
+TEST_F(TestSimplificationCache, FingerprintIgnoresTransactionOrder) {
+  EXPECT_EQ(FingerprintOf({ { "a", "b", 5 }, { "c", "a", 7 } }),
+            FingerprintOf({ { "c", "a", 7 }, { "a", "b", 5 } }));
+}
+
+TEST_F(TestSimplificationCache, FingerprintNetsDebts) {
+  EXPECT_EQ(FingerprintOf({ { "a", "b", 5 }, { "b", "a", 3 } }),
+            FingerprintOf({ { "a", "b", 2 } }));
+  EXPECT_EQ(FingerprintOf({ { "a", "b", 2 }, { "a", "b", 3 } }),
+            FingerprintOf({ { "a", "b", 5 } }));
+}
+
+TEST_F(TestSimplificationCache, FingerprintDistinguishesDebts) {
+  // Same balances, but different edges to reroute debts over.
+  EXPECT_NE(FingerprintOf({ { "a", "b", 5 }, { "b", "c", 5 } }),
+            FingerprintOf({ { "a", "c", 5 } }));
+  EXPECT_NE(FingerprintOf({ { "a", "b", 5 } }),
+            FingerprintOf({ { "b", "a", 5 } }));
+  EXPECT_NE(FingerprintOf({ { "a", "b", 5 } }),
+            FingerprintOf({ { "a", "b", 6 } }));
+  // Names can't run into each other.
+  EXPECT_NE(FingerprintOf({ { "ab", "c", 5 } }),
+            FingerprintOf({ { "a", "bc", 5 } }));
+}
+
+TEST_F(TestSimplificationCache, NetBalancesFingerprintOnlyKeepsBalances) {
+  constexpr SimplificationMode kNetBalances = SimplificationMode::kNetBalances;
+  // b ends up even either way, and a is owed 5 by c.
+  EXPECT_EQ(FingerprintOf({ { "a", "b", 5 }, { "b", "c", 5 } }, kNetBalances),
+            FingerprintOf({ { "a", "c", 5 } }, kNetBalances));
+  EXPECT_NE(FingerprintOf({ { "a", "c", 5 } }, kNetBalances),
+            FingerprintOf({ { "a", "c", 6 } }, kNetBalances));
+  // Results of different modes are never shared.
+  EXPECT_NE(FingerprintOf({ { "a", "c", 5 } }, kNetBalances),
+            FingerprintOf({ { "a", "c", 5 } }));
+}
+
+TEST_F(TestSimplificationCache, CountsHitsAndMisses) {
+  SimplificationCache cache;
+  EXPECT_EQ(cache.Lookup("key"), nullptr);
+
+  cache.Insert("key", Transactions(3));
+  std::shared_ptr<const DebtList> hit = cache.Lookup("key");
+  ASSERT_NE(hit, nullptr);
+  EXPECT_EQ(hit->transactions_size(), 3);
+  EXPECT_EQ(cache.Lookup("other"), nullptr);
+
+  const SimplificationCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.misses, 2);
+  EXPECT_EQ(stats.entries, 1);
+  EXPECT_GT(stats.bytes, 0);
+}
+
+TEST_F(TestSimplificationCache, InsertReplacesResult) {
+  SimplificationCache cache;
+  cache.Insert("key", Transactions(3));
+  cache.Insert("key", Transactions(4));
+
+  std::shared_ptr<const DebtList> hit = cache.Lookup("key");
+  ASSERT_NE(hit, nullptr);
+  EXPECT_EQ(hit->transactions_size(), 4);
+  EXPECT_EQ(cache.GetStats().entries, 1);
+}
+
+TEST_F(TestSimplificationCache, EvictsLeastRecentlyUsedEntry) {
+  SimplificationCache cache({ .max_entries = 2 });
+  cache.Insert("a", Transactions(1));
+  cache.Insert("b", Transactions(1));
+  // Makes "b" the least recently used.
+  EXPECT_NE(cache.Lookup("a"), nullptr);
+  cache.Insert("c", Transactions(1));
+
+  EXPECT_NE(cache.Lookup("a"), nullptr);
+  EXPECT_EQ(cache.Lookup("b"), nullptr);
+  EXPECT_NE(cache.Lookup("c"), nullptr);
+  EXPECT_EQ(cache.GetStats().entries, 2);
+}
+
+TEST_F(TestSimplificationCache, EvictsToStayWithinMemoryBound) {
+  SimplificationCache unbounded;
+  unbounded.Insert("a", Transactions(100));
+  const size_t entry_bytes = unbounded.GetStats().bytes;
+
+  SimplificationCache cache({ .max_bytes = 2 * entry_bytes + entry_bytes / 2 });
+  cache.Insert("a", Transactions(100));
+  cache.Insert("b", Transactions(100));
+  cache.Insert("c", Transactions(100));
+
+  EXPECT_EQ(cache.Lookup("a"), nullptr);
+  EXPECT_NE(cache.Lookup("b"), nullptr);
+  EXPECT_NE(cache.Lookup("c"), nullptr);
+  EXPECT_LE(cache.GetStats().bytes, 2 * entry_bytes + entry_bytes / 2);
+}
+
+TEST_F(TestSimplificationCache, SkipsResultsLargerThanMemoryBound) {
+  SimplificationCache cache({ .max_bytes = 1024 });
+  cache.Insert("small", Transactions(1));
+  cache.Insert("large", Transactions(1000));
+
+  EXPECT_NE(cache.Lookup("small"), nullptr);
+  EXPECT_EQ(cache.Lookup("large"), nullptr);
+}
+
+TEST_F(TestSimplificationCache, EvictedResultsOutliveTheirEntry) {
+  SimplificationCache cache({ .max_entries = 1 });
+  cache.Insert("a", Transactions(2));
+  std::shared_ptr<const DebtList> hit = cache.Lookup("a");
+  cache.Insert("b", Transactions(1));
+
+  ASSERT_NE(hit, nullptr);
+  EXPECT_EQ(hit->transactions_size(), 2);
+}
+
+TEST_F(TestSimplificationCache, RestoresSavedResultsOnLookup) {
+  const std::string path = SnapshotPath("restore");
+  SimplificationCache saved;
+  saved.Insert("a", Transactions(2));
+  saved.Insert("b", Transactions(3));
+  ASSERT_THAT(saved.Save(path), IsOk());
+
+  SimplificationCache cache;
+  ASSERT_THAT(cache.Restore(path), IsOk());
+  // Nothing is parsed until it is looked up.
+  EXPECT_EQ(cache.GetStats().entries, 0);
+
+  std::shared_ptr<const DebtList> hit = cache.Lookup("b");
+  ASSERT_NE(hit, nullptr);
+  EXPECT_EQ(hit->transactions_size(), 3);
+  EXPECT_NE(cache.Lookup("b"), nullptr);
+  EXPECT_EQ(cache.Lookup("c"), nullptr);
+
+  const SimplificationCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(stats.hits, 2);
+  EXPECT_EQ(stats.restored, 1);
+  EXPECT_EQ(stats.misses, 1);
+  EXPECT_EQ(stats.entries, 1);
+  std::remove(path.c_str());
+}
+
+TEST_F(TestSimplificationCache, SaveKeepsRestoredResults) {
+  const std::string first_path = SnapshotPath("first");
+  const std::string second_path = SnapshotPath("second");
+  SimplificationCache first;
+  first.Insert("a", Transactions(1));
+  first.Insert("b", Transactions(1));
+  ASSERT_THAT(first.Save(first_path), IsOk());
+
+  // "a" is replaced, and "b" is saved again without being looked up.
+  SimplificationCache second;
+  ASSERT_THAT(second.Restore(first_path), IsOk());
+  second.Insert("a", Transactions(4));
+  second.Insert("c", Transactions(1));
+  ASSERT_THAT(second.Save(second_path), IsOk());
+
+  SimplificationCache third;
+  ASSERT_THAT(third.Restore(second_path), IsOk());
+  std::shared_ptr<const DebtList> hit = third.Lookup("a");
+  ASSERT_NE(hit, nullptr);
+  EXPECT_EQ(hit->transactions_size(), 4);
+  EXPECT_NE(third.Lookup("b"), nullptr);
+  EXPECT_NE(third.Lookup("c"), nullptr);
+  std::remove(first_path.c_str());
+  std::remove(second_path.c_str());
+}
+
+TEST_F(TestSimplificationCache, SaveStaysWithinBounds) {
+  const std::string path = SnapshotPath("bounds");
+  SimplificationCache saved({ .max_entries = 2 });
+  saved.Insert("a", Transactions(1));
+  saved.Insert("b", Transactions(1));
+  ASSERT_THAT(saved.Save(path), IsOk());
+
+  SimplificationCache cache({ .max_entries = 1 });
+  ASSERT_THAT(cache.Restore(path), IsOk());
+  cache.Insert("c", Transactions(1));
+  ASSERT_THAT(cache.Save(path), IsOk());
+
+  SimplificationCache restored;
+  ASSERT_THAT(restored.Restore(path), IsOk());
+  EXPECT_NE(restored.Lookup("c"), nullptr);
+  EXPECT_EQ(restored.Lookup("a"), nullptr);
+  EXPECT_EQ(restored.Lookup("b"), nullptr);
+  std::remove(path.c_str());
+}
+
+TEST_F(TestSimplificationCache, RestoreRejectsOtherFiles) {
+  SimplificationCache cache;
+  EXPECT_EQ(cache.Restore(SnapshotPath("missing")).code(),
+            absl::StatusCode::kNotFound);
+
+  const std::string path = SnapshotPath("garbage");
+  FILE* file = std::fopen(path.c_str(), "w");
+  ASSERT_NE(file, nullptr);
+  std::fputs("not a snapshot, just some text", file);
+  std::fclose(file);
+  EXPECT_THAT(cache.Restore(path), Not(IsOk()));
+  std::remove(path.c_str());
+}
+
+}  // namespace debt_simpl
@@ -0,0 +1,143 @@
+#include "server/src/expense_simplifier/thread_pool.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <utility>
+
+#include "absl/synchronization/mutex.h"
+
+namespace debt_simpl {
+
+namespace {
+
+thread_local uint32_t current_worker_index = ThreadPool::kNotAWorker;
+thread_local const ThreadPool* current_pool = nullptr;
+
+}  // namespace
+
+ThreadPool::ThreadPool(uint32_t num_threads) {
+  queues_.reserve(num_threads);
+  for (uint32_t i = 0; i < num_threads; i++) {
+    queues_.push_back(std::make_unique<WorkerQueue>());
+  }
+
+  workers_.reserve(num_threads);
+  for (uint32_t i = 0; i < num_threads; i++) {
+    workers_.emplace_back([this, i]() { WorkerLoop(i); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  Wait();
+  {
+    absl::MutexLock lock(&mutex_);
+    shutting_down_ = true;
+    task_queued_.SignalAll();
+  }
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+uint32_t ThreadPool::NumThreads() const {
+  return static_cast<uint32_t>(workers_.size());
+}
+
+void ThreadPool::Schedule(std::function<void()> task) {
+  const uint32_t queue_index =
+      current_pool == this
+          ? current_worker_index
+          : next_queue_.fetch_add(1, std::memory_order_relaxed) %
+                queues_.size();
+  // The task is counted before it becomes visible in its queue, so that no
+  // worker can take and finish it before it is counted.
+  num_pending_++;
+  {
+    WorkerQueue& queue = *queues_[queue_index];
+    absl::MutexLock queue_lock(&queue.mutex);
+    queue.tasks.push_back(std::move(task));
+    num_queued_++;
+  }
+  // Workers count themselves as sleeping before they check `num_queued_` one
+  // last time, so either they see the task or this sees them.
+  if (num_sleeping_ != 0) {
+    absl::MutexLock lock(&mutex_);
+    task_queued_.Signal();
+  }
+}
+
+void ThreadPool::Wait() {
+  absl::MutexLock lock(&mutex_);
+  while (num_pending_ != 0) {
+    idle_.Wait(&mutex_);
+  }
+}
+
+// static
+uint32_t ThreadPool::CurrentWorkerIndex() {
+  return current_worker_index;
+}
+
+bool ThreadPool::TakeTask(uint32_t worker_index, std::function<void()>* task) {
+  {
+    WorkerQueue& queue = *queues_[worker_index];
+    absl::MutexLock lock(&queue.mutex);
+    if (!queue.tasks.empty()) {
+      *task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+      num_queued_--;
+      return true;
+    }
+  }
+
+  for (uint32_t i = 1; i < queues_.size(); i++) {
+    WorkerQueue& queue = *queues_[(worker_index + i) % queues_.size()];
+    absl::MutexLock lock(&queue.mutex);
+    if (!queue.tasks.empty()) {
+      *task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+      num_queued_--;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ThreadPool::WaitForTask() {
+  absl::MutexLock lock(&mutex_);
+  num_sleeping_++;
+  while (num_queued_ == 0 && !shutting_down_) {
+    task_queued_.Wait(&mutex_);
+  }
+  num_sleeping_--;
+  return num_queued_ != 0;
+}
+
+void ThreadPool::WorkerLoop(uint32_t worker_index) {
+  current_worker_index = worker_index;
+  current_pool = this;
+
+  std::function<void()> task;
+  while (true) {
+    // A scan only misses when every queue is empty, or when a task was
+    // queued behind it, which `num_queued_` then shows.
+    if (!TakeTask(worker_index, &task)) {
+      if (!WaitForTask()) {
+        return;
+      }
+      continue;
+    }
+
+    task();
+    task = nullptr;
+
+    if (--num_pending_ == 0) {
+      absl::MutexLock lock(&mutex_);
+      idle_.SignalAll();
+    }
+  }
+}
+
+}  // namespace debt_simpl
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace debt_simpl {
+
+// A fixed-size pool of worker threads with work stealing.
+//
+// Every worker owns a task queue. Tasks scheduled from outside of the pool are
+// spread round-robin over the queues, and tasks scheduled by a running task go
+// to its own worker's queue. Workers run their own tasks newest first, which
+// keeps recently touched data in cache, and steal the oldest task of another
+// worker when their own queue runs dry.
+class ThreadPool {
+ public:
+  explicit ThreadPool(uint32_t num_threads);
+
+  // Waits for all scheduled tasks to finish, then joins the workers.
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  uint32_t NumThreads() const;
+
+  // Schedules `task` to run on one of the workers.
+  void Schedule(std::function<void()> task);
+
+  // Blocks until every task scheduled so far has finished running.
+  void Wait();
+
+  // Returns the index in [0, NumThreads()) of the worker running the calling
+  // task, or `kNotAWorker` if called from outside of a pool. Useful for
+  // indexing per-worker scratch buffers.
+  static uint32_t CurrentWorkerIndex();
+
+  static constexpr uint32_t kNotAWorker = UINT32_MAX;
+
+ private:
+  struct WorkerQueue {
+    absl::Mutex mutex;
+    std::deque<std::function<void()>> tasks ABSL_GUARDED_BY(mutex);
+  };
+
+  // Takes the newest task of worker `worker_index`, or else the oldest task of
+  // any other worker. Returns false if every queue was empty when scanned.
+  bool TakeTask(uint32_t worker_index, std::function<void()>* task);
+
+  // Blocks until a task is queued or the pool shuts down. Returns false if it
+  // shut down with no task left.
+  bool WaitForTask();
+
+  void WorkerLoop(uint32_t worker_index);
+
+  std::vector<std::unique_ptr<WorkerQueue>> queues_;
+  // The queue the next task scheduled from outside of the pool goes to.
+  std::atomic<uint32_t> next_queue_ = 0;
+
+  // The number of tasks sitting in the queues, which changes along with
+  // them under their locks. Workers only sleep when it is 0.
+  std::atomic<uint64_t> num_queued_ = 0;
+  // The number of tasks scheduled but not yet finished.
+  std::atomic<uint64_t> num_pending_ = 0;
+  // The number of workers going to sleep or asleep on `task_queued_`, which
+  // `Schedule()` only takes `mutex_` to wake if there are any.
+  std::atomic<uint32_t> num_sleeping_ = 0;
+
+  // Only taken by workers going to sleep and by whoever wakes them, and to
+  // wait for the pool to go idle, never to schedule or take a task.
+  absl::Mutex mutex_;
+  absl::CondVar task_queued_;
+  absl::CondVar idle_;
+  bool shutting_down_ ABSL_GUARDED_BY(mutex_) = false;
+
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace debt_simpl
@@ -0,0 +1,109 @@
+#include "server/src/expense_simplifier/thread_pool.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace debt_simpl {
+
+TEST(TestThreadPool, RunsAllTasks) {
+  ThreadPool pool(4);
+  std::atomic<uint64_t> sum = 0;
+  for (uint64_t i = 1; i <= 1000; i++) {
+    pool.Schedule([&sum, i]() { sum += i; });
+  }
+  pool.Wait();
+
+  EXPECT_EQ(sum, 500500);
+}
+
+TEST(TestThreadPool, WorkerIndicesInRange) {
+  ThreadPool pool(3);
+  std::vector<uint64_t> tasks_per_worker(pool.NumThreads(), 0);
+  std::atomic<bool> out_of_range = false;
+  for (uint64_t i = 0; i < 100; i++) {
+    pool.Schedule([&]() {
+      const uint32_t index = ThreadPool::CurrentWorkerIndex();
+      if (index >= tasks_per_worker.size()) {
+        out_of_range = true;
+        return;
+      }
+      // Only the worker owning a slot ever writes to it.
+      tasks_per_worker[index]++;
+    });
+  }
+  pool.Wait();
+
+  EXPECT_FALSE(out_of_range);
+  uint64_t total = 0;
+  for (const uint64_t count : tasks_per_worker) {
+    total += count;
+  }
+  EXPECT_EQ(total, 100);
+  EXPECT_EQ(ThreadPool::CurrentWorkerIndex(), ThreadPool::kNotAWorker);
+}
+
+TEST(TestThreadPool, ReusableAfterWait) {
+  ThreadPool pool(2);
+  std::atomic<uint64_t> count = 0;
+  for (uint32_t round = 0; round < 3; round++) {
+    for (uint32_t i = 0; i < 10; i++) {
+      pool.Schedule([&count]() { count++; });
+    }
+    pool.Wait();
+    EXPECT_EQ(count, 10 * (round + 1));
+  }
+}
+
+TEST(TestThreadPool, TasksScheduledFromTasksStolen) {
+  ThreadPool pool(4);
+  std::atomic<uint64_t> count = 0;
+  // All subtasks land in the queue of the worker running the parent task, so
+  // the other workers only get to them by stealing.
+  pool.Schedule([&pool, &count]() {
+    for (uint32_t i = 0; i < 1000; i++) {
+      pool.Schedule([&count]() { count++; });
+    }
+  });
+  pool.Wait();
+
+  EXPECT_EQ(count, 1000);
+}
+
+TEST(TestThreadPool, WaitCoversTasksScheduledConcurrently) {
+  ThreadPool pool(4);
+  for (uint32_t round = 0; round < 50; round++) {
+    std::atomic<uint64_t> count = 0;
+    std::vector<std::thread> schedulers;
+    for (uint32_t i = 0; i < 4; i++) {
+      schedulers.emplace_back([&pool, &count]() {
+        for (uint32_t j = 0; j < 100; j++) {
+          pool.Schedule([&count]() { count++; });
+        }
+      });
+    }
+    for (std::thread& scheduler : schedulers) {
+      scheduler.join();
+    }
+    pool.Wait();
+    EXPECT_EQ(count, 400);
+  }
+}
+
+TEST(TestThreadPool, WakesSleepingWorkers) {
+  ThreadPool pool(4);
+  uint64_t count = 0;
+  // Every task is scheduled after all workers found nothing to do, so each one
+  // must wake one up.
+  for (uint32_t i = 0; i < 10000; i++) {
+    pool.Schedule([&count]() { count++; });
+    pool.Wait();
+  }
+
+  EXPECT_EQ(count, 10000);
+}
+
+}  // namespace debt_simpl
@@ -0,0 +1,118 @@
+#include "server/src/expense_simplifier/user_name_arena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+
+namespace debt_simpl {
+
+UserNameArena::UserNameArena(const UserNameArena& other) {
+  *this = other;
+}
+
+UserNameArena& UserNameArena::operator=(const UserNameArena& other) {
+  if (this == &other) {
+    return *this;
+  }
+  blocks_.clear();
+  block_next_ = nullptr;
+  block_remaining_ = 0;
+  next_block_size_ = kMinBlockSize;
+  ids_.clear();
+  names_.clear();
+
+  uint64_t total_size = 0;
+  for (const absl::string_view name : other.names_) {
+    total_size += name.size();
+  }
+  if (total_size != 0) {
+    NewBlock(total_size);
+  }
+  ids_.reserve(other.size());
+  names_.reserve(other.size());
+  for (const absl::string_view name : other.names_) {
+    FindOrInsert(name);
+  }
+  return *this;
+}
+
+UserNameArena::UserNameArena(UserNameArena&& other) {
+  *this = std::move(other);
+}
+
+UserNameArena& UserNameArena::operator=(UserNameArena&& other) {
+  if (this == &other) {
+    return *this;
+  }
+  // The blocks themselves don't move, so the views into them stay valid. The
+  // moved-from arena must forget its position in the block it gave away.
+  blocks_ = std::move(other.blocks_);
+  block_next_ = std::exchange(other.block_next_, nullptr);
+  block_remaining_ = std::exchange(other.block_remaining_, 0);
+  next_block_size_ = std::exchange(other.next_block_size_, kMinBlockSize);
+  ids_ = std::move(other.ids_);
+  names_ = std::move(other.names_);
+  other.blocks_.clear();
+  other.ids_.clear();
+  other.names_.clear();
+  return *this;
+}
+
+uint64_t UserNameArena::size() const {
+  return static_cast<uint64_t>(names_.size());
+}
+
+uint64_t UserNameArena::FindOrInsert(absl::string_view name) {
+  const auto it = ids_.find(name);
+  if (it != ids_.end()) {
+    return it->second;
+  }
+
+  const uint64_t id = size();
+  const absl::string_view stored_name = Store(name);
+  ids_.insert({ stored_name, id });
+  names_.push_back(stored_name);
+  return id;
+}
+
+uint64_t UserNameArena::Find(absl::string_view name) const {
+  const auto it = ids_.find(name);
+  return it == ids_.end() ? kNotFound : it->second;
+}
+
+absl::string_view UserNameArena::Store(absl::string_view name) {
+  if (name.empty()) {
+    return absl::string_view();
+  }
+
+  char* data;
+  if (name.size() > kMaxBlockSize) {
+    // Oversized names get a block of their own, leaving the current block
+    // free for the names that follow.
+    blocks_.push_back(std::unique_ptr<char[]>(new char[name.size()]));
+    data = blocks_.back().get();
+  } else {
+    if (name.size() > block_remaining_) {
+      NewBlock(std::max(next_block_size_, name.size()));
+      next_block_size_ = std::min(2 * next_block_size_, kMaxBlockSize);
+    }
+    data = block_next_;
+    block_next_ += name.size();
+    block_remaining_ -= name.size();
+  }
+  std::memcpy(data, name.data(), name.size());
+  return absl::string_view(data, name.size());
+}
+
+void UserNameArena::NewBlock(uint64_t size) {
+  // Not value-initialized, since every byte handed out is overwritten.
+  blocks_.push_back(std::unique_ptr<char[]>(new char[size]));
+  block_next_ = blocks_.back().get();
+  block_remaining_ = size;
+}
+
+}  // namespace debt_simpl
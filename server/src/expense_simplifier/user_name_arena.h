@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+
+namespace debt_simpl {
+
+// Interns user names, handing out dense ids in order of first appearance.
+//
+// Names are copied once into blocks owned by the arena, and every
+// lookup structure refers to those copies through string_views. Blocks never
+// move, so the views returned by `Name()` stay valid for the lifetime of the
+// arena, including across moves of it.
+class UserNameArena {
+ public:
+  UserNameArena() = default;
+
+  // Copies intern every name again into the new arena, keeping their ids, in
+  // a single block sized to fit them.
+  UserNameArena(const UserNameArena& other);
+  UserNameArena& operator=(const UserNameArena& other);
+
+  UserNameArena(UserNameArena&& other);
+  UserNameArena& operator=(UserNameArena&& other);
+
+  // Returns the number of interned names. Ids span the range [0, size()).
+  uint64_t size() const;
+
+  // Returns the id of `name`, interning it with the next free id if it hasn't
+  // been seen before.
+  uint64_t FindOrInsert(absl::string_view name);
+
+  // Returns the id of `name`, or `kNotFound` if it was never interned.
+  uint64_t Find(absl::string_view name) const;
+
+  // Returns the name interned with id `id`.
+  absl::string_view Name(uint64_t id) const {
+    return names_[id];
+  }
+
+  static constexpr uint64_t kNotFound = UINT64_MAX;
+
+ private:
+  // Blocks start small, so that arenas of a few names stay small, and double
+  // in size up to `kMaxBlockSize`. Names longer than that get a block of
+  // their own.
+  static constexpr uint64_t kMinBlockSize = 256;
+  static constexpr uint64_t kMaxBlockSize = 64 * 1024;
+
+  // Copies `name` into the current block, starting a new one if it doesn't
+  // fit, and returns a view of the copy.
+  absl::string_view Store(absl::string_view name);
+
+  // Starts a new current block of `size` bytes.
+  void NewBlock(uint64_t size);
+
+  std::vector<std::unique_ptr<char[]>> blocks_;
+  // Where the next name goes in the current block, and how many bytes are
+  // still free after it.
+  char* block_next_ = nullptr;
+  uint64_t block_remaining_ = 0;
+  // The size of the next block started when a name doesn't fit.
+  uint64_t next_block_size_ = kMinBlockSize;
+
+  // Map of interned names to their ids, and of ids back to names.
+  absl::flat_hash_map<absl::string_view, uint64_t> ids_;
+  std::vector<absl::string_view> names_;
+};
+
+}  // namespace debt_simpl
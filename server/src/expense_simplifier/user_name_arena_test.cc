@@ -0,0 +1,96 @@
+#include "server/src/expense_simplifier/user_name_arena.h"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "gtest/gtest.h"
+
+namespace debt_simpl {
+
+TEST(TestUserNameArena, Empty) {
+  UserNameArena arena;
+
+  EXPECT_EQ(arena.size(), 0);
+  EXPECT_EQ(arena.Find("alice"), UserNameArena::kNotFound);
+}
+
+TEST(TestUserNameArena, IdsAssignedInOrder) {
+  UserNameArena arena;
+
+  EXPECT_EQ(arena.FindOrInsert("alice"), 0);
+  EXPECT_EQ(arena.FindOrInsert("bob"), 1);
+  EXPECT_EQ(arena.FindOrInsert("alice"), 0);
+
+  EXPECT_EQ(arena.size(), 2);
+  EXPECT_EQ(arena.Find("bob"), 1);
+  EXPECT_EQ(arena.Name(0), "alice");
+  EXPECT_EQ(arena.Name(1), "bob");
+}
+
+TEST(TestUserNameArena, NamesOutliveCallerStrings) {
+  UserNameArena arena;
+  {
+    std::string name = "charlie";
+    arena.FindOrInsert(name);
+    name = "overwritten";
+  }
+
+  EXPECT_EQ(arena.Name(0), "charlie");
+  EXPECT_EQ(arena.Find("charlie"), 0);
+}
+
+TEST(TestUserNameArena, EmptyName) {
+  UserNameArena arena;
+
+  EXPECT_EQ(arena.FindOrInsert(""), 0);
+  EXPECT_EQ(arena.FindOrInsert("alice"), 1);
+  EXPECT_EQ(arena.Find(""), 0);
+  EXPECT_EQ(arena.Name(0), "");
+
+  UserNameArena copy = arena;
+  EXPECT_EQ(copy.Find(""), 0);
+  EXPECT_EQ(copy.Name(1), "alice");
+}
+
+TEST(TestUserNameArena, SpansManyBlocks) {
+  UserNameArena arena;
+  const std::string long_name(100 * 1024, 'x');
+  for (uint64_t i = 0; i < 10000; i++) {
+    arena.FindOrInsert("user" + std::to_string(i));
+    if (i == 5000) {
+      arena.FindOrInsert(long_name);
+    }
+  }
+
+  EXPECT_EQ(arena.size(), 10001);
+  EXPECT_EQ(arena.Name(0), "user0");
+  EXPECT_EQ(arena.Name(5001), long_name);
+  EXPECT_EQ(arena.Name(5002), "user5001");
+  EXPECT_EQ(arena.Find("user9999"), 10000);
+}
+
+TEST(TestUserNameArena, CopyAndMove) {
+  UserNameArena arena;
+  arena.FindOrInsert("alice");
+  arena.FindOrInsert("bob");
+
+  UserNameArena copy = arena;
+  copy.FindOrInsert("charlie");
+  EXPECT_EQ(arena.size(), 2);
+  EXPECT_EQ(copy.size(), 3);
+  EXPECT_EQ(copy.Find("bob"), 1);
+
+  const absl::string_view bob = arena.Name(1);
+  UserNameArena moved = std::move(arena);
+  EXPECT_EQ(moved.Name(1).data(), bob.data());
+  EXPECT_EQ(moved.Find("alice"), 0);
+
+  // The moved-from arena starts over without touching the moved blocks.
+  arena.FindOrInsert("dave");
+  EXPECT_EQ(arena.Name(0), "dave");
+  EXPECT_EQ(moved.Name(1), "bob");
+}
+
+}  // namespace debt_simpl
@@ -0,0 +1,171 @@
+#include "server/src/expense_simplifier/zero_sum_partition.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+
+#include "server/src/expense_simplifier/debt_graph.h"
+
+namespace debt_simpl {
+
+namespace {
+
+// How many subsets are visited between deadline checks. Reading the clock
+// costs about as much as visiting a few dozen subsets.
+constexpr uint32_t kSubsetsPerDeadlineCheck = 1 << 16;
+
+// Sums subsets of up to 32 balances in constant time from the sums of the
+// subsets of their lower and upper halves, rather than keeping a sum for
+// every subset around.
+class SubsetSums {
+ public:
+  explicit SubsetSums(absl::Span<const Cents> balances)
+      : low_bits_(static_cast<uint32_t>(balances.size() / 2)),
+        low_sums_(HalfSums(balances.subspan(0, low_bits_))),
+        high_sums_(HalfSums(balances.subspan(low_bits_))) {}
+
+  Cents Sum(uint32_t subset) const {
+    return low_sums_[subset & ((uint32_t{ 1 } << low_bits_) - 1)] +
+           high_sums_[subset >> low_bits_];
+  }
+
+ private:
+  static std::vector<Cents> HalfSums(absl::Span<const Cents> balances) {
+    std::vector<Cents> sums(size_t{ 1 } << balances.size(), 0);
+    for (uint32_t subset = 1; subset < sums.size(); subset++) {
+      const uint32_t lowest = __builtin_ctz(subset);
+      sums[subset] = sums[subset & (subset - 1)] + balances[lowest];
+    }
+    return sums;
+  }
+
+  const uint32_t low_bits_;
+  const std::vector<Cents> low_sums_;
+  const std::vector<Cents> high_sums_;
+};
+
+// Partitions `balances`, which sum to zero, into the most zero-sum subsets,
+// numbering them from `first_subset` in `subsets`. Returns false if the
+// deadline passed first.
+bool SearchZeroSumSubsets(absl::Span<const Cents> balances,
+                          absl::Time deadline, uint32_t first_subset,
+                          absl::Span<uint32_t> subsets) {
+  const uint32_t n = static_cast<uint32_t>(balances.size());
+  const uint32_t all = static_cast<uint32_t>((uint64_t{ 1 } << n) - 1);
+  const SubsetSums sums(balances);
+
+  // The most zero-sum subsets each subset of balances splits into, counting a
+  // remainder that doesn't sum to zero as none. Removing any one balance of a
+  // subset leaves a subset whose partition extends to it, so the best of
+  // those, plus one if the subset itself sums to zero, is optimal.
+  //
+  // Removing a balance breaks up at most the one subset it was in, so the
+  // candidates are all within one of each other, and the search stops at the
+  // first that beats another.
+  std::vector<uint8_t> most_subsets(size_t{ all } + 1, 0);
+  for (uint32_t subset = 1; subset <= all; subset++) {
+    if (subset % kSubsetsPerDeadlineCheck == 0 && absl::Now() > deadline) {
+      return false;
+    }
+    const uint8_t first = most_subsets[subset & (subset - 1)];
+    uint8_t best = first;
+    for (uint32_t rest = subset & (subset - 1); rest != 0; rest &= rest - 1) {
+      const uint8_t candidate = most_subsets[subset & ~(rest & -rest)];
+      if (candidate != first) {
+        best = std::max(first, candidate);
+        break;
+      }
+    }
+    most_subsets[subset] = best + (sums.Sum(subset) == 0 ? 1 : 0);
+  }
+
+  // Peels balances off one at a time along an optimal path. Every time the
+  // balances left sum to zero, the ones peeled off since the last time do
+  // too, and make up a subset of their own.
+  uint32_t subset_index = first_subset;
+  for (uint32_t left = all; left != 0;) {
+    const uint8_t is_zero_sum = sums.Sum(left) == 0 ? 1 : 0;
+    for (uint32_t rest = left; rest != 0; rest &= rest - 1) {
+      const uint32_t bit = rest & -rest;
+      if (most_subsets[left & ~bit] + is_zero_sum == most_subsets[left]) {
+        subsets[__builtin_ctz(bit)] = subset_index;
+        left &= ~bit;
+        break;
+      }
+    }
+    if (left != 0 && sums.Sum(left) == 0) {
+      subset_index++;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+std::optional<std::vector<uint32_t>> PartitionIntoZeroSumSubsets(
+    absl::Span<const Cents> balances, uint32_t max_search_balances,
+    absl::Time deadline) {
+  Cents total = 0;
+  for (const Cents balance : balances) {
+    total += balance;
+  }
+  if (total != 0) {
+    return std::nullopt;
+  }
+
+  std::vector<uint32_t> subsets(balances.size());
+  uint32_t num_subsets = 0;
+
+  // Zero balances are subsets of their own, and so are pairs of opposite
+  // balances: taking a pair out of the subsets it was in and into its own
+  // never leaves fewer subsets, as what remains of them still sums to zero.
+  absl::flat_hash_map<Cents, std::vector<uint32_t>> unpaired;
+  for (uint32_t i = 0; i < balances.size(); i++) {
+    if (balances[i] == 0) {
+      subsets[i] = num_subsets++;
+      continue;
+    }
+    const auto opposite = unpaired.find(-balances[i]);
+    if (opposite != unpaired.end() && !opposite->second.empty()) {
+      subsets[opposite->second.back()] = num_subsets;
+      subsets[i] = num_subsets++;
+      opposite->second.pop_back();
+    } else {
+      unpaired[balances[i]].push_back(i);
+    }
+  }
+  std::vector<uint32_t> rest;
+  for (const auto& [balance, indices] : unpaired) {
+    rest.insert(rest.end(), indices.begin(), indices.end());
+  }
+  if (rest.empty()) {
+    return subsets;
+  }
+  if (rest.size() > max_search_balances || rest.size() > 31) {
+    return std::nullopt;
+  }
+
+  std::sort(rest.begin(), rest.end());
+  std::vector<Cents> rest_balances;
+  rest_balances.reserve(rest.size());
+  for (const uint32_t i : rest) {
+    rest_balances.push_back(balances[i]);
+  }
+  std::vector<uint32_t> rest_subsets(rest.size());
+  if (!SearchZeroSumSubsets(rest_balances, deadline, num_subsets,
+                            absl::MakeSpan(rest_subsets))) {
+    return std::nullopt;
+  }
+  for (uint32_t j = 0; j < rest.size(); j++) {
+    subsets[rest[j]] = rest_subsets[j];
+  }
+  return subsets;
+}
+
+}  // namespace debt_simpl
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+
+#include "server/src/expense_simplifier/debt_graph.h"
+
+namespace debt_simpl {
+
+// Splits `balances`, which must sum to zero, into as many subsets summing to
+// zero as possible, and returns the index of the subset of each balance.
+//
+// A subset of k nonzero balances can be settled in k - 1 transactions and no
+// fewer, so settling each subset on its own takes the fewest transactions
+// possible: the number of nonzero balances minus the number of subsets.
+//
+// Opposite balances are paired off first, since some optimal partition always
+// has them in a subset of their own. The rest are searched exhaustively with a
+// dynamic program over every subset of them, which takes O(2^n n) time and
+// 2^n bytes. Returns nullopt if more than `max_search_balances` remain to
+// search, if the search isn't done by `deadline`, or if `balances` doesn't sum
+// to zero.
+std::optional<std::vector<uint32_t>> PartitionIntoZeroSumSubsets(
+    absl::Span<const Cents> balances, uint32_t max_search_balances,
+    absl::Time deadline);
+
+}  // namespace debt_simpl
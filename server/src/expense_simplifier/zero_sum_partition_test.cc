@@ -0,0 +1,145 @@
+#include "server/src/expense_simplifier/zero_sum_partition.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+
+#include "server/src/expense_simplifier/debt_graph.h"
+
+namespace debt_simpl {
+
+class TestZeroSumPartition : public ::testing::Test {
+ protected:
+  static std::optional<std::vector<uint32_t>> Partition(
+      const std::vector<Cents>& balances, uint32_t max_search_balances = 25) {
+    return PartitionIntoZeroSumSubsets(balances, max_search_balances,
+                                       absl::InfiniteFuture());
+  }
+
+  // Checks that every subset of `subsets` sums to zero, and returns how many
+  // there are.
+  static uint32_t CountZeroSumSubsets(const std::vector<Cents>& balances,
+                                      const std::vector<uint32_t>& subsets) {
+    EXPECT_EQ(subsets.size(), balances.size());
+    absl::flat_hash_map<uint32_t, Cents> sums;
+    for (size_t i = 0; i < balances.size(); i++) {
+      sums[subsets[i]] += balances[i];
+    }
+    for (const auto& [subset, sum] : sums) {
+      EXPECT_EQ(sum, 0) << "subset " << subset;
+    }
+    return static_cast<uint32_t>(sums.size());
+  }
+
+  // Returns the most zero-sum subsets `balances` splits into, by trying every
+  // way to partition it.
+  static uint32_t BruteForceMostSubsets(const std::vector<Cents>& balances) {
+    std::vector<Cents> sums;
+    std::function<uint32_t(size_t)> place = [&](size_t i) -> uint32_t {
+      if (i == balances.size()) {
+        return std::all_of(sums.begin(), sums.end(),
+                           [](Cents sum) { return sum == 0; })
+                   ? static_cast<uint32_t>(sums.size())
+                   : 0;
+      }
+      uint32_t best = 0;
+      for (size_t j = 0; j < sums.size(); j++) {
+        sums[j] += balances[i];
+        best = std::max(best, place(i + 1));
+        sums[j] -= balances[i];
+      }
+      sums.push_back(balances[i]);
+      best = std::max(best, place(i + 1));
+      sums.pop_back();
+      return best;
+    };
+    return place(0);
+  }
+};
+
+TEST_F(TestZeroSumPartition, Empty) {
+  EXPECT_EQ(Partition({}), std::vector<uint32_t>());
+}
+
+TEST_F(TestZeroSumPartition, OppositePairsSplit) {
+  const std::vector<Cents> balances = { 5, 3, -5, -3, 0 };
+  const std::optional<std::vector<uint32_t>> subsets = Partition(balances);
+  ASSERT_TRUE(subsets.has_value());
+  EXPECT_EQ(CountZeroSumSubsets(balances, *subsets), 3);
+}
+
+TEST_F(TestZeroSumPartition, FindsSubsetsGreedyMatchingMisses) {
+  // Matching the largest balances first pays 6 with 4, leaving 4 transfers,
+  // but {4, -4} and {3, 3, -6} only need 3.
+  const std::vector<Cents> balances = { 4, 3, 3, -6, -4 };
+  const std::optional<std::vector<uint32_t>> subsets = Partition(balances);
+  ASSERT_TRUE(subsets.has_value());
+  EXPECT_EQ(CountZeroSumSubsets(balances, *subsets), 2);
+}
+
+TEST_F(TestZeroSumPartition, MatchesBruteForce) {
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<Cents> cents(-6, 6);
+  for (uint32_t trial = 0; trial < 200; trial++) {
+    std::vector<Cents> balances(2 + trial % 7);
+    Cents total = 0;
+    for (size_t i = 0; i + 1 < balances.size(); i++) {
+      balances[i] = cents(rng);
+      total += balances[i];
+    }
+    balances.back() = -total;
+
+    SCOPED_TRACE(absl::StrFormat("trial %d", trial));
+    const std::optional<std::vector<uint32_t>> subsets = Partition(balances);
+    ASSERT_TRUE(subsets.has_value());
+    EXPECT_EQ(CountZeroSumSubsets(balances, *subsets),
+              BruteForceMostSubsets(balances));
+  }
+}
+
+TEST_F(TestZeroSumPartition, SearchesManyBalances) {
+  // No two balances are opposite, so all 20 are searched.
+  std::vector<Cents> balances;
+  for (Cents i = 1; i <= 10; i++) {
+    balances.push_back(2 * i);
+    balances.push_back(-(2 * i + 1));
+  }
+  balances.back() += 10;
+  const std::optional<std::vector<uint32_t>> subsets = Partition(balances);
+  ASSERT_TRUE(subsets.has_value());
+  EXPECT_GE(CountZeroSumSubsets(balances, *subsets), 1);
+}
+
+TEST_F(TestZeroSumPartition, GivesUpOnTooManyBalances) {
+  EXPECT_EQ(Partition({ 1, 2, -4, 1 }, /*max_search_balances=*/3),
+            std::nullopt);
+  // Paired balances don't count towards the limit.
+  EXPECT_NE(Partition({ 1, 2, -3, 7, -7 }, /*max_search_balances=*/3),
+            std::nullopt);
+}
+
+TEST_F(TestZeroSumPartition, GivesUpAfterDeadline) {
+  std::vector<Cents> balances;
+  for (Cents i = 1; i <= 10; i++) {
+    balances.push_back(2 * i);
+    balances.push_back(-(2 * i + 1));
+  }
+  balances.back() += 10;
+  EXPECT_EQ(PartitionIntoZeroSumSubsets(balances, 25, absl::InfinitePast()),
+            std::nullopt);
+}
+
+TEST_F(TestZeroSumPartition, RejectsUnbalancedInput) {
+  EXPECT_EQ(Partition({ 1, -2 }), std::nullopt);
+}
+
+}  // namespace debt_simpl
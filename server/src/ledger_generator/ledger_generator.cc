@@ -0,0 +1,247 @@
+#include "server/src/ledger_generator/ledger_generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+
+#include "proto/debts.pb.h"
+#include "server/src/expense_simplifier/utils.h"
+
+namespace debt_simpl {
+
+namespace {
+
+absl::Status ValidateOptions(const LedgerGeneratorOptions& options) {
+  if (options.num_groups == 0) {
+    return absl::InvalidArgumentError("num_groups must be positive");
+  }
+  // Every group needs at least two users for a transaction within it.
+  if (options.num_users < 2 * options.num_groups) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "%d users are too few for %d groups of at least 2 users",
+        options.num_users, options.num_groups));
+  }
+  if (options.min_cents <= 0 || options.max_cents < options.min_cents) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Invalid amount range [%d, %d]", options.min_cents,
+                        options.max_cents));
+  }
+  if (options.median_cents <= 0 || options.amount_sigma < 0) {
+    return absl::InvalidArgumentError(
+        "median_cents must be positive and amount_sigma non-negative");
+  }
+  if (options.power_law_exponent < 0) {
+    return absl::InvalidArgumentError(
+        "power_law_exponent must be non-negative");
+  }
+  if (!(options.cross_group_probability >= 0 &&
+        options.cross_group_probability <= 1)) {
+    return absl::InvalidArgumentError(
+        "cross_group_probability must be in [0, 1]");
+  }
+  return absl::OkStatus();
+}
+
+// Draws transactions from the distributions described by the options. Only
+// the bits of std::mt19937_64 are used, since the standard distributions
+// produce different values on different standard libraries.
+class TransactionGenerator {
+ public:
+  explicit TransactionGenerator(const LedgerGeneratorOptions& options)
+      : options_(options),
+        rng_(options.seed),
+        group_size_(options.num_users / options.num_groups),
+        num_larger_groups_(options.num_users % options.num_groups) {
+    if (options.degree_distribution == DegreeDistribution::kPowerLaw) {
+      // The first `num_larger_groups_` groups have one extra user.
+      const uint64_t max_group_size = group_size_ + 1;
+      rank_cdf_.reserve(max_group_size);
+      double total_weight = 0;
+      for (uint64_t rank = 1; rank <= max_group_size; rank++) {
+        total_weight += std::pow(static_cast<double>(rank),
+                                 -options.power_law_exponent);
+        rank_cdf_.push_back(total_weight);
+      }
+    }
+  }
+
+  void Next(uint64_t* lender, uint64_t* receiver, int64_t* cents) {
+    // Picking a group through a uniformly random user picks it with
+    // probability proportional to its size.
+    const uint64_t group = GroupOf(UniformInt(options_.num_users));
+    *lender = UserInGroup(group);
+    do {
+      const uint64_t receiver_group =
+          UniformDouble() < options_.cross_group_probability
+              ? GroupOf(UniformInt(options_.num_users))
+              : group;
+      *receiver = UserInGroup(receiver_group);
+    } while (*receiver == *lender);
+    *cents = Amount();
+  }
+
+ private:
+  uint64_t GroupOf(uint64_t user) const {
+    const uint64_t larger_users = num_larger_groups_ * (group_size_ + 1);
+    if (user < larger_users) {
+      return user / (group_size_ + 1);
+    }
+    return num_larger_groups_ + (user - larger_users) / group_size_;
+  }
+
+  uint64_t GroupStart(uint64_t group) const {
+    return group * group_size_ + std::min(group, num_larger_groups_);
+  }
+
+  uint64_t GroupSize(uint64_t group) const {
+    return group_size_ + (group < num_larger_groups_ ? 1 : 0);
+  }
+
+  uint64_t UserInGroup(uint64_t group) {
+    const uint64_t size = GroupSize(group);
+    switch (options_.degree_distribution) {
+      case DegreeDistribution::kUniform: {
+        return GroupStart(group) + UniformInt(size);
+      }
+      case DegreeDistribution::kPowerLaw: {
+        // Sample a rank from the distribution truncated to the group's size.
+        const double x = UniformDouble() * rank_cdf_[size - 1];
+        const uint64_t rank =
+            std::upper_bound(rank_cdf_.begin(), rank_cdf_.begin() + size, x) -
+            rank_cdf_.begin();
+        return GroupStart(group) + std::min(rank, size - 1);
+      }
+    }
+    return GroupStart(group);
+  }
+
+  int64_t Amount() {
+    switch (options_.amount_distribution) {
+      case AmountDistribution::kUniform: {
+        return options_.min_cents +
+               static_cast<int64_t>(UniformInt(static_cast<uint64_t>(
+                   options_.max_cents - options_.min_cents) + 1));
+      }
+      case AmountDistribution::kLogNormal: {
+        // Box-Muller transform of two uniforms in (0, 1] and [0, 1).
+        const double u1 = 1.0 - UniformDouble();
+        const double u2 = UniformDouble();
+        const double z =
+            std::sqrt(-2.0 * std::log(u1)) * std::cos(2 * M_PI * u2);
+        const double amount = static_cast<double>(options_.median_cents) *
+                              std::exp(options_.amount_sigma * z);
+        if (!(amount < static_cast<double>(options_.max_cents))) {
+          return options_.max_cents;
+        }
+        return std::max(options_.min_cents,
+                        static_cast<int64_t>(std::llround(amount)));
+      }
+    }
+    return options_.min_cents;
+  }
+
+  // Returns a uniformly random integer in [0, n). The modulo bias is
+  // negligible for the ranges used here.
+  uint64_t UniformInt(uint64_t n) {
+    return rng_() % n;
+  }
+
+  // Returns a uniformly random double in [0, 1).
+  double UniformDouble() {
+    return static_cast<double>(rng_() >> 11) * 0x1.0p-53;
+  }
+
+  const LedgerGeneratorOptions& options_;
+  std::mt19937_64 rng_;
+
+  uint64_t group_size_;
+  uint64_t num_larger_groups_;
+
+  // Cumulative weights of ranks 1, 2, ... within a group, for power-law
+  // degrees.
+  std::vector<double> rank_cdf_;
+};
+
+std::string UserName(uint64_t user) {
+  return absl::StrCat("user", user);
+}
+
+// Formats cents the way Splitwise reports amounts, e.g. "-12.05".
+std::string FormatCents(int64_t cents) {
+  const uint64_t magnitude = std::abs(cents);
+  return absl::StrFormat("%s%d.%02d", cents < 0 ? "-" : "", magnitude / 100,
+                         magnitude % 100);
+}
+
+}  // namespace
+
+absl::StatusOr<DebtList> GenerateDebtList(
+    const LedgerGeneratorOptions& options) {
+  RETURN_IF_ERROR(ValidateOptions(options));
+
+  TransactionGenerator generator(options);
+  DebtList debt_list;
+  debt_list.mutable_transactions()->Reserve(
+      static_cast<int>(options.num_transactions));
+  for (uint64_t i = 0; i < options.num_transactions; i++) {
+    uint64_t lender, receiver;
+    int64_t cents;
+    generator.Next(&lender, &receiver, &cents);
+
+    Transaction& t = *debt_list.add_transactions();
+    t.set_lender(UserName(lender));
+    t.set_receiver(UserName(receiver));
+    t.set_cents(cents);
+  }
+  return debt_list;
+}
+
+absl::Status WriteSplitwiseCsv(const LedgerGeneratorOptions& options,
+                               std::ostream* output) {
+  RETURN_IF_ERROR(ValidateOptions(options));
+
+  *output << "Date,Description,Category,Cost,Currency";
+  for (uint64_t user = 0; user < options.num_users; user++) {
+    *output << "," << UserName(user);
+  }
+  *output << "\n";
+
+  TransactionGenerator generator(options);
+  std::string row;
+  for (uint64_t i = 0; i < options.num_transactions; i++) {
+    uint64_t lender, receiver;
+    int64_t cents;
+    generator.Next(&lender, &receiver, &cents);
+
+    row = absl::StrCat("2024-01-01,Expense ", i, ",General,",
+                       FormatCents(cents), ",USD");
+    for (uint64_t user = 0; user < options.num_users; user++) {
+      if (user == lender) {
+        absl::StrAppend(&row, ",", FormatCents(cents));
+      } else if (user == receiver) {
+        absl::StrAppend(&row, ",", FormatCents(-cents));
+      } else {
+        row.append(",0.00");
+      }
+    }
+    row.push_back('\n');
+    *output << row;
+  }
+
+  if (!output->good()) {
+    return absl::InternalError("Failed to write Splitwise report");
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace debt_simpl
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+
+#include "proto/debts.pb.h"
+
+namespace debt_simpl {
+
+enum class DegreeDistribution {
+  // Every user of a group is equally likely to take part in a transaction.
+  kUniform,
+  // Users are picked from a Zipf distribution, so a few users of each group
+  // take part in most of its transactions, like in real group ledgers.
+  kPowerLaw,
+};
+
+enum class AmountDistribution {
+  // Amounts are uniform over [min_cents, max_cents].
+  kUniform,
+  // Amounts are log-normal around `median_cents`, clamped to
+  // [min_cents, max_cents]: mostly small expenses with a long tail of large
+  // ones.
+  kLogNormal,
+};
+
+struct LedgerGeneratorOptions {
+  // Users are named "user0", "user1", ... "user<num_users - 1>". Users that
+  // happen to take part in no transaction don't appear in the ledger.
+  uint64_t num_users = 100;
+
+  uint64_t num_transactions = 1000;
+
+  DegreeDistribution degree_distribution = DegreeDistribution::kUniform;
+
+  // The exponent `s` of the Zipf distribution, under which the user of rank
+  // `k` in its group takes part in transactions with weight 1 / k^s.
+  double power_law_exponent = 1.0;
+
+  AmountDistribution amount_distribution = AmountDistribution::kUniform;
+  int64_t min_cents = 1;
+  int64_t max_cents = 100000;
+
+  // The median and the standard deviation of the logarithm of log-normal
+  // amounts.
+  int64_t median_cents = 2000;
+  double amount_sigma = 1.0;
+
+  // Users are split into this many groups of consecutive ids, as equal in
+  // size as possible. Each transaction is made within a single group, picked
+  // with probability proportional to its size.
+  uint64_t num_groups = 1;
+
+  // The probability that a transaction's receiver is picked among all users
+  // instead of the lender's group, which links groups together.
+  double cross_group_probability = 0.0;
+
+  uint64_t seed = 0;
+};
+
+// Generates a random ledger of `options.num_transactions` transactions.
+// Ledgers are fully determined by their options, including the seed, on every
+// platform.
+absl::StatusOr<DebtList> GenerateDebtList(
+    const LedgerGeneratorOptions& options);
+
+// Writes the ledger generated by `GenerateDebtList()` with the same options
+// as a Splitwise expense report, with one expense per transaction paid by the
+// lender for the receiver. Every row has a column per user, so reports of
+// more than a few thousand users are very large.
+absl::Status WriteSplitwiseCsv(const LedgerGeneratorOptions& options,
+                               std::ostream* output);
+
+}  // namespace debt_simpl
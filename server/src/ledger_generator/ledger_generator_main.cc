@@ -0,0 +1,139 @@
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "google/protobuf/text_format.h"
+
+#include "proto/debts.pb.h"
+#include "server/src/ledger_generator/ledger_generator.h"
+
+ABSL_FLAG(uint64_t, num_users, 100, "The number of users.");
+ABSL_FLAG(uint64_t, num_transactions, 1000,
+          "The number of transactions to generate.");
+ABSL_FLAG(std::string, degree_distribution, "uniform",
+          "How often users take part in transactions, one of \"uniform\" or "
+          "\"power_law\".");
+ABSL_FLAG(double, power_law_exponent, 1.0,
+          "The exponent of the power-law degree distribution.");
+ABSL_FLAG(std::string, amount_distribution, "uniform",
+          "The distribution of amounts, one of \"uniform\" or "
+          "\"log_normal\".");
+ABSL_FLAG(int64_t, min_cents, 1, "The smallest amount, in cents.");
+ABSL_FLAG(int64_t, max_cents, 100000, "The largest amount, in cents.");
+ABSL_FLAG(int64_t, median_cents, 2000,
+          "The median of log-normal amounts, in cents.");
+ABSL_FLAG(double, amount_sigma, 1.0,
+          "The standard deviation of the logarithm of log-normal amounts.");
+ABSL_FLAG(uint64_t, num_groups, 1,
+          "The number of groups users are split into.");
+ABSL_FLAG(double, cross_group_probability, 0.0,
+          "The probability that a transaction crosses groups.");
+ABSL_FLAG(uint64_t, seed, 0, "The seed of the random number generator.");
+ABSL_FLAG(std::string, format, "debt_list",
+          "The output format, one of \"debt_list\" (a serialized DebtList "
+          "proto), \"text_proto\" or \"splitwise_csv\".");
+ABSL_FLAG(std::optional<std::string>, output, std::nullopt,
+          "The file to write the ledger to. Defaults to stdout.");
+
+absl::StatusOr<debt_simpl::LedgerGeneratorOptions> OptionsFromFlags() {
+  debt_simpl::LedgerGeneratorOptions options = {
+    .num_users = absl::GetFlag(FLAGS_num_users),
+    .num_transactions = absl::GetFlag(FLAGS_num_transactions),
+    .power_law_exponent = absl::GetFlag(FLAGS_power_law_exponent),
+    .min_cents = absl::GetFlag(FLAGS_min_cents),
+    .max_cents = absl::GetFlag(FLAGS_max_cents),
+    .median_cents = absl::GetFlag(FLAGS_median_cents),
+    .amount_sigma = absl::GetFlag(FLAGS_amount_sigma),
+    .num_groups = absl::GetFlag(FLAGS_num_groups),
+    .cross_group_probability = absl::GetFlag(FLAGS_cross_group_probability),
+    .seed = absl::GetFlag(FLAGS_seed),
+  };
+
+  const std::string degrees = absl::GetFlag(FLAGS_degree_distribution);
+  if (degrees == "uniform") {
+    options.degree_distribution = debt_simpl::DegreeDistribution::kUniform;
+  } else if (degrees == "power_law") {
+    options.degree_distribution = debt_simpl::DegreeDistribution::kPowerLaw;
+  } else {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Unknown degree distribution \"", degrees, "\""));
+  }
+
+  const std::string amounts = absl::GetFlag(FLAGS_amount_distribution);
+  if (amounts == "uniform") {
+    options.amount_distribution = debt_simpl::AmountDistribution::kUniform;
+  } else if (amounts == "log_normal") {
+    options.amount_distribution = debt_simpl::AmountDistribution::kLogNormal;
+  } else {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Unknown amount distribution \"", amounts, "\""));
+  }
+
+  return options;
+}
+
+absl::Status WriteLedger(const debt_simpl::LedgerGeneratorOptions& options,
+                         const std::string& format, std::ostream* output) {
+  if (format != "debt_list" && format != "text_proto" &&
+      format != "splitwise_csv") {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Unknown format \"", format, "\""));
+  }
+  if (format == "splitwise_csv") {
+    return debt_simpl::WriteSplitwiseCsv(options, output);
+  }
+
+  absl::StatusOr<debt_simpl::DebtList> debt_list =
+      debt_simpl::GenerateDebtList(options);
+  if (!debt_list.ok()) {
+    return debt_list.status();
+  }
+  if (format == "debt_list") {
+    if (!debt_list->SerializeToOstream(output)) {
+      return absl::InternalError("Failed to write the DebtList");
+    }
+  } else {
+    std::string text;
+    google::protobuf::TextFormat::PrintToString(*debt_list, &text);
+    *output << text;
+  }
+  return absl::OkStatus();
+}
+
+int main(int argc, char* argv[]) {
+  absl::ParseCommandLine(argc, argv);
+
+  auto options = OptionsFromFlags();
+  if (!options.ok()) {
+    std::cerr << options.status() << std::endl;
+    return -1;
+  }
+
+  const auto output_path = absl::GetFlag(FLAGS_output);
+  std::ofstream output_file;
+  if (output_path.has_value()) {
+    output_file.open(output_path.value(), std::ios::binary);
+    if (!output_file.is_open()) {
+      std::cerr << "Failed to open " << output_path.value() << std::endl;
+      return -1;
+    }
+  }
+  std::ostream& output = output_path.has_value() ? output_file : std::cout;
+
+  absl::Status status =
+      WriteLedger(options.value(), absl::GetFlag(FLAGS_format), &output);
+  output.flush();
+  if (!status.ok() || !output.good()) {
+    std::cerr << "Generating ledger failed: " << status << std::endl;
+    return -1;
+  }
+
+  return 0;
+}
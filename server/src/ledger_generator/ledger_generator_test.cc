@@ -0,0 +1,183 @@
+#include "server/src/ledger_generator/ledger_generator.h"
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+#include "gtest/gtest.h"
+
+#include "proto/debts.pb.h"
+#include "server/src/csv/csv_reader.h"
+#include "server/src/expense_simplifier/utils.h"
+
+namespace debt_simpl {
+
+class TestLedgerGenerator : public ::testing::Test {
+ protected:
+  // Returns the id of a generated user name "user<id>".
+  static uint64_t UserId(absl::string_view name) {
+    uint64_t id = UINT64_MAX;
+    EXPECT_TRUE(absl::ConsumePrefix(&name, "user"));
+    EXPECT_TRUE(absl::SimpleAtoi(name, &id));
+    return id;
+  }
+};
+
+TEST_F(TestLedgerGenerator, SameSeedSameLedger) {
+  const LedgerGeneratorOptions options = {
+    .num_users = 50,
+    .num_transactions = 200,
+    .degree_distribution = DegreeDistribution::kPowerLaw,
+    .amount_distribution = AmountDistribution::kLogNormal,
+    .seed = 7,
+  };
+  ASSERT_OK_AND_DEFINE(DebtList, ledger1, GenerateDebtList(options));
+  ASSERT_OK_AND_DEFINE(DebtList, ledger2, GenerateDebtList(options));
+  EXPECT_EQ(ledger1.SerializeAsString(), ledger2.SerializeAsString());
+
+  LedgerGeneratorOptions other_seed = options;
+  other_seed.seed = 8;
+  ASSERT_OK_AND_DEFINE(DebtList, ledger3, GenerateDebtList(other_seed));
+  EXPECT_NE(ledger1.SerializeAsString(), ledger3.SerializeAsString());
+}
+
+TEST_F(TestLedgerGenerator, TransactionsWithinBounds) {
+  for (const AmountDistribution amounts :
+       { AmountDistribution::kUniform, AmountDistribution::kLogNormal }) {
+    const LedgerGeneratorOptions options = {
+      .num_users = 20,
+      .num_transactions = 1000,
+      .amount_distribution = amounts,
+      .min_cents = 100,
+      .max_cents = 5000,
+      .median_cents = 1000,
+      .amount_sigma = 2.0,
+    };
+    ASSERT_OK_AND_DEFINE(DebtList, ledger, GenerateDebtList(options));
+
+    ASSERT_EQ(ledger.transactions_size(), 1000);
+    for (const Transaction& t : ledger.transactions()) {
+      EXPECT_NE(t.lender(), t.receiver());
+      EXPECT_LT(UserId(t.lender()), 20);
+      EXPECT_LT(UserId(t.receiver()), 20);
+      EXPECT_GE(t.cents(), 100);
+      EXPECT_LE(t.cents(), 5000);
+    }
+  }
+}
+
+TEST_F(TestLedgerGenerator, GroupsAreClustered) {
+  // 10 users in 3 groups: users 0-3, 4-6 and 7-9.
+  const auto group_of = [](uint64_t id) {
+    return id < 4 ? 0 : (id < 7 ? 1 : 2);
+  };
+
+  LedgerGeneratorOptions options = {
+    .num_users = 10,
+    .num_transactions = 1000,
+    .num_groups = 3,
+  };
+  ASSERT_OK_AND_DEFINE(DebtList, isolated, GenerateDebtList(options));
+  std::vector<uint64_t> group_sizes(3);
+  for (const Transaction& t : isolated.transactions()) {
+    const uint64_t group = group_of(UserId(t.lender()));
+    EXPECT_EQ(group, group_of(UserId(t.receiver())));
+    group_sizes[group]++;
+  }
+  // Groups are picked in proportion to their size.
+  EXPECT_GT(group_sizes[0], group_sizes[2]);
+
+  options.cross_group_probability = 0.5;
+  ASSERT_OK_AND_DEFINE(DebtList, linked, GenerateDebtList(options));
+  uint64_t num_cross_group = 0;
+  for (const Transaction& t : linked.transactions()) {
+    num_cross_group +=
+        group_of(UserId(t.lender())) != group_of(UserId(t.receiver()));
+  }
+  EXPECT_GT(num_cross_group, 100);
+  EXPECT_LT(num_cross_group, 500);
+}
+
+TEST_F(TestLedgerGenerator, PowerLawFavorsFirstUsers) {
+  const LedgerGeneratorOptions options = {
+    .num_users = 100,
+    .num_transactions = 10000,
+    .degree_distribution = DegreeDistribution::kPowerLaw,
+  };
+  ASSERT_OK_AND_DEFINE(DebtList, ledger, GenerateDebtList(options));
+
+  std::vector<uint64_t> degrees(100);
+  for (const Transaction& t : ledger.transactions()) {
+    degrees[UserId(t.lender())]++;
+    degrees[UserId(t.receiver())]++;
+  }
+  EXPECT_GT(degrees[0], 10 * degrees[99]);
+  EXPECT_GT(degrees[0], degrees[1]);
+}
+
+TEST_F(TestLedgerGenerator, InvalidOptions) {
+  EXPECT_EQ(GenerateDebtList({ .num_users = 1 }).status().code(),
+            absl::StatusCode::kInvalidArgument);
+  EXPECT_EQ(GenerateDebtList({ .num_users = 5, .num_groups = 3 })
+                .status()
+                .code(),
+            absl::StatusCode::kInvalidArgument);
+  EXPECT_EQ(GenerateDebtList({ .min_cents = 10, .max_cents = 5 })
+                .status()
+                .code(),
+            absl::StatusCode::kInvalidArgument);
+  EXPECT_EQ(GenerateDebtList({ .cross_group_probability = 2 }).status().code(),
+            absl::StatusCode::kInvalidArgument);
+
+  std::ostringstream csv;
+  EXPECT_EQ(WriteSplitwiseCsv({ .num_groups = 0 }, &csv).code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+TEST_F(TestLedgerGenerator, SplitwiseCsvMatchesDebtList) {
+  const LedgerGeneratorOptions options = {
+    .num_users = 8,
+    .num_transactions = 50,
+    .amount_distribution = AmountDistribution::kLogNormal,
+    .num_groups = 2,
+    .cross_group_probability = 0.2,
+    .seed = 3,
+  };
+  ASSERT_OK_AND_DEFINE(DebtList, ledger, GenerateDebtList(options));
+  std::ostringstream output;
+  ASSERT_THAT(WriteSplitwiseCsv(options, &output), IsOk());
+  const std::string csv = output.str();
+
+  CsvReader reader(csv);
+  std::vector<absl::string_view> header;
+  ASSERT_TRUE(reader.NextRow(&header));
+  ASSERT_EQ(header.size(), 5 + 8);
+  EXPECT_EQ(header[2], "Category");
+  for (uint64_t user = 0; user < 8; user++) {
+    EXPECT_EQ(UserId(header[5 + user]), user);
+  }
+
+  std::vector<absl::string_view> row;
+  for (const Transaction& t : ledger.transactions()) {
+    ASSERT_TRUE(reader.NextRow(&row));
+    ASSERT_EQ(row.size(), header.size());
+    EXPECT_EQ(ParseCents(row[3]).value(), t.cents());
+    for (uint64_t user = 0; user < 8; user++) {
+      int64_t expected = 0;
+      if (user == UserId(t.lender())) {
+        expected = t.cents();
+      } else if (user == UserId(t.receiver())) {
+        expected = -t.cents();
+      }
+      EXPECT_EQ(ParseCents(row[5 + user]).value(), expected);
+    }
+  }
+  EXPECT_FALSE(reader.NextRow(&row));
+}
+
+}  // namespace debt_simpl
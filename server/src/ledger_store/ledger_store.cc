@@ -0,0 +1,236 @@
+#include "server/src/ledger_store/ledger_store.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "absl/hash/hash.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+
+#include "proto/debts.pb.h"
+#include "server/src/expense_simplifier/debt_graph.h"
+#include "server/src/expense_simplifier/thread_pool.h"
+#include "server/src/expense_simplifier/utils.h"
+#include "server/src/ledger_store/ledger_version.h"
+#include "server/src/ledger_store/transaction_log.h"
+#include "server/src/util/epoch.h"
+
+namespace debt_simpl {
+
+namespace {
+
+constexpr size_t kMaxGroupIdSize = 128;
+
+}  // namespace
+
+LedgerStore::LedgerStore(const LedgerStoreOptions& options)
+    : options_(options),
+      num_shards_(std::max(options.num_shards, 1u)),
+      log_options_(options.log_options),
+      shards_(new Shard[num_shards_]) {
+  for (uint32_t i = 0; i < num_shards_; i++) {
+    shards_[i].groups_by_id.Store(std::make_shared<const GroupMap>());
+  }
+  if (!options_.dir.empty() && log_options_.compaction_pool == nullptr) {
+    compaction_pool_ = std::make_unique<ThreadPool>(1);
+    log_options_.compaction_pool = compaction_pool_.get();
+  }
+}
+
+LedgerStore::~LedgerStore() = default;
+
+// static
+bool LedgerStore::IsValidGroupId(absl::string_view group_id) {
+  if (group_id.empty() || group_id.size() > kMaxGroupIdSize ||
+      group_id[0] == '.') {
+    return false;
+  }
+  return std::all_of(group_id.begin(), group_id.end(), [](char c) {
+    return absl::ascii_isalnum(c) || c == '_' || c == '-' || c == '.';
+  });
+}
+
+absl::Status LedgerStore::AddTransactions(absl::string_view group_id,
+                                          const DebtList& transactions) {
+  DEFINE_OR_RETURN(Group*, group, FindGroup(group_id, /*create=*/true));
+  if (group->log != nullptr) {
+    TouchLog(group);
+  }
+
+  // Debts add up the same in any order, so concurrent appends may reach the
+  // log and the group in different orders, and the next version isn't held
+  // up while the log syncs.
+  if (group->log != nullptr) {
+    RETURN_IF_ERROR(group->log->Append(transactions));
+  }
+  absl::MutexLock lock(&group->mutex);
+  group->version.Store(
+      group->version.Current()->WithTransactions(transactions));
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::shared_ptr<const LedgerVersion>> LedgerStore::Latest(
+    absl::string_view group_id) {
+  DEFINE_OR_RETURN(Group*, group, FindGroup(group_id, /*create=*/false));
+  EpochGuard guard;
+  return group->version.Load()->shared_from_this();
+}
+
+absl::StatusOr<std::shared_ptr<const LedgerVersion>>
+LedgerStore::LatestIfLoaded(absl::string_view group_id) {
+  if (!IsValidGroupId(group_id)) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Invalid group id \"%s\"", group_id));
+  }
+  if (Group* group = FindLoadedGroup(ShardOf(group_id), group_id)) {
+    EpochGuard guard;
+    return group->version.Load()->shared_from_this();
+  }
+  if (options_.dir.empty()) {
+    return absl::NotFoundError(absl::StrCat("No such group ", group_id));
+  }
+  return nullptr;
+}
+
+absl::StatusOr<Cents> LedgerStore::TotalDebt(absl::string_view group_id,
+                                             absl::string_view user) {
+  DEFINE_OR_RETURN(std::shared_ptr<const LedgerVersion>, version,
+                   Latest(group_id));
+  DEFINE_OR_RETURN(uint64_t, id, FindUserId(*version, group_id, user));
+  return version->TotalDebt(id);
+}
+
+absl::StatusOr<Cents> LedgerStore::AmountOwed(absl::string_view group_id,
+                                              absl::string_view to,
+                                              absl::string_view from) {
+  DEFINE_OR_RETURN(std::shared_ptr<const LedgerVersion>, version,
+                   Latest(group_id));
+  DEFINE_OR_RETURN(uint64_t, to_id, FindUserId(*version, group_id, to));
+  DEFINE_OR_RETURN(uint64_t, from_id, FindUserId(*version, group_id, from));
+  return version->Debt(from_id, to_id);
+}
+
+absl::StatusOr<std::vector<LedgerStore::UserBalance>> LedgerStore::Balances(
+    absl::string_view group_id) {
+  DEFINE_OR_RETURN(std::shared_ptr<const LedgerVersion>, version,
+                   Latest(group_id));
+  std::vector<UserBalance> balances;
+  balances.reserve(version->NumUsers());
+  for (uint64_t id = 0; id < version->NumUsers(); id++) {
+    balances.push_back({
+      .user = std::string(version->UserName(id)),
+      .total_debt = version->TotalDebt(id),
+    });
+  }
+  return balances;
+}
+
+// static
+LedgerStore::Group* LedgerStore::FindLoadedGroup(const Shard& shard,
+                                                 absl::string_view group_id) {
+  EpochGuard guard;
+  Group* const* group = shard.groups_by_id.Load()->Find(group_id);
+  return group == nullptr ? nullptr : *group;
+}
+
+absl::StatusOr<LedgerStore::Group*> LedgerStore::FindGroup(
+    absl::string_view group_id, bool create) {
+  if (!IsValidGroupId(group_id)) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Invalid group id \"%s\"", group_id));
+  }
+  Shard& shard = ShardOf(group_id);
+  if (Group* group = FindLoadedGroup(shard, group_id)) {
+    return group;
+  }
+
+  absl::MutexLock lock(&shard.mutex);
+  if (Group* group = FindLoadedGroup(shard, group_id)) {
+    return group;
+  }
+
+  auto group = std::make_unique<Group>();
+  DebtGraph graph;
+  if (options_.dir.empty()) {
+    if (!create) {
+      return absl::NotFoundError(absl::StrCat("No such group ", group_id));
+    }
+  } else {
+    const std::string dir = GroupDir(group_id);
+    std::error_code error;
+    if (!create && !std::filesystem::exists(dir, error)) {
+      return absl::NotFoundError(absl::StrCat("No such group ", group_id));
+    }
+    DEFINE_OR_RETURN(std::unique_ptr<TransactionLog>, log,
+                     TransactionLog::Open(dir, log_options_, &graph));
+    group->log = std::move(log);
+  }
+  group->version.Store(LedgerVersion::FromDebtGraph(graph));
+
+  Group* const result = group.get();
+  shard.groups.push_back(std::move(group));
+  auto groups_by_id =
+      std::make_shared<GroupMap>(*shard.groups_by_id.Current());
+  groups_by_id->Insert(group_id, result);
+  shard.groups_by_id.Store(std::move(groups_by_id));
+  if (result->log != nullptr) {
+    TouchLog(result);
+  }
+  return result;
+}
+
+LedgerStore::Shard& LedgerStore::ShardOf(absl::string_view group_id) const {
+  return shards_[absl::Hash<absl::string_view>()(group_id) % num_shards_];
+}
+
+void LedgerStore::TouchLog(Group* group) {
+  Group* least_recent = nullptr;
+  {
+    absl::MutexLock lock(&open_logs_mutex_);
+    if (group->open_log.has_value()) {
+      open_logs_.splice(open_logs_.begin(), open_logs_, *group->open_log);
+      return;
+    }
+    open_logs_.push_front(group);
+    group->open_log = open_logs_.begin();
+    if (open_logs_.size() <= std::max(options_.max_open_logs, 1u)) {
+      return;
+    }
+    least_recent = open_logs_.back();
+    open_logs_.pop_back();
+    least_recent->open_log.reset();
+  }
+  // Closed outside of the lock, since it waits for the log's appends in
+  // flight. A log written to again meanwhile is simply reopened, and one
+  // still being written to is left open.
+  least_recent->log->CloseFile();
+}
+
+// static
+absl::StatusOr<uint64_t> LedgerStore::FindUserId(const LedgerVersion& version,
+                                                 absl::string_view group_id,
+                                                 absl::string_view user) {
+  const absl::StatusOr<uint64_t> id = version.FindUserId(user);
+  if (!id.ok()) {
+    return absl::NotFoundError(
+        absl::StrFormat("No user %s in group %s", user, group_id));
+  }
+  return *id;
+}
+
+std::string LedgerStore::GroupDir(absl::string_view group_id) const {
+  return absl::StrCat(options_.dir, "/", group_id);
+}
+
+}  // namespace debt_simpl
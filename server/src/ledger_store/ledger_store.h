@@ -0,0 +1,176 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+
+#include "proto/debts.pb.h"
+#include "server/src/expense_simplifier/debt_graph.h"
+#include "server/src/expense_simplifier/thread_pool.h"
+#include "server/src/ledger_store/ledger_version.h"
+#include "server/src/ledger_store/transaction_log.h"
+#include "server/src/util/epoch.h"
+#include "server/src/util/persistent_string_map.h"
+
+namespace debt_simpl {
+
+struct LedgerStoreOptions {
+  // The number of shards groups are spread over by the hash of their id.
+  // Groups in different shards are found and created without contending.
+  uint32_t num_shards = 64;
+
+  // If set, every group's transactions are logged to a directory of its own
+  // in `dir`, and groups are reloaded from there after a restart. Otherwise
+  // groups only live in memory.
+  std::string dir;
+
+  // How the log of each group is compacted. The store compacts logs on a
+  // thread of its own unless a pool is given.
+  TransactionLogOptions log_options;
+
+  // The most group logs kept open at once. Past it, the logs of the groups
+  // least recently written to are closed, to be reopened by their next
+  // write, so that idle groups don't each hold on to a file.
+  uint32_t max_open_logs = 1024;
+};
+
+// The debt graphs of any number of groups, keyed by group id, which are kept
+// up to date as transactions are added to them so that balances are looked
+// up rather than rebuilt from every transaction.
+//
+// Thread-safe. Every write to a group publishes a new LedgerVersion of it.
+// Reads of a group in memory take no lock: they find the group in a snapshot
+// of its shard and the latest version of the group through atomic pointers,
+// which writers only replace, and the replaced objects are freed once no
+// reader can still see them (see `EpochGuard`). Only reads that load a group
+// from its log wait on a lock. Writes to a group wait for each other only to
+// build the next version, not for their log to sync.
+class LedgerStore {
+ public:
+  struct UserBalance {
+    std::string user;
+    // The total amount the user owes the rest of the group. Negative if they
+    // are owed money.
+    Cents total_debt;
+  };
+
+  explicit LedgerStore(const LedgerStoreOptions& options = {});
+
+  // Waits for the compactions of the groups' logs.
+  ~LedgerStore();
+
+  LedgerStore(const LedgerStore&) = delete;
+  LedgerStore& operator=(const LedgerStore&) = delete;
+
+  // Returns whether `group_id` may name a group, which it may if it is made
+  // of letters, digits, '_', '-' and '.', without starting with '.', since
+  // it names the group's log directory.
+  static bool IsValidGroupId(absl::string_view group_id);
+
+  // Adds `transactions` to group `group_id`, creating the group if it doesn't
+  // exist. With a log directory, returns once they are synced to disk.
+  absl::Status AddTransactions(absl::string_view group_id,
+                               const DebtList& transactions);
+
+  // Returns the latest version of group `group_id`, which stays the same for
+  // as long as the caller holds it while writes carry on.
+  absl::StatusOr<std::shared_ptr<const LedgerVersion>> Latest(
+      absl::string_view group_id);
+
+  // Same as `Latest()`, but returns null rather than loading the group from
+  // its log if it isn't in memory yet, so that it never waits on the disk.
+  absl::StatusOr<std::shared_ptr<const LedgerVersion>> LatestIfLoaded(
+      absl::string_view group_id);
+
+  // Returns the total amount of money `user` owes the rest of group
+  // `group_id`.
+  absl::StatusOr<Cents> TotalDebt(absl::string_view group_id,
+                                  absl::string_view user);
+
+  // Returns the amount of money `from` owes `to` in group `group_id`.
+  absl::StatusOr<Cents> AmountOwed(absl::string_view group_id,
+                                   absl::string_view to,
+                                   absl::string_view from);
+
+  // Returns the balance of every user of group `group_id` in its latest
+  // version, in the order they joined the group.
+  absl::StatusOr<std::vector<UserBalance>> Balances(
+      absl::string_view group_id);
+
+ private:
+  struct Group {
+    // Held by writers while they build and publish the next version. Readers
+    // never take it.
+    absl::Mutex mutex;
+    // The latest version. Older versions are freed once their last reader
+    // lets go of them.
+    EpochPtr<LedgerVersion> version;
+    // Null without a log directory.
+    std::unique_ptr<TransactionLog> log;
+    // The group's place in `open_logs_` while its log file is open. Guarded
+    // by `open_logs_mutex_`.
+    std::optional<std::list<Group*>::iterator> open_log;
+  };
+
+  using GroupMap = PersistentStringMap<Group*>;
+
+  struct Shard {
+    // Held while a group is created or loaded from its log and inserted, so
+    // that it's only loaded once. Lookups never take it.
+    absl::Mutex mutex;
+    // Groups are never removed, so pointers to them stay valid for as long
+    // as the store.
+    std::vector<std::unique_ptr<Group>> groups ABSL_GUARDED_BY(mutex);
+    // The groups by id, which inserts replace with a copy that shares all
+    // but the path to the new group.
+    EpochPtr<GroupMap> groups_by_id;
+  };
+
+  // Returns the group `group_id` of `shard`, or null if it isn't in memory.
+  static Group* FindLoadedGroup(const Shard& shard,
+                                absl::string_view group_id);
+
+  // Returns group `group_id`, loading it from its log if it isn't in memory
+  // yet. If it doesn't exist, it is created if `create`, and NotFound is
+  // returned otherwise.
+  absl::StatusOr<Group*> FindGroup(absl::string_view group_id, bool create);
+
+  // Returns the shard of group `group_id`.
+  Shard& ShardOf(absl::string_view group_id) const;
+
+  // Marks the log of `group` as the most recently written to, and closes the
+  // least recently written to one if that opens one too many.
+  void TouchLog(Group* group);
+
+  // Returns the user id of `user` in `version` of group `group_id`.
+  static absl::StatusOr<uint64_t> FindUserId(const LedgerVersion& version,
+                                             absl::string_view group_id,
+                                             absl::string_view user);
+
+  std::string GroupDir(absl::string_view group_id) const;
+
+  const LedgerStoreOptions options_;
+  const uint32_t num_shards_;
+
+  // Runs the log compactions if no pool was given. Declared before the
+  // shards, so that it outlives the logs scheduling compactions on it.
+  std::unique_ptr<ThreadPool> compaction_pool_;
+  TransactionLogOptions log_options_;
+
+  const std::unique_ptr<Shard[]> shards_;
+
+  // The groups whose log file is open, most recently written to first.
+  absl::Mutex open_logs_mutex_;
+  std::list<Group*> open_logs_ ABSL_GUARDED_BY(open_logs_mutex_);
+};
+
+}  // namespace debt_simpl
@@ -0,0 +1,227 @@
+#include "server/src/ledger_store/ledger_store.h"
+
+#include <filesystem>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "proto/debts.pb.h"
+#include "server/src/expense_simplifier/utils.h"
+#include "server/src/ledger_store/ledger_version.h"
+#include "server/src/ledger_store/log_dir_testing.h"
+
+namespace debt_simpl {
+
+using ::testing::Field;
+using ::testing::IsEmpty;
+using ::testing::UnorderedElementsAre;
+
+class TestLedgerStore : public LogDirTest {
+ protected:
+  static auto BalanceIs(absl::string_view user, Cents total_debt) {
+    return ::testing::AllOf(
+        Field(&LedgerStore::UserBalance::user, std::string(user)),
+        Field(&LedgerStore::UserBalance::total_debt, total_debt));
+  }
+};
+
+TEST_F(TestLedgerStore, AddsAndQueriesBalances) {
+  LedgerStore store;
+  ASSERT_THAT(store.AddTransactions("trip", Debt("alice", "bob", 500)),
+              IsOk());
+  ASSERT_THAT(store.AddTransactions("trip", Debt("bob", "alice", 200)),
+              IsOk());
+  ASSERT_THAT(store.AddTransactions("trip", Debt("carol", "bob", 100)),
+              IsOk());
+
+  EXPECT_THAT(store.TotalDebt("trip", "bob"), IsOkAndHolds(400));
+  EXPECT_THAT(store.TotalDebt("trip", "alice"), IsOkAndHolds(-300));
+  EXPECT_THAT(store.AmountOwed("trip", "alice", "bob"), IsOkAndHolds(300));
+  EXPECT_THAT(store.AmountOwed("trip", "bob", "alice"), IsOkAndHolds(-300));
+  EXPECT_THAT(store.Balances("trip"),
+              IsOkAndHolds(UnorderedElementsAre(BalanceIs("alice", -300),
+                                                BalanceIs("bob", 400),
+                                                BalanceIs("carol", -100))));
+}
+
+TEST_F(TestLedgerStore, HeldVersionsDontChange) {
+  LedgerStore store;
+  ASSERT_THAT(store.AddTransactions("trip", Debt("alice", "bob", 500)),
+              IsOk());
+  ASSERT_OK_AND_DEFINE(std::shared_ptr<const LedgerVersion>, version,
+                       store.Latest("trip"));
+
+  ASSERT_THAT(store.AddTransactions("trip", Debt("carol", "bob", 100)),
+              IsOk());
+  EXPECT_EQ(version->NumUsers(), 2);
+  EXPECT_EQ(version->TotalDebt(1), 500);
+
+  ASSERT_OK_AND_DEFINE(std::shared_ptr<const LedgerVersion>, latest,
+                       store.Latest("trip"));
+  EXPECT_EQ(latest->Version(), version->Version() + 1);
+  EXPECT_EQ(latest->TotalDebt(1), 600);
+}
+
+TEST_F(TestLedgerStore, GroupsAreIndependent) {
+  LedgerStore store({ .num_shards = 2 });
+  for (int i = 0; i < 10; i++) {
+    ASSERT_THAT(store.AddTransactions(absl::StrCat("group", i),
+                                      Debt("alice", "bob", 100 * (i + 1))),
+                IsOk());
+  }
+  for (int i = 0; i < 10; i++) {
+    EXPECT_THAT(store.TotalDebt(absl::StrCat("group", i), "bob"),
+                IsOkAndHolds(100 * (i + 1)));
+  }
+}
+
+TEST_F(TestLedgerStore, UnknownGroupsAndUsersAreNotFound) {
+  LedgerStore store;
+  EXPECT_EQ(store.TotalDebt("trip", "alice").status().code(),
+            absl::StatusCode::kNotFound);
+  EXPECT_EQ(store.Balances("trip").status().code(),
+            absl::StatusCode::kNotFound);
+
+  ASSERT_THAT(store.AddTransactions("trip", DebtList()), IsOk());
+  EXPECT_THAT(store.Balances("trip"), IsOkAndHolds(IsEmpty()));
+  EXPECT_EQ(store.TotalDebt("trip", "alice").status().code(),
+            absl::StatusCode::kNotFound);
+  EXPECT_EQ(store.AmountOwed("trip", "alice", "bob").status().code(),
+            absl::StatusCode::kNotFound);
+}
+
+TEST_F(TestLedgerStore, RejectsInvalidGroupIds) {
+  EXPECT_TRUE(LedgerStore::IsValidGroupId("Trip_2024-08.v2"));
+  for (const absl::string_view group_id :
+       { "", ".", "..", "../trip", "trips/paris", "trip\n", "trip " }) {
+    EXPECT_FALSE(LedgerStore::IsValidGroupId(group_id)) << group_id;
+  }
+  EXPECT_FALSE(LedgerStore::IsValidGroupId(std::string(129, 'a')));
+
+  LedgerStore store({ .dir = dir_ });
+  EXPECT_EQ(store.AddTransactions("../trip", Debt("alice", "bob", 1)).code(),
+            absl::StatusCode::kInvalidArgument);
+  EXPECT_FALSE(std::filesystem::exists(
+      std::filesystem::path(dir_).parent_path() / "trip"));
+}
+
+TEST_F(TestLedgerStore, ConcurrentAddsAndReads) {
+  constexpr int kNumGroups = 4;
+  constexpr int kNumWriters = 8;
+  constexpr int kAddsPerWriter = 100;
+  LedgerStore store({ .num_shards = 2 });
+  for (int i = 0; i < kNumGroups; i++) {
+    ASSERT_THAT(store.AddTransactions(absl::StrCat("group", i), DebtList()),
+                IsOk());
+  }
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumWriters; i++) {
+    threads.emplace_back([&store, i] {
+      const std::string group_id = absl::StrCat("group", i % kNumGroups);
+      for (int j = 0; j < kAddsPerWriter; j++) {
+        EXPECT_THAT(store.AddTransactions(group_id, Debt("alice", "bob", 1)),
+                    IsOk());
+      }
+    });
+    threads.emplace_back([&store, i] {
+      const std::string group_id = absl::StrCat("group", i % kNumGroups);
+      for (int j = 0; j < kAddsPerWriter; j++) {
+        // Every transaction moves a cent from alice to bob, so their
+        // balances always cancel out.
+        absl::StatusOr<std::vector<LedgerStore::UserBalance>> balances =
+            store.Balances(group_id);
+        ASSERT_THAT(balances, IsOk());
+        if (balances->size() == 2) {
+          EXPECT_EQ((*balances)[0].total_debt + (*balances)[1].total_debt, 0);
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  for (int i = 0; i < kNumGroups; i++) {
+    EXPECT_THAT(store.TotalDebt(absl::StrCat("group", i), "bob"),
+                IsOkAndHolds(kNumWriters / kNumGroups * kAddsPerWriter));
+  }
+}
+
+TEST_F(TestLedgerStore, ReloadsGroupsFromDir) {
+  {
+    LedgerStore store({ .dir = dir_ });
+    ASSERT_THAT(store.AddTransactions("trip", Debt("alice", "bob", 500)),
+                IsOk());
+    ASSERT_THAT(store.AddTransactions("rent", Debt("carol", "dave", 900)),
+                IsOk());
+    ASSERT_THAT(store.AddTransactions("trip", Debt("bob", "alice", 200)),
+                IsOk());
+  }
+
+  LedgerStore store({ .dir = dir_ });
+  EXPECT_THAT(store.AmountOwed("trip", "alice", "bob"), IsOkAndHolds(300));
+  EXPECT_THAT(store.TotalDebt("rent", "dave"), IsOkAndHolds(900));
+  EXPECT_EQ(store.Balances("party").status().code(),
+            absl::StatusCode::kNotFound);
+
+  ASSERT_THAT(store.AddTransactions("trip", Debt("alice", "bob", 1)), IsOk());
+  EXPECT_THAT(store.TotalDebt("trip", "bob"), IsOkAndHolds(301));
+}
+
+TEST_F(TestLedgerStore, LatestIfLoadedDoesntLoadGroups) {
+  {
+    LedgerStore store({ .dir = dir_ });
+    ASSERT_THAT(store.AddTransactions("trip", Debt("alice", "bob", 500)),
+                IsOk());
+  }
+
+  LedgerStore store({ .dir = dir_ });
+  EXPECT_THAT(store.LatestIfLoaded("trip"), IsOkAndHolds(nullptr));
+  ASSERT_THAT(store.TotalDebt("trip", "bob"), IsOkAndHolds(500));
+  ASSERT_OK_AND_DEFINE(std::shared_ptr<const LedgerVersion>, version,
+                       store.LatestIfLoaded("trip"));
+  ASSERT_NE(version, nullptr);
+  EXPECT_EQ(version->NumUsers(), 2);
+
+  LedgerStore memory_store;
+  EXPECT_EQ(memory_store.LatestIfLoaded("trip").status().code(),
+            absl::StatusCode::kNotFound);
+}
+
+TEST_F(TestLedgerStore, ClosesLeastRecentlyWrittenLogs) {
+  constexpr int kNumGroups = 20;
+  const auto num_open_files = []() {
+    return std::distance(std::filesystem::directory_iterator("/proc/self/fd"),
+                         std::filesystem::directory_iterator());
+  };
+
+  {
+    LedgerStore store({ .dir = dir_, .max_open_logs = 2 });
+    const auto num_files_before = num_open_files();
+    for (int round = 0; round < 2; round++) {
+      for (int i = 0; i < kNumGroups; i++) {
+        ASSERT_THAT(store.AddTransactions(absl::StrCat("group", i),
+                                          Debt("alice", "bob", i + 1)),
+                    IsOk());
+      }
+    }
+    EXPECT_LE(num_open_files(), num_files_before + 2);
+  }
+
+  LedgerStore store({ .dir = dir_ });
+  for (int i = 0; i < kNumGroups; i++) {
+    EXPECT_THAT(store.TotalDebt(absl::StrCat("group", i), "bob"),
+                IsOkAndHolds(2 * (i + 1)));
+  }
+}
+
+}  // namespace debt_simpl
@@ -0,0 +1,111 @@
+#include "server/src/ledger_store/ledger_version.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+
+#include "proto/debts.pb.h"
+#include "server/src/expense_simplifier/debt_graph.h"
+#include "server/src/util/persistent_string_map.h"
+#include "server/src/util/persistent_vector.h"
+
+namespace debt_simpl {
+
+// static
+std::shared_ptr<const LedgerVersion> LedgerVersion::FromDebtGraph(
+    const DebtGraph& graph) {
+  std::shared_ptr<LedgerVersion> version(new LedgerVersion());
+  for (uint64_t id = 0; id < graph.NumUsers(); id++) {
+    version->ids_.Insert(graph.UserName(id), id);
+
+    auto row = std::make_shared<Row>();
+    row->name = std::string(graph.UserName(id));
+    row->total_debt = graph.DebtGraphInternal::TotalDebt(id);
+    for (const auto [lender_id, debt] :
+         graph.DebtGraphInternal::AllDebts(id)) {
+      if (debt != 0) {
+        row->debts.emplace(lender_id, debt);
+      }
+    }
+    version->rows_.PushBack(std::move(row));
+  }
+  return version;
+}
+
+std::shared_ptr<const LedgerVersion> LedgerVersion::WithTransactions(
+    const DebtList& transactions) const {
+  std::shared_ptr<LedgerVersion> next(new LedgerVersion());
+  next->version_ = version_ + 1;
+  next->ids_ = ids_;
+  next->rows_ = rows_;
+
+  // The rows of the users in the transactions are copied once each, after
+  // which they are updated in place until the version is published.
+  absl::flat_hash_map<uint64_t, Row*> new_rows;
+  const auto find_or_add_user = [&](absl::string_view name) {
+    if (const uint64_t* id = next->ids_.Find(name)) {
+      return *id;
+    }
+    const uint64_t new_id = next->rows_.size();
+    next->ids_.Insert(name, new_id);
+    auto row = std::make_shared<Row>();
+    row->name = std::string(name);
+    new_rows.emplace(new_id, row.get());
+    next->rows_.PushBack(std::move(row));
+    return new_id;
+  };
+  const auto mutable_row = [&](uint64_t id) {
+    const auto [it, inserted] = new_rows.try_emplace(id, nullptr);
+    if (inserted) {
+      auto row = std::make_shared<Row>(*next->rows_[id]);
+      it->second = row.get();
+      next->rows_.Set(id, std::move(row));
+    }
+    return it->second;
+  };
+  const auto add_debt = [](Row* row, uint64_t id, Cents amount) {
+    row->total_debt += amount;
+    const auto [it, inserted] = row->debts.try_emplace(id, amount);
+    if (!inserted) {
+      it->second += amount;
+      if (it->second == 0) {
+        row->debts.erase(it);
+      }
+    } else if (amount == 0) {
+      row->debts.erase(it);
+    }
+  };
+
+  for (const Transaction& transaction : transactions.transactions()) {
+    const uint64_t lender_id = find_or_add_user(transaction.lender());
+    const uint64_t receiver_id = find_or_add_user(transaction.receiver());
+    add_debt(mutable_row(receiver_id), lender_id, transaction.cents());
+    add_debt(mutable_row(lender_id), receiver_id, -transaction.cents());
+  }
+  return next;
+}
+
+absl::StatusOr<uint64_t> LedgerVersion::FindUserId(
+    absl::string_view username) const {
+  const uint64_t* id = ids_.Find(username);
+  if (id == nullptr) {
+    return absl::NotFoundError(absl::StrFormat("No such user %s", username));
+  }
+  return *id;
+}
+
+Cents LedgerVersion::Debt(uint64_t receiver_id, uint64_t lender_id) const {
+  const absl::flat_hash_map<uint64_t, Cents>& debts =
+      rows_[receiver_id]->debts;
+  const auto it = debts.find(lender_id);
+  return it == debts.end() ? 0 : it->second;
+}
+
+}  // namespace debt_simpl
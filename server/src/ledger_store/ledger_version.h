@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+
+#include "proto/debts.pb.h"
+#include "server/src/expense_simplifier/debt_graph.h"
+#include "server/src/util/persistent_string_map.h"
+#include "server/src/util/persistent_vector.h"
+
+namespace debt_simpl {
+
+// An immutable version of the debts of a group.
+//
+// Versions are never modified once built, so any number of threads can read
+// one without locking while a writer builds the next one. A new version
+// copies the row of every user in the transactions it applies, and shares the
+// rows and names of every other user with the version it was built from
+// through persistent trees, so it costs O(log n) per user it touches rather
+// than anything per user of the group.
+class LedgerVersion : public std::enable_shared_from_this<LedgerVersion> {
+ public:
+  // Returns the first version of a group, with the debts of `graph`.
+  static std::shared_ptr<const LedgerVersion> FromDebtGraph(
+      const DebtGraph& graph);
+
+  LedgerVersion(const LedgerVersion&) = delete;
+  LedgerVersion& operator=(const LedgerVersion&) = delete;
+
+  // Returns the version following this one, with `transactions` applied.
+  std::shared_ptr<const LedgerVersion> WithTransactions(
+      const DebtList& transactions) const;
+
+  // Counts the versions before this one, starting from 0 for the version
+  // built from a graph.
+  uint64_t Version() const {
+    return version_;
+  }
+
+  // Returns the number of users in the group. Ids span [0, NumUsers()), in
+  // the order users joined the group.
+  uint64_t NumUsers() const {
+    return rows_.size();
+  }
+
+  absl::string_view UserName(uint64_t id) const {
+    return rows_[id]->name;
+  }
+
+  // Returns the id of `username`, or NotFound if they aren't in the group.
+  absl::StatusOr<uint64_t> FindUserId(absl::string_view username) const;
+
+  // Returns the total debt user `id` owes. Negative if they are owed money.
+  Cents TotalDebt(uint64_t id) const {
+    return rows_[id]->total_debt;
+  }
+
+  // Returns the debt `receiver_id` owes `lender_id`.
+  Cents Debt(uint64_t receiver_id, uint64_t lender_id) const;
+
+ private:
+  // The debts of one user.
+  struct Row {
+    std::string name;
+    Cents total_debt = 0;
+    // The debt the user owes each user they have a nonzero debt with, which
+    // is negative if they are owed money.
+    absl::flat_hash_map<uint64_t, Cents> debts;
+  };
+
+  LedgerVersion() = default;
+
+  uint64_t version_ = 0;
+  // The ids of users by name, and their rows by id.
+  PersistentStringMap<uint64_t> ids_;
+  PersistentVector<std::shared_ptr<const Row>> rows_;
+};
+
+}  // namespace debt_simpl
@@ -0,0 +1,105 @@
+#include "server/src/ledger_store/ledger_version.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "proto/debts.pb.h"
+#include "server/src/expense_simplifier/debt_graph.h"
+#include "server/src/expense_simplifier/debt_list_testing.h"
+#include "server/src/expense_simplifier/utils.h"
+
+namespace debt_simpl {
+
+class TestLedgerVersion : public ::testing::Test {
+ protected:
+  // Expects `version` to hold the same users and debts as `graph`.
+  static void ExpectMatches(const LedgerVersion& version,
+                            const DebtGraph& graph) {
+    ASSERT_EQ(version.NumUsers(), graph.NumUsers());
+    for (uint64_t receiver_id = 0; receiver_id < graph.NumUsers();
+         receiver_id++) {
+      EXPECT_EQ(version.UserName(receiver_id), graph.UserName(receiver_id));
+      EXPECT_THAT(version.FindUserId(graph.UserName(receiver_id)),
+                  IsOkAndHolds(receiver_id));
+      EXPECT_EQ(version.TotalDebt(receiver_id),
+                graph.DebtGraphInternal::TotalDebt(receiver_id));
+      for (uint64_t lender_id = 0; lender_id < graph.NumUsers(); lender_id++) {
+        EXPECT_EQ(version.Debt(receiver_id, lender_id),
+                  graph.Debt(receiver_id, lender_id));
+      }
+    }
+  }
+};
+
+TEST_F(TestLedgerVersion, FromDebtGraph) {
+  const DebtList debts = DebtListOf({ { "alice", "bob", 500 },
+                                      { "carol", "bob", 300 },
+                                      { "bob", "alice", 200 } });
+  ASSERT_OK_AND_DEFINE(DebtGraph, graph, DebtGraph::BuildFromProto(debts));
+  const std::shared_ptr<const LedgerVersion> version =
+      LedgerVersion::FromDebtGraph(graph);
+  EXPECT_EQ(version->Version(), 0);
+  ExpectMatches(*version, graph);
+  EXPECT_EQ(version->FindUserId("dave").status().code(),
+            absl::StatusCode::kNotFound);
+}
+
+TEST_F(TestLedgerVersion, WithTransactionsMatchesDebtGraph) {
+  DebtGraph graph;
+  std::shared_ptr<const LedgerVersion> version =
+      LedgerVersion::FromDebtGraph(graph);
+  for (int i = 0; i < 50; i++) {
+    const DebtList debts = DebtListOf(
+        { { absl::StrCat("user", i % 7), absl::StrCat("user", i % 5),
+            10 * i + 1 },
+          { absl::StrCat("user", i % 3), absl::StrCat("user", i % 11), i } });
+    for (const Transaction& transaction : debts.transactions()) {
+      ASSERT_THAT(graph.AddTransaction(transaction), IsOk());
+    }
+    version = version->WithTransactions(debts);
+  }
+  EXPECT_EQ(version->Version(), 50);
+  ExpectMatches(*version, graph);
+}
+
+TEST_F(TestLedgerVersion, OlderVersionsDontChange) {
+  const std::shared_ptr<const LedgerVersion> first =
+      LedgerVersion::FromDebtGraph(DebtGraph())
+          ->WithTransactions(DebtListOf({ { "alice", "bob", 500 },
+                                          { "carol", "dave", 100 } }));
+  const std::shared_ptr<const LedgerVersion> second =
+      first->WithTransactions(DebtListOf({ { "bob", "alice", 500 },
+                                           { "alice", "erin", 50 } }));
+
+  EXPECT_EQ(first->NumUsers(), 4);
+  EXPECT_EQ(first->FindUserId("erin").status().code(),
+            absl::StatusCode::kNotFound);
+  EXPECT_EQ(first->Debt(1, 0), 500);
+  EXPECT_EQ(first->TotalDebt(0), -500);
+  EXPECT_EQ(first->TotalDebt(3), 100);
+
+  ASSERT_EQ(second->NumUsers(), 5);
+  EXPECT_THAT(second->FindUserId("erin"), IsOkAndHolds(4));
+  EXPECT_EQ(second->Debt(1, 0), 0);
+  EXPECT_EQ(second->Debt(0, 1), 0);
+  EXPECT_EQ(second->TotalDebt(0), -50);
+  EXPECT_EQ(second->TotalDebt(3), 100);
+  EXPECT_EQ(second->UserName(2), "carol");
+}
+
+TEST_F(TestLedgerVersion, SelfTransactionsOweNothing) {
+  const std::shared_ptr<const LedgerVersion> version =
+      LedgerVersion::FromDebtGraph(DebtGraph())
+          ->WithTransactions(DebtListOf({ { "alice", "alice", 500 } }));
+  ASSERT_EQ(version->NumUsers(), 1);
+  EXPECT_EQ(version->TotalDebt(0), 0);
+  EXPECT_EQ(version->Debt(0, 0), 0);
+}
+
+}  // namespace debt_simpl
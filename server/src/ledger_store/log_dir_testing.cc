@@ -0,0 +1,37 @@
+#include "server/src/ledger_store/log_dir_testing.h"
+
+#include <filesystem>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "gtest/gtest.h"
+
+#include "proto/debts.pb.h"
+#include "server/src/expense_simplifier/debt_graph.h"
+
+namespace debt_simpl {
+
+DebtList Debt(absl::string_view lender, absl::string_view receiver,
+              Cents cents) {
+  DebtList debt_list;
+  Transaction& t = *debt_list.add_transactions();
+  t.set_lender(std::string(lender));
+  t.set_receiver(std::string(receiver));
+  t.set_cents(cents);
+  return debt_list;
+}
+
+void LogDirTest::SetUp() {
+  const ::testing::TestInfo& test_info =
+      *::testing::UnitTest::GetInstance()->current_test_info();
+  dir_ = absl::StrCat(::testing::TempDir(), "/", test_info.test_suite_name(),
+                      "_", test_info.name());
+  std::filesystem::remove_all(dir_);
+}
+
+void LogDirTest::TearDown() {
+  std::filesystem::remove_all(dir_);
+}
+
+}  // namespace debt_simpl
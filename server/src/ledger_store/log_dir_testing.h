@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "gtest/gtest.h"
+
+#include "proto/debts.pb.h"
+#include "server/src/expense_simplifier/debt_graph.h"
+
+namespace debt_simpl {
+
+// Returns a list of the single transaction of `receiver` borrowing `cents`
+// from `lender`.
+DebtList Debt(absl::string_view lender, absl::string_view receiver,
+              Cents cents);
+
+// A test with a log directory of its own, named after the test, which
+// doesn't exist when the test starts and is removed once it ends.
+class LogDirTest : public ::testing::Test {
+ protected:
+  void SetUp() override;
+  void TearDown() override;
+
+  std::string dir_;
+};
+
+}  // namespace debt_simpl
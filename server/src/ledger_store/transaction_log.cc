@@ -0,0 +1,415 @@
+#include "server/src/ledger_store/transaction_log.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "absl/crc/crc32c.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+#include "absl/synchronization/mutex.h"
+
+#include "proto/debts.pb.h"
+#include "server/src/expense_simplifier/debt_graph.h"
+#include "server/src/expense_simplifier/ledger_snapshot.h"
+#include "server/src/expense_simplifier/utils.h"
+#include "server/src/util/file_util.h"
+
+namespace debt_simpl {
+
+namespace {
+
+constexpr char kSegmentMagic[8] = { 'D', 'S', 'T', 'X', 'L', 'O', 'G', '\0' };
+constexpr uint32_t kSegmentVersion = 1;
+
+struct SegmentHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+};
+
+// Precedes the serialized Transaction of every record.
+struct RecordHeader {
+  uint32_t size;
+  uint32_t crc32c;
+};
+
+absl::Status FilesystemError(absl::string_view action, const std::string& path,
+                             const std::error_code& error) {
+  return absl::InternalError(
+      absl::StrCat("Failed to ", action, " ", path, ": ", error.message()));
+}
+
+void AppendRecord(const Transaction& transaction, std::string* out) {
+  const std::string payload = transaction.SerializeAsString();
+  const RecordHeader header = {
+    .size = static_cast<uint32_t>(payload.size()),
+    .crc32c = static_cast<uint32_t>(absl::ComputeCrc32c(payload)),
+  };
+  out->append(reinterpret_cast<const char*>(&header), sizeof(header));
+  out->append(payload);
+}
+
+struct ReplayedSegment {
+  uint64_t size;
+  // The size of the header and every record up to the first one that is cut
+  // short or fails its checksum, or 0 if even the header is cut short.
+  uint64_t valid_size;
+};
+
+// Adds the transactions of the valid prefix of the segment at `path` to
+// `graph`.
+absl::StatusOr<ReplayedSegment> ReplaySegment(const std::string& path,
+                                              DebtGraph* graph) {
+  DEFINE_OR_RETURN(MappedFile, file, MappedFile::Open(path));
+  const absl::string_view contents = file.contents();
+  SegmentHeader header;
+  if (contents.size() < sizeof(header)) {
+    return ReplayedSegment{ .size = contents.size(), .valid_size = 0 };
+  }
+  std::memcpy(&header, contents.data(), sizeof(header));
+  if (std::memcmp(header.magic, kSegmentMagic, sizeof(kSegmentMagic)) != 0) {
+    return absl::DataLossError(absl::StrCat(path, " is not a log segment"));
+  }
+  if (header.version != kSegmentVersion) {
+    return absl::FailedPreconditionError(
+        absl::StrFormat("Log segment %s has version %u, expected %u", path,
+                        header.version, kSegmentVersion));
+  }
+
+  uint64_t valid_size = sizeof(header);
+  Transaction transaction;
+  while (contents.size() - valid_size >= sizeof(RecordHeader)) {
+    RecordHeader record;
+    std::memcpy(&record, contents.data() + valid_size, sizeof(record));
+    if (record.size > contents.size() - valid_size - sizeof(record)) {
+      break;
+    }
+    const absl::string_view payload =
+        contents.substr(valid_size + sizeof(record), record.size);
+    if (static_cast<uint32_t>(absl::ComputeCrc32c(payload)) !=
+            record.crc32c ||
+        !transaction.ParseFromArray(payload.data(),
+                                    static_cast<int>(payload.size()))) {
+      break;
+    }
+    RETURN_IF_ERROR(graph->AddTransaction(transaction));
+    valid_size += sizeof(record) + record.size;
+  }
+  return ReplayedSegment{ .size = contents.size(), .valid_size = valid_size };
+}
+
+// Returns `n` if `filename` is `<prefix><n><suffix>`.
+std::optional<uint64_t> ParseNumberedFilename(absl::string_view filename,
+                                              absl::string_view prefix,
+                                              absl::string_view suffix) {
+  uint64_t n;
+  if (!absl::ConsumePrefix(&filename, prefix) ||
+      !absl::ConsumeSuffix(&filename, suffix) ||
+      !absl::SimpleAtoi(filename, &n)) {
+    return std::nullopt;
+  }
+  return n;
+}
+
+constexpr absl::string_view kSegmentPrefix = "segment-";
+constexpr absl::string_view kSegmentSuffix = ".log";
+constexpr absl::string_view kCheckpointPrefix = "checkpoint-";
+constexpr absl::string_view kCheckpointSuffix = ".snap";
+
+}  // namespace
+
+// static
+absl::StatusOr<std::unique_ptr<TransactionLog>> TransactionLog::Open(
+    const std::string& dir, const TransactionLogOptions& options,
+    DebtGraph* graph) {
+  std::error_code error;
+  std::filesystem::create_directories(dir, error);
+  if (error) {
+    return FilesystemError("create", dir, error);
+  }
+
+  std::vector<uint64_t> segments;
+  std::vector<uint64_t> checkpoints;
+  for (const auto& entry : std::filesystem::directory_iterator(dir, error)) {
+    const std::string filename = entry.path().filename().string();
+    if (const auto n = ParseNumberedFilename(filename, kSegmentPrefix,
+                                             kSegmentSuffix)) {
+      segments.push_back(*n);
+    } else if (const auto n = ParseNumberedFilename(
+                   filename, kCheckpointPrefix, kCheckpointSuffix)) {
+      checkpoints.push_back(*n);
+    }
+  }
+  if (error) {
+    return FilesystemError("list", dir, error);
+  }
+  std::sort(segments.begin(), segments.end());
+  std::sort(checkpoints.begin(), checkpoints.end());
+
+  const uint64_t checkpoint = checkpoints.empty() ? 0 : checkpoints.back();
+  std::unique_ptr<TransactionLog> log(
+      new TransactionLog(dir, options, checkpoint));
+
+  *graph = DebtGraph();
+  if (!checkpoints.empty()) {
+    DEFINE_OR_RETURN(LedgerSnapshot, snapshot,
+                     LedgerSnapshot::Open(log->CheckpointPath(checkpoint)));
+    RETURN_IF_ERROR(snapshot.Validate());
+    ASSIGN_OR_RETURN(*graph, snapshot.ToDebtGraph());
+  }
+
+  // Anything older than the checkpoint was left behind by a compaction that
+  // was interrupted after writing it.
+  for (const uint64_t n : checkpoints) {
+    if (n < checkpoint) {
+      std::filesystem::remove(log->CheckpointPath(n), error);
+    }
+  }
+  uint64_t next_segment = checkpoint;
+  for (const uint64_t n : segments) {
+    if (n < checkpoint) {
+      std::filesystem::remove(log->SegmentPath(n), error);
+      continue;
+    }
+    const std::string path = log->SegmentPath(n);
+    DEFINE_OR_RETURN(ReplayedSegment, replayed, ReplaySegment(path, graph));
+    if (replayed.valid_size != replayed.size) {
+      if (n != segments.back()) {
+        return absl::DataLossError(
+            absl::StrFormat("Sealed log segment %s is corrupt at offset %u",
+                            path, replayed.valid_size));
+      }
+      if (truncate(path.c_str(), static_cast<off_t>(replayed.valid_size)) !=
+          0) {
+        return ErrnoError("truncate", path);
+      }
+    }
+    next_segment = n + 1;
+  }
+
+  // Appends always go to a new segment, so that one cut short by a crash is
+  // never appended to.
+  absl::MutexLock lock(&log->mutex_);
+  RETURN_IF_ERROR(log->StartSegment(next_segment));
+  return log;
+}
+
+TransactionLog::TransactionLog(const std::string& dir,
+                               const TransactionLogOptions& options,
+                               uint64_t checkpoint)
+    : dir_(dir), options_(options), checkpoint_(checkpoint) {}
+
+TransactionLog::~TransactionLog() {
+  absl::MutexLock lock(&mutex_);
+  while (compaction_scheduled_ || writing_) {
+    synced_.Wait(&mutex_);
+  }
+  if (segment_fd_ >= 0) {
+    close(segment_fd_);
+  }
+}
+
+std::string TransactionLog::SegmentPath(uint64_t n) const {
+  return absl::StrCat(dir_, "/", kSegmentPrefix, n, kSegmentSuffix);
+}
+
+std::string TransactionLog::CheckpointPath(uint64_t n) const {
+  return absl::StrCat(dir_, "/", kCheckpointPrefix, n, kCheckpointSuffix);
+}
+
+absl::Status TransactionLog::StartSegment(uint64_t n) {
+  const std::string path = SegmentPath(n);
+  const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    return ErrnoError("open", path);
+  }
+  SegmentHeader header = {};
+  std::memcpy(header.magic, kSegmentMagic, sizeof(kSegmentMagic));
+  header.version = kSegmentVersion;
+  absl::Status status = WriteAll(
+      fd, absl::string_view(reinterpret_cast<const char*>(&header),
+                            sizeof(header)),
+      path);
+  if (status.ok() && fdatasync(fd) != 0) {
+    status = ErrnoError("sync", path);
+  }
+  if (status.ok()) {
+    status = SyncDirectory(dir_);
+  }
+  if (!status.ok()) {
+    close(fd);
+    return status;
+  }
+
+  if (segment_fd_ >= 0) {
+    close(segment_fd_);
+  }
+  segment_ = n;
+  segment_fd_ = fd;
+  stats_.segment_bytes = sizeof(header);
+  return absl::OkStatus();
+}
+
+absl::Status TransactionLog::Append(const DebtList& transactions) {
+  std::string records;
+  for (const Transaction& transaction : transactions.transactions()) {
+    AppendRecord(transaction, &records);
+  }
+
+  absl::MutexLock lock(&mutex_);
+  if (!write_error_.ok()) {
+    return write_error_;
+  }
+  if (segment_fd_ < 0) {
+    // It stays open until every append from now on is written.
+    const std::string path = SegmentPath(segment_);
+    segment_fd_ = open(path.c_str(), O_WRONLY | O_APPEND);
+    if (segment_fd_ < 0) {
+      return ErrnoError("reopen", path);
+    }
+  }
+  pending_records_.append(records);
+  stats_.appended_transactions += transactions.transactions_size();
+  const uint64_t ticket = ++num_tickets_;
+
+  while (synced_tickets_ < ticket) {
+    if (writing_) {
+      synced_.Wait(&mutex_);
+      continue;
+    }
+
+    // Nobody is writing, so this append leads the next batch, which holds
+    // its own records and those of every append that came in meanwhile.
+    writing_ = true;
+    const std::string batch = std::move(pending_records_);
+    pending_records_.clear();
+    const uint64_t batch_tickets = num_tickets_;
+    const int fd = segment_fd_;
+    const std::string path = SegmentPath(segment_);
+
+    mutex_.Unlock();
+    absl::Status status = WriteAll(fd, batch, path);
+    if (status.ok() && fdatasync(fd) != 0) {
+      status = ErrnoError("sync", path);
+    }
+    mutex_.Lock();
+
+    writing_ = false;
+    synced_tickets_ = batch_tickets;
+    stats_.syncs++;
+    stats_.segment_bytes += batch.size();
+    if (!status.ok() && write_error_.ok()) {
+      write_error_ = status;
+    }
+    MaybeScheduleCompaction();
+    synced_.SignalAll();
+  }
+  return write_error_;
+}
+
+void TransactionLog::MaybeScheduleCompaction() {
+  if (options_.compaction_pool == nullptr || compaction_scheduled_ ||
+      stats_.segment_bytes < options_.compact_after_bytes) {
+    return;
+  }
+  compaction_scheduled_ = true;
+  options_.compaction_pool->Schedule([this] {
+    // A failed compaction loses nothing, and is retried once the segment
+    // grows past the threshold again.
+    Compact().IgnoreError();
+    absl::MutexLock lock(&mutex_);
+    compaction_scheduled_ = false;
+    synced_.SignalAll();
+  });
+}
+
+absl::Status TransactionLog::Compact() {
+  absl::MutexLock compaction_lock(&compaction_mutex_);
+
+  // Seals the segment appended to, unless it has no records yet, in which
+  // case only the segments before it are folded.
+  uint64_t end;
+  {
+    absl::MutexLock lock(&mutex_);
+    while (writing_) {
+      synced_.Wait(&mutex_);
+    }
+    if (!write_error_.ok()) {
+      return write_error_;
+    }
+    if (stats_.segment_bytes > sizeof(SegmentHeader)) {
+      RETURN_IF_ERROR(StartSegment(segment_ + 1));
+    }
+    end = segment_;
+  }
+  if (end == checkpoint_) {
+    return absl::OkStatus();
+  }
+
+  DebtGraph graph;
+  const std::string checkpoint_path = CheckpointPath(checkpoint_);
+  std::error_code error;
+  if (std::filesystem::exists(checkpoint_path, error)) {
+    DEFINE_OR_RETURN(LedgerSnapshot, snapshot,
+                     LedgerSnapshot::Open(checkpoint_path));
+    ASSIGN_OR_RETURN(graph, snapshot.ToDebtGraph());
+  }
+  for (uint64_t n = checkpoint_; n < end; n++) {
+    const std::string path = SegmentPath(n);
+    if (!std::filesystem::exists(path, error)) {
+      continue;
+    }
+    DEFINE_OR_RETURN(ReplayedSegment, replayed, ReplaySegment(path, &graph));
+    if (replayed.valid_size != replayed.size) {
+      return absl::DataLossError(
+          absl::StrFormat("Sealed log segment %s is corrupt at offset %u",
+                          path, replayed.valid_size));
+    }
+  }
+
+  // The new checkpoint is in place before anything it covers is removed, so
+  // an interrupted compaction leaves either the old state or the new one.
+  RETURN_IF_ERROR(LedgerSnapshot::Write(graph, CheckpointPath(end)));
+  RETURN_IF_ERROR(SyncDirectory(dir_));
+  std::filesystem::remove(checkpoint_path, error);
+  for (uint64_t n = checkpoint_; n < end; n++) {
+    std::filesystem::remove(SegmentPath(n), error);
+  }
+  checkpoint_ = end;
+
+  absl::MutexLock lock(&mutex_);
+  stats_.compactions++;
+  return absl::OkStatus();
+}
+
+void TransactionLog::CloseFile() {
+  absl::MutexLock lock(&mutex_);
+  if (writing_ || synced_tickets_ != num_tickets_ || segment_fd_ < 0) {
+    return;
+  }
+  close(segment_fd_);
+  segment_fd_ = -1;
+}
+
+TransactionLog::Stats TransactionLog::GetStats() const {
+  absl::MutexLock lock(&mutex_);
+  return stats_;
+}
+
+}  // namespace debt_simpl
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+
+#include "proto/debts.pb.h"
+#include "server/src/expense_simplifier/debt_graph.h"
+#include "server/src/expense_simplifier/thread_pool.h"
+
+namespace debt_simpl {
+
+struct TransactionLogOptions {
+  // Once the segment being appended to grows past this many bytes, it is
+  // sealed and folded into the checkpoint on `compaction_pool`.
+  uint64_t compact_after_bytes = 4 << 20;
+
+  // Runs background compactions, and must outlive the log. Without one, the
+  // log only compacts when `Compact()` is called.
+  ThreadPool* compaction_pool = nullptr;
+};
+
+// A durable, append-only log of the transactions of one group.
+//
+// The log lives in a directory of its own, as numbered segments of records
+// and a checkpoint:
+//
+//   - `segment-<n>.log` holds a header followed by records, each the size
+//     and CRC-32C of a serialized Transaction, then the transaction itself.
+//     Only the highest numbered segment is appended to.
+//   - `checkpoint-<n>.snap` is a LedgerSnapshot of the net debts of every
+//     transaction in the segments numbered below `n`.
+//
+// Compaction seals the segment being appended to and folds the sealed
+// segments into a new checkpoint, so the log never has to be rewritten as a
+// whole, and appends carry on into a new segment while it runs.
+class TransactionLog {
+ public:
+  struct Stats {
+    uint64_t appended_transactions = 0;
+    // The number of times appended records were synced to disk, which is
+    // less than the number of appends when concurrent appends share a sync.
+    uint64_t syncs = 0;
+    uint64_t compactions = 0;
+    // The size of the segment being appended to.
+    uint64_t segment_bytes = 0;
+  };
+
+  // Opens the log in `dir`, creating it if it doesn't exist, and rebuilds
+  // the group's graph into `graph` from the checkpoint and the segments
+  // after it.
+  //
+  // A crash can leave the last record half written. The last segment is
+  // truncated at the first record whose checksum doesn't match, since none
+  // of the appends past it were acknowledged. A bad record in an earlier
+  // segment, which was fully synced before it was sealed, is an error.
+  static absl::StatusOr<std::unique_ptr<TransactionLog>> Open(
+      const std::string& dir, const TransactionLogOptions& options,
+      DebtGraph* graph);
+
+  // Waits for a background compaction in progress to finish.
+  ~TransactionLog();
+
+  TransactionLog(const TransactionLog&) = delete;
+  TransactionLog& operator=(const TransactionLog&) = delete;
+
+  // Appends `transactions` to the log, and returns once they are synced to
+  // disk. Thread-safe.
+  //
+  // Appends are group-committed: one caller at a time writes and syncs every
+  // record appended so far, while the others wait for it and then either
+  // find their records synced or take the next batch. Once a write fails,
+  // every append fails, as the end of the log is no longer known.
+  absl::Status Append(const DebtList& transactions);
+
+  // Seals the segment being appended to and folds every sealed segment into
+  // a new checkpoint. Thread-safe, and appends aren't held up while it runs.
+  // Compaction never drops a record that isn't in the new checkpoint, so a
+  // failed or interrupted one can simply be retried.
+  absl::Status Compact();
+
+  // Closes the file of the segment appended to, for the next append to
+  // reopen, unless appends are in flight. Thread-safe.
+  void CloseFile();
+
+  Stats GetStats() const;
+
+ private:
+  TransactionLog(const std::string& dir, const TransactionLogOptions& options,
+                 uint64_t checkpoint);
+
+  // Returns the paths of segment and checkpoint `n`.
+  std::string SegmentPath(uint64_t n) const;
+  std::string CheckpointPath(uint64_t n) const;
+
+  // Creates segment `n` with its header and makes it the one appended to.
+  absl::Status StartSegment(uint64_t n) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Schedules a compaction if the segment being appended to is over the
+  // threshold and none is scheduled yet.
+  void MaybeScheduleCompaction() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const std::string dir_;
+  const TransactionLogOptions options_;
+
+  // Held for the whole of a compaction, so that they run one at a time.
+  absl::Mutex compaction_mutex_ ABSL_ACQUIRED_BEFORE(mutex_);
+  // The checkpoint covering every segment below it.
+  uint64_t checkpoint_ ABSL_GUARDED_BY(compaction_mutex_);
+
+  mutable absl::Mutex mutex_;
+  absl::CondVar synced_;
+
+  // The segment appended to, and its file, which is -1 while it's closed.
+  uint64_t segment_ ABSL_GUARDED_BY(mutex_) = 0;
+  int segment_fd_ ABSL_GUARDED_BY(mutex_) = -1;
+
+  // Records appended but not yet written, and the number of appends they
+  // span. An append's ticket is the number of appends up to and including
+  // it, and it is synced once `synced_tickets_` reaches its ticket.
+  std::string pending_records_ ABSL_GUARDED_BY(mutex_);
+  uint64_t num_tickets_ ABSL_GUARDED_BY(mutex_) = 0;
+  uint64_t synced_tickets_ ABSL_GUARDED_BY(mutex_) = 0;
+  // Whether an appender is writing a batch, outside of the lock.
+  bool writing_ ABSL_GUARDED_BY(mutex_) = false;
+  // The first write error, after which every append fails.
+  absl::Status write_error_ ABSL_GUARDED_BY(mutex_);
+
+  bool compaction_scheduled_ ABSL_GUARDED_BY(mutex_) = false;
+  Stats stats_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace debt_simpl
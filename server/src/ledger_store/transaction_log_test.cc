@@ -0,0 +1,241 @@
+#include "server/src/ledger_store/transaction_log.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "proto/debts.pb.h"
+#include "server/src/expense_simplifier/debt_graph.h"
+#include "server/src/expense_simplifier/thread_pool.h"
+#include "server/src/expense_simplifier/utils.h"
+#include "server/src/ledger_store/log_dir_testing.h"
+
+namespace debt_simpl {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using ::testing::Not;
+
+class TestTransactionLog : public LogDirTest {
+ protected:
+  // Returns the names of the files in the log directory with `prefix`.
+  std::vector<std::string> FilesStartingWith(absl::string_view prefix) const {
+    std::vector<std::string> files;
+    for (const auto& entry : std::filesystem::directory_iterator(dir_)) {
+      const std::string filename = entry.path().filename().string();
+      if (absl::StartsWith(filename, prefix)) {
+        files.push_back(filename);
+      }
+    }
+    return files;
+  }
+};
+
+TEST_F(TestTransactionLog, ReplaysAppendsOnOpen) {
+  {
+    DebtGraph graph;
+    ASSERT_OK_AND_DEFINE(std::unique_ptr<TransactionLog>, log,
+                         TransactionLog::Open(dir_, {}, &graph));
+    EXPECT_EQ(graph.NumUsers(), 0);
+    ASSERT_THAT(log->Append(Debt("alice", "bob", 500)), IsOk());
+    ASSERT_THAT(log->Append(Debt("bob", "alice", 200)), IsOk());
+    ASSERT_THAT(log->Append(Debt("carol", "bob", 100)), IsOk());
+    EXPECT_EQ(log->GetStats().appended_transactions, 3);
+  }
+
+  DebtGraph graph;
+  ASSERT_OK_AND_DEFINE(std::unique_ptr<TransactionLog>, log,
+                       TransactionLog::Open(dir_, {}, &graph));
+  EXPECT_THAT(graph.AmountOwed("alice", "bob"), IsOkAndHolds(300));
+  EXPECT_THAT(graph.AmountOwed("carol", "bob"), IsOkAndHolds(100));
+}
+
+TEST_F(TestTransactionLog, ConcurrentAppendsAreAllLogged) {
+  constexpr int kNumThreads = 8;
+  constexpr int kAppendsPerThread = 50;
+  {
+    DebtGraph graph;
+    ASSERT_OK_AND_DEFINE(std::unique_ptr<TransactionLog>, log,
+                         TransactionLog::Open(dir_, {}, &graph));
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kNumThreads; i++) {
+      threads.emplace_back([&log, i] {
+        for (int j = 0; j < kAppendsPerThread; j++) {
+          EXPECT_THAT(log->Append(Debt("lender", absl::StrCat("user", i), 1)),
+                      IsOk());
+        }
+      });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    const TransactionLog::Stats stats = log->GetStats();
+    EXPECT_EQ(stats.appended_transactions, kNumThreads * kAppendsPerThread);
+    EXPECT_LE(stats.syncs, kNumThreads * kAppendsPerThread);
+  }
+
+  DebtGraph graph;
+  ASSERT_OK_AND_DEFINE(std::unique_ptr<TransactionLog>, log,
+                       TransactionLog::Open(dir_, {}, &graph));
+  EXPECT_THAT(graph.TotalDebt("lender"),
+              IsOkAndHolds(-kNumThreads * kAppendsPerThread));
+  for (int i = 0; i < kNumThreads; i++) {
+    EXPECT_THAT(graph.TotalDebt(absl::StrCat("user", i)),
+                IsOkAndHolds(kAppendsPerThread));
+  }
+}
+
+TEST_F(TestTransactionLog, DropsTornRecordAtEnd) {
+  {
+    DebtGraph graph;
+    ASSERT_OK_AND_DEFINE(std::unique_ptr<TransactionLog>, log,
+                         TransactionLog::Open(dir_, {}, &graph));
+    ASSERT_THAT(log->Append(Debt("alice", "bob", 500)), IsOk());
+    ASSERT_THAT(log->Append(Debt("alice", "bob", 7)), IsOk());
+  }
+  // Cuts the last record short, like a crash in the middle of writing it.
+  const std::string segment = dir_ + "/segment-0.log";
+  std::filesystem::resize_file(segment,
+                               std::filesystem::file_size(segment) - 3);
+
+  {
+    DebtGraph graph;
+    ASSERT_OK_AND_DEFINE(std::unique_ptr<TransactionLog>, log,
+                         TransactionLog::Open(dir_, {}, &graph));
+    EXPECT_THAT(graph.AmountOwed("alice", "bob"), IsOkAndHolds(500));
+    ASSERT_THAT(log->Append(Debt("alice", "bob", 20)), IsOk());
+  }
+
+  DebtGraph graph;
+  ASSERT_OK_AND_DEFINE(std::unique_ptr<TransactionLog>, log,
+                       TransactionLog::Open(dir_, {}, &graph));
+  EXPECT_THAT(graph.AmountOwed("alice", "bob"), IsOkAndHolds(520));
+}
+
+TEST_F(TestTransactionLog, DropsRecordsFailingChecksum) {
+  {
+    DebtGraph graph;
+    ASSERT_OK_AND_DEFINE(std::unique_ptr<TransactionLog>, log,
+                         TransactionLog::Open(dir_, {}, &graph));
+    ASSERT_THAT(log->Append(Debt("alice", "bob", 500)), IsOk());
+    ASSERT_THAT(log->Append(Debt("carol", "dave", 7)), IsOk());
+  }
+  // Flips the last byte of the last record's transaction.
+  const std::string segment = dir_ + "/segment-0.log";
+  FILE* file = std::fopen(segment.c_str(), "r+b");
+  ASSERT_NE(file, nullptr);
+  std::fseek(file, -1, SEEK_END);
+  const int last = std::fgetc(file);
+  std::fseek(file, -1, SEEK_END);
+  std::fputc(last ^ 0xff, file);
+  std::fclose(file);
+
+  DebtGraph graph;
+  ASSERT_OK_AND_DEFINE(std::unique_ptr<TransactionLog>, log,
+                       TransactionLog::Open(dir_, {}, &graph));
+  EXPECT_THAT(graph.AmountOwed("alice", "bob"), IsOkAndHolds(500));
+  EXPECT_THAT(graph.FindUserId("dave"), Not(IsOk()));
+}
+
+TEST_F(TestTransactionLog, CompactFoldsSegmentsIntoCheckpoint) {
+  {
+    DebtGraph graph;
+    ASSERT_OK_AND_DEFINE(std::unique_ptr<TransactionLog>, log,
+                         TransactionLog::Open(dir_, {}, &graph));
+    ASSERT_THAT(log->Append(Debt("alice", "bob", 500)), IsOk());
+    ASSERT_THAT(log->Append(Debt("bob", "alice", 200)), IsOk());
+    ASSERT_THAT(log->Compact(), IsOk());
+    EXPECT_EQ(log->GetStats().compactions, 1);
+    EXPECT_THAT(FilesStartingWith("checkpoint-"),
+                ElementsAre("checkpoint-1.snap"));
+    EXPECT_THAT(FilesStartingWith("segment-"),
+                ElementsAre("segment-1.log"));
+
+    ASSERT_THAT(log->Append(Debt("carol", "bob", 100)), IsOk());
+    ASSERT_THAT(log->Compact(), IsOk());
+    // Without new records there is nothing to fold.
+    ASSERT_THAT(log->Compact(), IsOk());
+    EXPECT_EQ(log->GetStats().compactions, 2);
+    EXPECT_THAT(FilesStartingWith("checkpoint-"),
+                ElementsAre("checkpoint-2.snap"));
+  }
+
+  DebtGraph graph;
+  ASSERT_OK_AND_DEFINE(std::unique_ptr<TransactionLog>, log,
+                       TransactionLog::Open(dir_, {}, &graph));
+  EXPECT_THAT(graph.AmountOwed("alice", "bob"), IsOkAndHolds(300));
+  EXPECT_THAT(graph.AmountOwed("carol", "bob"), IsOkAndHolds(100));
+  ASSERT_THAT(log->Append(Debt("alice", "bob", 1)), IsOk());
+}
+
+TEST_F(TestTransactionLog, CompactsInBackground) {
+  ThreadPool pool(1);
+  {
+    DebtGraph graph;
+    ASSERT_OK_AND_DEFINE(
+        std::unique_ptr<TransactionLog>, log,
+        TransactionLog::Open(
+            dir_, { .compact_after_bytes = 256, .compaction_pool = &pool },
+            &graph));
+    for (int i = 0; i < 100; i++) {
+      ASSERT_THAT(log->Append(Debt("alice", "bob", 1)), IsOk());
+    }
+    pool.Wait();
+    EXPECT_GT(log->GetStats().compactions, 0);
+  }
+
+  DebtGraph graph;
+  ASSERT_OK_AND_DEFINE(std::unique_ptr<TransactionLog>, log,
+                       TransactionLog::Open(dir_, {}, &graph));
+  EXPECT_THAT(graph.AmountOwed("alice", "bob"), IsOkAndHolds(100));
+}
+
+TEST_F(TestTransactionLog, RecoversFromInterruptedCompaction) {
+  {
+    DebtGraph graph;
+    ASSERT_OK_AND_DEFINE(std::unique_ptr<TransactionLog>, log,
+                         TransactionLog::Open(dir_, {}, &graph));
+    ASSERT_THAT(log->Append(Debt("alice", "bob", 500)), IsOk());
+    ASSERT_THAT(log->Compact(), IsOk());
+    ASSERT_THAT(log->Append(Debt("alice", "bob", 20)), IsOk());
+  }
+  // Brings back a segment the checkpoint covers, like a crash right after
+  // writing the checkpoint.
+  std::filesystem::copy_file(dir_ + "/segment-1.log", dir_ + "/segment-0.log");
+
+  DebtGraph graph;
+  ASSERT_OK_AND_DEFINE(std::unique_ptr<TransactionLog>, log,
+                       TransactionLog::Open(dir_, {}, &graph));
+  EXPECT_THAT(graph.AmountOwed("alice", "bob"), IsOkAndHolds(520));
+  EXPECT_THAT(FilesStartingWith("segment-0"), IsEmpty());
+}
+
+TEST_F(TestTransactionLog, ReopensClosedFile) {
+  {
+    DebtGraph graph;
+    ASSERT_OK_AND_DEFINE(std::unique_ptr<TransactionLog>, log,
+                         TransactionLog::Open(dir_, {}, &graph));
+    ASSERT_THAT(log->Append(Debt("alice", "bob", 500)), IsOk());
+    log->CloseFile();
+    log->CloseFile();
+    ASSERT_THAT(log->Append(Debt("bob", "alice", 200)), IsOk());
+    log->CloseFile();
+  }
+
+  DebtGraph graph;
+  ASSERT_OK_AND_DEFINE(std::unique_ptr<TransactionLog>, log,
+                       TransactionLog::Open(dir_, {}, &graph));
+  EXPECT_THAT(graph.AmountOwed("alice", "bob"), IsOkAndHolds(300));
+}
+
+}  // namespace debt_simpl
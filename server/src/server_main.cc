@@ -1,38 +1,133 @@
+#include <pthread.h>
+#include <signal.h>
+
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <iostream>
 #include <memory>
-#include <stdio.h>
+#include <string>
+#include <thread>
 
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
-#include "grpcpp/server_builder.h"
+#include "absl/time/time.h"
 
-#include "server/src/service.h"
+#include "server/src/async_server.h"
 #include "server/src/static_file_server.h"
 
-std::unique_ptr<grpc::Server> MakeRpcServer(const std::string& addr,
-                                            uint16_t port) {
-  debt_simpl::ServiceImpl service;
+ABSL_FLAG(uint32_t, num_completion_queues, 2,
+          "The number of completion queues RPCs are spread over.");
+ABSL_FLAG(uint32_t, pollers_per_completion_queue, 2,
+          "The number of threads polling each completion queue.");
+ABSL_FLAG(uint32_t, num_compute_threads, 0,
+          "The number of threads simplifying ledgers. Defaults to one per "
+          "core.");
+ABSL_FLAG(size_t, cache_max_entries, 1024,
+          "The most simplification results kept for resubmitted ledgers. 0 "
+          "disables the cache.");
+ABSL_FLAG(size_t, cache_max_mib, 64,
+          "The most memory used by cached simplification results, in MiB.");
+ABSL_FLAG(std::string, cache_snapshot, "",
+          "If set, cached simplification results are saved to this file on "
+          "shutdown and restored from it on startup, so a restarted server "
+          "doesn't start cold.");
 
-  grpc::ServerBuilder builder;
-  builder.AddListeningPort(absl::StrCat(addr, ":", port),
-                           grpc::InsecureServerCredentials());
-  builder.RegisterService(&service);
+ABSL_FLAG(absl::Duration, max_optimize_time, absl::Seconds(1),
+          "The longest a SimplifyDebts RPC may search for fewer transactions, "
+          "whatever it asks for.");
+ABSL_FLAG(uint32_t, max_optimize_balances, 256,
+          "SimplifyDebts RPCs on ledgers with more nonzero balances than this "
+          "don't search for fewer transactions.");
 
-  auto server = builder.BuildAndStart();
-  std::cout << "RPC server listening on " << addr << ":" << port << std::endl;
+ABSL_FLAG(absl::Duration, shutdown_grace_period, absl::Seconds(10),
+          "How long shutdown waits for the RPCs in progress before cancelling "
+          "them.");
 
-  return server;
-}
+ABSL_FLAG(std::string, ledger_dir, "",
+          "If set, the transactions of every group are logged to this "
+          "directory, and groups survive restarts. Otherwise they only live "
+          "in memory.");
+
+int main(int argc, char* argv[]) {
+  absl::ParseCommandLine(argc, argv);
+
+  // Shutdown signals are blocked before any thread starts, so every thread
+  // inherits the mask and they are only ever taken by `sigwait()` below.
+  sigset_t shutdown_signals;
+  sigemptyset(&shutdown_signals);
+  sigaddset(&shutdown_signals, SIGINT);
+  sigaddset(&shutdown_signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &shutdown_signals, nullptr);
 
-int main() {
   const std::string addr = "10.0.0.181";
   const uint16_t sfs_port = 3000;
   const uint16_t rpc_port = 3002;
 
+  uint32_t num_compute_threads = absl::GetFlag(FLAGS_num_compute_threads);
+  if (num_compute_threads == 0) {
+    num_compute_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  const debt_simpl::AsyncServerOptions rpc_options = {
+    .num_completion_queues = absl::GetFlag(FLAGS_num_completion_queues),
+    .pollers_per_completion_queue =
+        absl::GetFlag(FLAGS_pollers_per_completion_queue),
+    .num_compute_threads = num_compute_threads,
+    .optimize_options = {
+      .max_time = absl::GetFlag(FLAGS_max_optimize_time),
+      .max_balances = absl::GetFlag(FLAGS_max_optimize_balances),
+    },
+    .cache_options = {
+      .max_entries = absl::GetFlag(FLAGS_cache_max_entries),
+      .max_bytes = absl::GetFlag(FLAGS_cache_max_mib) << 20,
+    },
+    .ledger_store_options = {
+      .dir = absl::GetFlag(FLAGS_ledger_dir),
+    },
+    .shutdown_grace_period = absl::GetFlag(FLAGS_shutdown_grace_period),
+  };
+
   auto file_server = StaticFileServer::New("client/dist/dev/static");
-  auto rpc_server = MakeRpcServer(addr, rpc_port);
+  absl::StatusOr<std::unique_ptr<debt_simpl::AsyncServer>> rpc_server =
+      debt_simpl::AsyncServer::Start(absl::StrCat(addr, ":", rpc_port),
+                                     rpc_options);
+  if (!rpc_server.ok()) {
+    std::cerr << rpc_server.status() << std::endl;
+    return -1;
+  }
+  std::cout << "RPC server listening on " << addr << ":" << rpc_port
+            << std::endl;
+
+  const std::string cache_snapshot = absl::GetFlag(FLAGS_cache_snapshot);
+  if (!cache_snapshot.empty()) {
+    const absl::Status status = (*rpc_server)->RestoreCache(cache_snapshot);
+    if (status.ok()) {
+      std::cout << "Restoring cached results from " << cache_snapshot
+                << std::endl;
+    } else if (!absl::IsNotFound(status)) {
+      std::cerr << "Starting with an empty cache: " << status << std::endl;
+    }
+  }
+
+  std::thread file_server_thread(
+      [&file_server, &addr] { file_server->Listen(addr, sfs_port); });
 
-  file_server->Listen(addr, sfs_port);
-  rpc_server->Wait();
+  int signal;
+  sigwait(&shutdown_signals, &signal);
+  std::cout << "Shutting down" << std::endl;
+  file_server->Stop();
+  file_server_thread.join();
+  (*rpc_server)->Shutdown();
 
+  if (!cache_snapshot.empty()) {
+    const absl::Status status = (*rpc_server)->SaveCache(cache_snapshot);
+    if (!status.ok()) {
+      std::cerr << "Failed to save cached results: " << status << std::endl;
+      return -1;
+    }
+  }
   return 0;
 }
@@ -1,14 +1,256 @@
 #include "server/src/service.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "grpcpp/support/status.h"
 
+#include "server/src/expense_simplifier/anytime_simplifier.h"
+#include "server/src/expense_simplifier/debt_graph.h"
+#include "server/src/expense_simplifier/expense_simplifier.h"
+#include "server/src/expense_simplifier/simplification_cache.h"
+#include "server/src/ledger_store/ledger_store.h"
+#include "server/src/ledger_store/ledger_version.h"
+
 namespace debt_simpl {
 
-grpc::Status ServiceImpl::Test(grpc::ServerContext* context, const TestReq* req,
-                               TestRes* res) {
-  std::cout << "Received test req with " << res->msg() << std::endl;
-  res->set_msg(req->msg());
+namespace {
+
+grpc::Status ToGrpcStatus(const absl::Status& status) {
+  // absl and gRPC share the canonical status codes.
+  return grpc::Status(static_cast<grpc::StatusCode>(status.code()),
+                      std::string(status.message()));
+}
+
+// Requests are served by a fixed set of threads, so each keeps the buffers of
+// its last simplification around for the next one.
+SimplifierWorkspace* ThreadWorkspace() {
+  thread_local SimplifierWorkspace workspace;
+  return &workspace;
+}
+
+// Returns the server's options, in the mode `req` asks for.
+ExpenseSimplifierOptions RequestOptions(
+    const SimplifyDebtsReq& req,
+    const ExpenseSimplifierOptions& simplifier_options) {
+  ExpenseSimplifierOptions options = simplifier_options;
+  switch (req.mode()) {
+    case SimplifyDebtsReq::EXISTING_EDGES:
+      options.mode = SimplificationMode::kExistingEdges;
+      break;
+    case SimplifyDebtsReq::NET_BALANCES:
+      options.mode = SimplificationMode::kNetBalances;
+      break;
+    case SimplifyDebtsReq::MIN_TRANSACTIONS:
+      options.mode = SimplificationMode::kMinTransactions;
+      break;
+  }
+  return options;
+}
+
+// Searches for fewer transactions settling `graph` than `options` find, for
+// as long as `req` asks within `optimize_options` and `deadline`, and returns
+// the best found.
+std::shared_ptr<const DebtList> OptimizedTransactions(
+    const SimplifyDebtsReq& req, DebtGraph&& graph,
+    const ExpenseSimplifierOptions& options,
+    const OptimizeOptions& optimize_options, absl::Time deadline) {
+  AnytimeSimplifier simplifier(std::move(graph), options);
+  if (simplifier.NumBalances() <= optimize_options.max_balances) {
+    const absl::Time now = absl::Now();
+    simplifier.Improve(
+        std::min({ now + absl::Milliseconds(req.optimize_for_ms()),
+                   now + optimize_options.max_time, deadline }));
+  }
+  return simplifier.BestTransactions();
+}
+
+// Returns whether another simplification of the same ledger would give the
+// same result as `simplifier`, so it may be cached. The exact search of
+// `kMinTransactions` mode falls back to `kNetBalances` when it runs out of
+// time, which depends on the load of the server.
+bool IsCacheable(const ExpenseSimplifier& simplifier,
+                 const ExpenseSimplifierOptions& options) {
+  return options.mode != SimplificationMode::kMinTransactions ||
+         simplifier.IsExact();
+}
+
+// Answers with the balances `req` asks for from `version` of its group.
+// Every balance is read from the same version, so they add up even while
+// transactions are added to the group.
+grpc::Status BalancesOf(const GetGroupBalancesReq& req,
+                        const LedgerVersion& version,
+                        GetGroupBalancesRes* res) {
+  if (req.users().empty()) {
+    for (uint64_t id = 0; id < version.NumUsers(); id++) {
+      GetGroupBalancesRes::Balance& out = *res->add_balances();
+      out.set_user(std::string(version.UserName(id)));
+      out.set_total_debt(version.TotalDebt(id));
+    }
+    return grpc::Status::OK;
+  }
+  for (const std::string& user : req.users()) {
+    absl::StatusOr<uint64_t> id = version.FindUserId(user);
+    if (!id.ok()) {
+      return ToGrpcStatus(id.status());
+    }
+    GetGroupBalancesRes::Balance& out = *res->add_balances();
+    out.set_user(user);
+    out.set_total_debt(version.TotalDebt(*id));
+  }
+  return grpc::Status::OK;
+}
+
+}  // namespace
+
+grpc::Status SimplifyDebts(const SimplifyDebtsReq& req,
+                           const ExpenseSimplifierOptions& simplifier_options,
+                           const OptimizeOptions& optimize_options,
+                           absl::Time deadline, SimplificationCache* cache,
+                           SimplifyDebtsRes* res) {
+  absl::StatusOr<DebtGraph> graph = DebtGraph::BuildFromProto(req.debts());
+  if (!graph.ok()) {
+    return ToGrpcStatus(graph.status());
+  }
+  if (req.optimize_for_ms() > 0) {
+    // Results depend on how long the search ran, so they aren't cached.
+    *res->mutable_transactions() = *OptimizedTransactions(
+        req, std::move(*graph), RequestOptions(req, simplifier_options),
+        optimize_options, deadline);
+    return grpc::Status::OK;
+  }
+  return SimplifyDebtGraph(std::move(*graph),
+                           RequestOptions(req, simplifier_options), cache, res);
+}
+
+grpc::Status StreamSimplifiedDebts(
+    const SimplifyDebtsReq& req,
+    const ExpenseSimplifierOptions& simplifier_options,
+    const OptimizeOptions& optimize_options, absl::Time deadline,
+    SimplificationCache* cache,
+    const std::function<void(const Transaction&)>& on_transaction) {
+  absl::StatusOr<DebtGraph> graph = DebtGraph::BuildFromProto(req.debts());
+  if (!graph.ok()) {
+    return ToGrpcStatus(graph.status());
+  }
+
+  const ExpenseSimplifierOptions options =
+      RequestOptions(req, simplifier_options);
+  if (req.optimize_for_ms() > 0) {
+    // Any transaction may still be replaced until the search is over.
+    const std::shared_ptr<const DebtList> transactions = OptimizedTransactions(
+        req, std::move(*graph), options, optimize_options, deadline);
+    for (const Transaction& transaction : transactions->transactions()) {
+      on_transaction(transaction);
+    }
+    return grpc::Status::OK;
+  }
+  std::string fingerprint;
+  if (cache != nullptr) {
+    fingerprint = SimplificationCache::Fingerprint(*graph, options.mode);
+    if (std::shared_ptr<const DebtList> cached = cache->Lookup(fingerprint)) {
+      for (const Transaction& transaction : cached->transactions()) {
+        on_transaction(transaction);
+      }
+      return grpc::Status::OK;
+    }
+  }
+
+  // The streamed transactions are collected for the cache as they go out.
+  DebtList transactions;
+  Transaction transaction;
+  ExpenseSimplifier simplifier(
+      std::move(*graph), options, ThreadWorkspace(),
+      [&](absl::string_view lender, absl::string_view receiver, Cents cents) {
+        transaction.set_lender(lender.data(), lender.size());
+        transaction.set_receiver(receiver.data(), receiver.size());
+        transaction.set_cents(cents);
+        on_transaction(transaction);
+        if (cache != nullptr) {
+          *transactions.add_transactions() = transaction;
+        }
+      });
+  if (cache != nullptr && IsCacheable(simplifier, options)) {
+    cache->Insert(std::move(fingerprint), std::move(transactions));
+  }
   return grpc::Status::OK;
 }
 
+grpc::Status AddDebtChunk(const DebtList& chunk, DebtGraph* graph) {
+  for (const Transaction& transaction : chunk.transactions()) {
+    absl::Status status = graph->AddTransaction(transaction);
+    if (!status.ok()) {
+      return ToGrpcStatus(status);
+    }
+  }
+  return grpc::Status::OK;
+}
+
+grpc::Status SimplifyDebtGraph(
+    DebtGraph&& graph, const ExpenseSimplifierOptions& simplifier_options,
+    SimplificationCache* cache, SimplifyDebtsRes* res) {
+  std::string fingerprint;
+  if (cache != nullptr) {
+    fingerprint = SimplificationCache::Fingerprint(graph,
+                                                   simplifier_options.mode);
+    if (std::shared_ptr<const DebtList> cached = cache->Lookup(fingerprint)) {
+      *res->mutable_transactions() = *cached;
+      return grpc::Status::OK;
+    }
+  }
+
+  ExpenseSimplifier simplifier(std::move(graph), simplifier_options,
+                               ThreadWorkspace());
+  // Built right on the response's arena if it has one, so a large result
+  // isn't allocated string by string and copied over.
+  res->set_allocated_transactions(
+      simplifier.MinimalTransactions().AllDebts(res->GetArena()));
+  if (cache != nullptr && IsCacheable(simplifier, simplifier_options)) {
+    cache->Insert(std::move(fingerprint), res->transactions());
+  }
+  return grpc::Status::OK;
+}
+
+grpc::Status AddGroupTransactions(const AddGroupTransactionsReq& req,
+                                  LedgerStore* store,
+                                  AddGroupTransactionsRes* res) {
+  return ToGrpcStatus(store->AddTransactions(req.group_id(),
+                                             req.transactions()));
+}
+
+grpc::Status GetGroupBalances(const GetGroupBalancesReq& req,
+                              LedgerStore* store, GetGroupBalancesRes* res) {
+  absl::StatusOr<std::shared_ptr<const LedgerVersion>> version =
+      store->Latest(req.group_id());
+  if (!version.ok()) {
+    return ToGrpcStatus(version.status());
+  }
+  return BalancesOf(req, **version, res);
+}
+
+std::optional<grpc::Status> GetLoadedGroupBalances(
+    const GetGroupBalancesReq& req, LedgerStore* store,
+    GetGroupBalancesRes* res) {
+  absl::StatusOr<std::shared_ptr<const LedgerVersion>> version =
+      store->LatestIfLoaded(req.group_id());
+  if (!version.ok()) {
+    return ToGrpcStatus(version.status());
+  }
+  if (*version == nullptr) {
+    return std::nullopt;
+  }
+  return BalancesOf(req, **version, res);
+}
+
 }  // namespace debt_simpl
@@ -1,14 +1,75 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <optional>
+
+#include "absl/time/time.h"
 #include "grpcpp/support/status.h"
 
-#include "proto/service.grpc.pb.h"
+#include "proto/debts.pb.h"
+#include "proto/service.pb.h"
+#include "server/src/expense_simplifier/debt_graph.h"
+#include "server/src/expense_simplifier/expense_simplifier.h"
+#include "server/src/expense_simplifier/simplification_cache.h"
+#include "server/src/ledger_store/ledger_store.h"
 
 namespace debt_simpl {
 
-class ServiceImpl : public DebtSimplifier::Service {
- public:
-  grpc::Status Test(grpc::ServerContext*, const TestReq*, TestRes*) override;
+// Bounds the search of requests with `optimize_for_ms` set.
+struct OptimizeOptions {
+  // The longest a request may search, whatever it asks for.
+  absl::Duration max_time = absl::Seconds(1);
+
+  // The search recurses once per nonzero balance, so ledgers with more of
+  // them are answered with the result of their mode alone.
+  uint32_t max_balances = 256;
 };
 
+// Answers a SimplifyDebts request with the minimal transactions settling the
+// requested debts, in the mode it asks for, optimized for as long as it asks
+// for within `optimize_options`, and never past `deadline`.
+//
+// Results are looked up in and added to `cache`, unless it is null.
+grpc::Status SimplifyDebts(const SimplifyDebtsReq& req,
+                           const ExpenseSimplifierOptions& simplifier_options,
+                           const OptimizeOptions& optimize_options,
+                           absl::Time deadline, SimplificationCache* cache,
+                           SimplifyDebtsRes* res);
+
+// Same as above, but passes each transaction of the result to
+// `on_transaction` as soon as it is settled, or once the search is over if it
+// is optimized. Calls are never concurrent.
+grpc::Status StreamSimplifiedDebts(
+    const SimplifyDebtsReq& req,
+    const ExpenseSimplifierOptions& simplifier_options,
+    const OptimizeOptions& optimize_options, absl::Time deadline,
+    SimplificationCache* cache,
+    const std::function<void(const Transaction&)>& on_transaction);
+
+// Adds the debts of `chunk`, one piece of a ledger streamed by a client, to
+// `graph`.
+grpc::Status AddDebtChunk(const DebtList& chunk, DebtGraph* graph);
+
+// Answers with the minimal transactions settling the debts of `graph`, once
+// every chunk of a streamed ledger was added to it.
+grpc::Status SimplifyDebtGraph(
+    DebtGraph&& graph, const ExpenseSimplifierOptions& simplifier_options,
+    SimplificationCache* cache, SimplifyDebtsRes* res);
+
+// Adds the transactions of `req` to its group in `store`.
+grpc::Status AddGroupTransactions(const AddGroupTransactionsReq& req,
+                                  LedgerStore* store,
+                                  AddGroupTransactionsRes* res);
+
+// Answers with the balances `req` asks for from its group in `store`.
+grpc::Status GetGroupBalances(const GetGroupBalancesReq& req,
+                              LedgerStore* store, GetGroupBalancesRes* res);
+
+// Same as `GetGroupBalances()`, but returns nullopt without answering if the
+// group has to be loaded from its log first, which may wait on the disk.
+std::optional<grpc::Status> GetLoadedGroupBalances(
+    const GetGroupBalancesReq& req, LedgerStore* store,
+    GetGroupBalancesRes* res);
+
 }  // namespace debt_simpl
@@ -0,0 +1,303 @@
+#include "server/src/service.h"
+
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/time/time.h"
+#include "gmock/gmock.h"
+#include "grpcpp/support/status.h"
+#include "gtest/gtest.h"
+
+#include "proto/debts.pb.h"
+#include "proto/service.pb.h"
+#include "server/src/expense_simplifier/debt_graph.h"
+#include "server/src/expense_simplifier/debt_list_testing.h"
+#include "server/src/expense_simplifier/expense_simplifier.h"
+#include "server/src/expense_simplifier/simplification_cache.h"
+#include "server/src/expense_simplifier/utils.h"
+#include "server/src/ledger_store/ledger_store.h"
+
+namespace debt_simpl {
+
+using ::testing::ElementsAre;
+using ::testing::UnorderedElementsAre;
+
+MATCHER_P2(BalanceIs, user, total_debt, "") {
+  return arg.user() == user && arg.total_debt() == total_debt;
+}
+
+class TestService : public ::testing::Test {
+ protected:
+  // Returns the nonzero net balance of every user of `debts`.
+  static absl::flat_hash_map<std::string, Cents> NetBalances(
+      const DebtList& debts) {
+    absl::flat_hash_map<std::string, Cents> balances;
+    for (const Transaction& t : debts.transactions()) {
+      balances[t.receiver()] += t.cents();
+      balances[t.lender()] -= t.cents();
+    }
+    absl::flat_hash_map<std::string, Cents> nonzero_balances;
+    for (const auto& [user, balance] : balances) {
+      if (balance != 0) {
+        nonzero_balances.emplace(user, balance);
+      }
+    }
+    return nonzero_balances;
+  }
+
+  // Returns the transactions of `debts` as (lender, receiver, cents), in
+  // sorted order.
+  static std::vector<std::tuple<std::string, std::string, Cents>> Sorted(
+      const DebtList& debts) {
+    std::vector<std::tuple<std::string, std::string, Cents>> sorted;
+    for (const Transaction& t : debts.transactions()) {
+      sorted.emplace_back(t.lender(), t.receiver(), t.cents());
+    }
+    std::sort(sorted.begin(), sorted.end());
+    return sorted;
+  }
+
+  static SimplifyDebtsReq Request(
+      const DebtList& debts,
+      SimplifyDebtsReq::Mode mode = SimplifyDebtsReq::EXISTING_EDGES) {
+    SimplifyDebtsReq req;
+    *req.mutable_debts() = debts;
+    req.set_mode(mode);
+    return req;
+  }
+
+  static AddGroupTransactionsReq AddRequest(const std::string& group_id,
+                                            const DebtList& transactions) {
+    AddGroupTransactionsReq req;
+    req.set_group_id(group_id);
+    *req.mutable_transactions() = transactions;
+    return req;
+  }
+
+  static GetGroupBalancesReq BalancesRequest(
+      const std::string& group_id, const std::vector<std::string>& users = {}) {
+    GetGroupBalancesReq req;
+    req.set_group_id(group_id);
+    for (const std::string& user : users) {
+      req.add_users(user);
+    }
+    return req;
+  }
+
+  const ExpenseSimplifierOptions options_;
+  SimplificationCache cache_;
+};
+
+TEST_F(TestService, SimplifyDebtsSettlesBalances) {
+  const DebtList debts = DebtListOf({ { "alice", "bob", 500 },
+                                      { "bob", "carol", 500 },
+                                      { "carol", "dave", 200 } });
+  for (const SimplifyDebtsReq::Mode mode :
+       { SimplifyDebtsReq::EXISTING_EDGES, SimplifyDebtsReq::NET_BALANCES,
+         SimplifyDebtsReq::MIN_TRANSACTIONS }) {
+    SimplifyDebtsRes res;
+    ASSERT_TRUE(SimplifyDebts(Request(debts, mode), options_, {},
+                              absl::InfiniteFuture(), nullptr, &res)
+                    .ok());
+    EXPECT_EQ(NetBalances(res.transactions()), NetBalances(debts));
+    if (mode != SimplifyDebtsReq::EXISTING_EDGES) {
+      EXPECT_EQ(res.transactions().transactions_size(), 2);
+    }
+  }
+}
+
+TEST_F(TestService, SimplifyDebtsCachesResults) {
+  const SimplifyDebtsReq req =
+      Request(DebtListOf({ { "alice", "bob", 500 }, { "bob", "carol", 500 } }));
+  SimplifyDebtsRes first;
+  ASSERT_TRUE(SimplifyDebts(req, options_, {}, absl::InfiniteFuture(), &cache_,
+                            &first)
+                  .ok());
+  SimplifyDebtsRes second;
+  ASSERT_TRUE(SimplifyDebts(req, options_, {}, absl::InfiniteFuture(), &cache_,
+                            &second)
+                  .ok());
+
+  EXPECT_EQ(cache_.GetStats().misses, 1);
+  EXPECT_EQ(cache_.GetStats().hits, 1);
+  EXPECT_EQ(second.SerializeAsString(), first.SerializeAsString());
+}
+
+TEST_F(TestService, InexactResultsNotCached) {
+  // Too many balances to search for the fewest transactions.
+  const ExpenseSimplifierOptions options = { .max_exact_balances = 0 };
+  const SimplifyDebtsReq req =
+      Request(DebtListOf({ { "alice", "bob", 500 }, { "bob", "carol", 300 } }),
+              SimplifyDebtsReq::MIN_TRANSACTIONS);
+  SimplifyDebtsRes res;
+  ASSERT_TRUE(
+      SimplifyDebts(req, options, {}, absl::InfiniteFuture(), &cache_, &res)
+          .ok());
+  ASSERT_TRUE(StreamSimplifiedDebts(req, options, {}, absl::InfiniteFuture(),
+                                    &cache_, [](const Transaction&) {})
+                  .ok());
+  EXPECT_EQ(cache_.GetStats().entries, 0);
+
+  ASSERT_TRUE(
+      SimplifyDebts(req, options_, {}, absl::InfiniteFuture(), &cache_, &res)
+          .ok());
+  EXPECT_EQ(cache_.GetStats().entries, 1);
+}
+
+TEST_F(TestService, OptimizedSearchBounded) {
+  // Settles in one transaction, from a to d, once the search is allowed.
+  SimplifyDebtsReq req = Request(DebtListOf(
+      { { "a", "b", 100 }, { "b", "c", 100 }, { "c", "d", 100 } }));
+  req.set_optimize_for_ms(60 * 60 * 1000);
+  const auto num_transactions = [&](const OptimizeOptions& optimize_options,
+                                    absl::Time deadline) {
+    SimplifyDebtsRes res;
+    EXPECT_TRUE(SimplifyDebts(req, options_, optimize_options, deadline,
+                              &cache_, &res)
+                    .ok());
+    return res.transactions().transactions_size();
+  };
+
+  EXPECT_EQ(num_transactions({}, absl::InfiniteFuture()), 1);
+  EXPECT_EQ(num_transactions({ .max_time = absl::ZeroDuration() },
+                             absl::InfiniteFuture()),
+            3);
+  EXPECT_EQ(num_transactions({}, absl::InfinitePast()), 3);
+  EXPECT_EQ(num_transactions({ .max_balances = 1 }, absl::InfiniteFuture()),
+            3);
+  EXPECT_EQ(cache_.GetStats().entries, 0);
+
+  DebtList streamed;
+  ASSERT_TRUE(StreamSimplifiedDebts(req, options_, {}, absl::InfiniteFuture(),
+                                    &cache_,
+                                    [&](const Transaction& transaction) {
+                                      *streamed.add_transactions() =
+                                          transaction;
+                                    })
+                  .ok());
+  EXPECT_EQ(streamed.transactions_size(), 1);
+}
+
+TEST_F(TestService, StreamedDebtsMatchSimplifiedDebts) {
+  const SimplifyDebtsReq req = Request(DebtListOf({ { "alice", "bob", 500 },
+                                                    { "bob", "carol", 300 },
+                                                    { "carol", "alice", 100 },
+                                                    { "dave", "bob", 50 } }));
+  SimplifyDebtsRes res;
+  ASSERT_TRUE(
+      SimplifyDebts(req, options_, {}, absl::InfiniteFuture(), nullptr, &res)
+          .ok());
+
+  // Streamed once into the cache, and once out of it.
+  for (int i = 0; i < 2; i++) {
+    DebtList streamed;
+    ASSERT_TRUE(StreamSimplifiedDebts(req, options_, {}, absl::InfiniteFuture(),
+                                      &cache_,
+                                      [&](const Transaction& transaction) {
+                                        *streamed.add_transactions() =
+                                            transaction;
+                                      })
+                    .ok());
+    // Transactions are streamed in the order they are settled.
+    EXPECT_EQ(Sorted(streamed), Sorted(res.transactions()));
+  }
+  EXPECT_EQ(cache_.GetStats().hits, 1);
+}
+
+TEST_F(TestService, ChunkedDebtsMatchSimplifiedDebts) {
+  const DebtList debts = DebtListOf({ { "alice", "bob", 500 },
+                                      { "bob", "carol", 300 },
+                                      { "carol", "alice", 100 } });
+  SimplifyDebtsRes res;
+  ASSERT_TRUE(SimplifyDebts(Request(debts), options_, {},
+                            absl::InfiniteFuture(), nullptr, &res)
+                  .ok());
+
+  DebtGraph graph;
+  for (const Transaction& transaction : debts.transactions()) {
+    DebtList chunk;
+    *chunk.add_transactions() = transaction;
+    ASSERT_TRUE(AddDebtChunk(chunk, &graph).ok());
+  }
+  SimplifyDebtsRes chunked_res;
+  ASSERT_TRUE(
+      SimplifyDebtGraph(std::move(graph), options_, nullptr, &chunked_res)
+          .ok());
+  EXPECT_EQ(chunked_res.SerializeAsString(), res.SerializeAsString());
+}
+
+TEST_F(TestService, GroupBalances) {
+  LedgerStore store;
+  AddGroupTransactionsRes add_res;
+  ASSERT_TRUE(AddGroupTransactions(
+                  AddRequest("trip", DebtListOf({ { "alice", "bob", 500 },
+                                                  { "bob", "carol", 200 } })),
+                  &store, &add_res)
+                  .ok());
+
+  GetGroupBalancesRes res;
+  ASSERT_TRUE(GetGroupBalances(BalancesRequest("trip"), &store, &res).ok());
+  EXPECT_THAT(res.balances(), UnorderedElementsAre(BalanceIs("alice", -500),
+                                                   BalanceIs("bob", 300),
+                                                   BalanceIs("carol", 200)));
+
+  GetGroupBalancesRes some_res;
+  ASSERT_TRUE(GetGroupBalances(BalancesRequest("trip", { "carol", "alice" }),
+                               &store, &some_res)
+                  .ok());
+  EXPECT_THAT(some_res.balances(),
+              ElementsAre(BalanceIs("carol", 200), BalanceIs("alice", -500)));
+}
+
+TEST_F(TestService, LoadedGroupBalances) {
+  LedgerStore store;
+  AddGroupTransactionsRes add_res;
+  ASSERT_TRUE(AddGroupTransactions(
+                  AddRequest("trip", DebtListOf({ { "alice", "bob", 500 } })),
+                  &store, &add_res)
+                  .ok());
+
+  GetGroupBalancesRes res;
+  std::optional<grpc::Status> status =
+      GetLoadedGroupBalances(BalancesRequest("trip", { "bob" }), &store, &res);
+  ASSERT_TRUE(status.has_value());
+  ASSERT_TRUE(status->ok());
+  EXPECT_THAT(res.balances(), ElementsAre(BalanceIs("bob", 500)));
+
+  // Groups only live in memory without a log directory, so there is none to
+  // load.
+  status = GetLoadedGroupBalances(BalancesRequest("missing"), &store, &res);
+  ASSERT_TRUE(status.has_value());
+  EXPECT_EQ(status->error_code(), grpc::StatusCode::NOT_FOUND);
+}
+
+TEST_F(TestService, StatusCodesCarryOver) {
+  LedgerStore store;
+  AddGroupTransactionsRes add_res;
+  EXPECT_EQ(AddGroupTransactions(
+                AddRequest("../trip", DebtListOf({ { "alice", "bob", 5 } })),
+                &store, &add_res)
+                .error_code(),
+            grpc::StatusCode::INVALID_ARGUMENT);
+
+  GetGroupBalancesRes res;
+  EXPECT_EQ(GetGroupBalances(BalancesRequest("trip"), &store, &res)
+                .error_code(),
+            grpc::StatusCode::NOT_FOUND);
+
+  ASSERT_TRUE(AddGroupTransactions(
+                  AddRequest("trip", DebtListOf({ { "alice", "bob", 5 } })),
+                  &store, &add_res)
+                  .ok());
+  EXPECT_EQ(GetGroupBalances(BalancesRequest("trip", { "carol" }), &store,
+                             &res)
+                .error_code(),
+            grpc::StatusCode::NOT_FOUND);
+}
+
+}  // namespace debt_simpl
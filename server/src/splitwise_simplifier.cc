@@ -1,54 +1,84 @@
 #include <algorithm>
-#include <cmath>
 #include <cstdint>
 #include <iostream>
-#include <iterator>
 #include <optional>
 #include <string>
+#include <vector>
 
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
 #include "absl/status/statusor.h"
+#include "absl/status/status.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 
 #include "proto/debts.pb.h"
-#include "server/src/csv/csv.h"
+#include "server/src/csv/csv_reader.h"
 #include "server/src/expense_simplifier/debt_graph.h"
 #include "server/src/expense_simplifier/expense_simplifier.h"
+#include "server/src/expense_simplifier/ledger_snapshot.h"
+#include "server/src/util/file_util.h"
 
 ABSL_FLAG(std::optional<std::string>, input_csv, std::nullopt,
           "The splitwise-exported CSV file of expenses.");
-
-absl::StatusOr<debt_simpl::DebtList> BuildDebtListFromSplitwiseExpenseReport(
+ABSL_FLAG(std::optional<std::string>, input_debt_list, std::nullopt,
+          "A serialized DebtList proto of expenses, such as the ones written "
+          "by //server/src/ledger_generator.");
+ABSL_FLAG(std::optional<std::string>, input_ledger_snapshot, std::nullopt,
+          "A ledger snapshot, such as one written with "
+          "`--output_ledger_snapshot`.");
+ABSL_FLAG(std::optional<std::string>, output_ledger_snapshot, std::nullopt,
+          "If set, the ledger is also saved as a snapshot to this path, which "
+          "loads much faster than the other inputs.");
+
+absl::StatusOr<debt_simpl::DebtGraph> BuildDebtGraphFromSplitwiseExpenseReport(
     const std::string& report_path) {
-  rapidcsv::Document document(report_path);
-
-  const size_t category_column = document.GetColumnIdx("Category");
+  // The report is tokenized straight out of the mapping, so memory use stays
+  // flat no matter how large the export is.
+  absl::StatusOr<debt_simpl::MappedFile> report =
+      debt_simpl::MappedFile::Open(report_path);
+  if (!report.ok()) {
+    return report.status();
+  }
+  debt_simpl::CsvReader reader(report->contents());
 
-  debt_simpl::DebtList debts;
-  const size_t num_rows = document.GetRowCount();
-  for (size_t i = 0; i < num_rows; i++) {
-    const std::vector<std::string> row = document.GetRow<std::string>(i);
-    if (row.size() != document.GetColumnCount() ||
-        document.GetCell<std::string>(category_column, i) == "Payment" ||
-        document.GetCell<std::string>(category_column, i) == " ") {
+  std::vector<absl::string_view> header;
+  if (!reader.NextRow(&header)) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Missing header in ", report_path));
+  }
+  const auto category_it =
+      std::find(header.begin(), header.end(), absl::string_view("Category"));
+  if (category_it == header.end()) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Missing \"Category\" column in ", report_path));
+  }
+  const size_t category_column = category_it - header.begin();
+
+  debt_simpl::DebtGraph graph;
+  std::vector<absl::string_view> row;
+  std::vector<debt_simpl::Cents> balances;
+  while (reader.NextRow(&row)) {
+    // Row numbers in errors don't count the header.
+    const uint64_t i = reader.RowIndex() - 1;
+    if (row.size() != header.size() || row[category_column] == "Payment" ||
+        row[category_column] == " ") {
       // Ignore payment columns.
       continue;
     }
 
-    std::vector<debt_simpl::Cents> balances;
     // The first 5 columns are metadata, and all the following are the debts for
     // each person.
-    std::transform(
-        row.begin() + 5, row.end(), std::back_inserter(balances),
-        [](const std::string& cell) {
-          size_t endptr;
-          double res = std::stod(cell, &endptr);
-          if (endptr != cell.size()) {
-            // TODO: Throw error.
-          }
-          return static_cast<debt_simpl::Cents>(std::round(res * 100));
-        });
+    balances.clear();
+    for (size_t j = 5; j < row.size(); j++) {
+      absl::StatusOr<debt_simpl::Cents> balance =
+          debt_simpl::ParseCents(row[j]);
+      if (!balance.ok()) {
+        return absl::InvalidArgumentError(
+            absl::StrCat(balance.status().message(), " in row ", i));
+      }
+      balances.push_back(*balance);
+    }
 
     size_t payer_idx = SIZE_MAX;
     for (size_t j = 0; j < balances.size(); j++) {
@@ -70,39 +100,79 @@ absl::StatusOr<debt_simpl::DebtList> BuildDebtListFromSplitwiseExpenseReport(
         } else if (balances[j] == 0) {
           continue;
         }
-        debt_simpl::Transaction& transaction = *debts.add_transactions();
-        transaction.set_lender(document.GetColumnName(payer_idx + 5));
-        transaction.set_receiver(document.GetColumnName(j + 5));
-        transaction.set_cents(-balances[j]);
+        absl::Status status = graph.AddTransaction(
+            header[payer_idx + 5], header[j + 5], -balances[j]);
+        if (!status.ok()) {
+          return status;
+        }
       }
     }
   }
 
-  return debts;
+  return graph;
+}
+
+absl::StatusOr<debt_simpl::DebtGraph> BuildDebtGraphFromDebtList(
+    const std::string& debt_list_path) {
+  absl::StatusOr<debt_simpl::MappedFile> debt_list =
+      debt_simpl::MappedFile::Open(debt_list_path);
+  if (!debt_list.ok()) {
+    return debt_list.status();
+  }
+  return debt_simpl::DebtGraph::BuildFromSerializedProto(
+      debt_list->contents());
+}
+
+absl::StatusOr<debt_simpl::DebtGraph> BuildDebtGraphFromLedgerSnapshot(
+    const std::string& snapshot_path) {
+  absl::StatusOr<debt_simpl::LedgerSnapshot> snapshot =
+      debt_simpl::LedgerSnapshot::Open(snapshot_path);
+  if (!snapshot.ok()) {
+    return snapshot.status();
+  }
+  if (absl::Status status = snapshot->Validate(); !status.ok()) {
+    return status;
+  }
+  return snapshot->ToDebtGraph();
 }
 
 int main(int argc, char* argv[]) {
   absl::ParseCommandLine(argc, argv);
 
   auto input_csv = absl::GetFlag(FLAGS_input_csv);
-  if (!input_csv.has_value()) {
-    std::cerr << "Must provide flag `--input_csv`" << std::endl;
-    return -1;
-  }
-
-  const absl::StatusOr<debt_simpl::DebtList> debts =
-      BuildDebtListFromSplitwiseExpenseReport(input_csv.value());
-  if (!debts.ok()) {
-    std::cerr << "Parse debts failed: " << debts.status() << std::endl;
+  auto input_debt_list = absl::GetFlag(FLAGS_input_debt_list);
+  auto input_ledger_snapshot = absl::GetFlag(FLAGS_input_ledger_snapshot);
+  if (input_csv.has_value() + input_debt_list.has_value() +
+          input_ledger_snapshot.has_value() !=
+      1) {
+    std::cerr << "Must provide exactly one of `--input_csv`, "
+                 "`--input_debt_list` and `--input_ledger_snapshot`"
+              << std::endl;
     return -1;
   }
 
-  auto graph = debt_simpl::DebtGraph::BuildFromProto(debts.value());
+  auto graph =
+      input_csv.has_value()
+          ? BuildDebtGraphFromSplitwiseExpenseReport(input_csv.value())
+      : input_debt_list.has_value()
+          ? BuildDebtGraphFromDebtList(input_debt_list.value())
+          : BuildDebtGraphFromLedgerSnapshot(input_ledger_snapshot.value());
   if (!graph.ok()) {
     std::cerr << "Build graph failed: " << graph.status() << std::endl;
     return -1;
   }
 
+  const auto output_ledger_snapshot =
+      absl::GetFlag(FLAGS_output_ledger_snapshot);
+  if (output_ledger_snapshot.has_value()) {
+    const absl::Status status = debt_simpl::LedgerSnapshot::Write(
+        graph.value(), output_ledger_snapshot.value());
+    if (!status.ok()) {
+      std::cerr << "Write snapshot failed: " << status << std::endl;
+      return -1;
+    }
+  }
+
   const debt_simpl::DebtList initial_transactions = graph.value().AllDebts();
   std::cout << "initial transactions:" << std::endl;
   for (const auto& transaction : initial_transactions.transactions()) {
@@ -26,5 +26,10 @@ bool StaticFileServer::Listen(const std::string& addr, uint16_t port) {
   return server_->listen(addr, port);
 }
 
+void StaticFileServer::Stop() {
+  server_->wait_until_ready();
+  server_->stop();
+}
+
 StaticFileServer::StaticFileServer()
     : server_(std::make_unique<httplib::Server>()) {}
@@ -17,8 +17,14 @@ class StaticFileServer {
 
   static absl::StatusOr<StaticFileServer> New(const std::string& dir);
 
+  // Serves files until `Stop()` is called, or returns false if the server
+  // can't listen on `addr`.
   bool Listen(const std::string& addr, uint16_t port);
 
+  // Makes `Listen()` return, waiting for it to start first if it was called
+  // from another thread and hasn't yet.
+  void Stop();
+
  private:
   StaticFileServer();
 
@@ -0,0 +1,124 @@
+#include "server/src/util/epoch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/base/const_init.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace debt_simpl {
+
+namespace {
+
+// Announced by threads outside of any guard.
+constexpr uint64_t kIdle = 0;
+
+// A thread's announcement of the epoch it entered its guard in.
+struct Slot {
+  std::atomic<uint64_t> epoch = kIdle;
+  std::atomic<bool> in_use = false;
+  Slot* next = nullptr;
+};
+
+// Counts the objects retired so far. Starts above `kIdle`.
+std::atomic<uint64_t> global_epoch = 1;
+
+// Every slot ever made. Slots are never freed, and are handed to new threads
+// once the thread holding them exits.
+std::atomic<Slot*> slots = nullptr;
+
+Slot* ClaimSlot() {
+  for (Slot* slot = slots.load(); slot != nullptr; slot = slot->next) {
+    bool in_use = false;
+    if (slot->in_use.compare_exchange_strong(in_use, true)) {
+      return slot;
+    }
+  }
+  Slot* const slot = new Slot();
+  slot->in_use = true;
+  slot->next = slots.load();
+  while (!slots.compare_exchange_weak(slot->next, slot)) {
+  }
+  return slot;
+}
+
+// The slot of a thread, and the number of guards it is in.
+struct ThreadState {
+  ThreadState() : slot(ClaimSlot()) {}
+  ~ThreadState() {
+    slot->in_use = false;
+  }
+
+  Slot* const slot;
+  int depth = 0;
+};
+
+thread_local ThreadState thread_state;
+
+struct RetiredObject {
+  // The epoch the object was retired in. Readers that announce a later one
+  // entered their guard after it was unreachable.
+  uint64_t epoch;
+  std::shared_ptr<const void> object;
+};
+
+ABSL_CONST_INIT absl::Mutex retired_mutex(absl::kConstInit);
+std::vector<RetiredObject>& RetiredObjects()
+    ABSL_EXCLUSIVE_LOCKS_REQUIRED(retired_mutex) {
+  static auto* const retired = new std::vector<RetiredObject>();
+  return *retired;
+}
+
+}  // namespace
+
+// Readers announce their epoch before loading anything, and writers bump the
+// epoch after making an object unreachable and before scanning the slots,
+// all in sequentially consistent order. A reader whose announcement a scan
+// misses therefore loads after the object was made unreachable, and one that
+// announces an epoch past the object's did as well.
+EpochGuard::EpochGuard() {
+  if (thread_state.depth++ == 0) {
+    thread_state.slot->epoch.store(global_epoch.load());
+  }
+}
+
+EpochGuard::~EpochGuard() {
+  if (--thread_state.depth == 0) {
+    thread_state.slot->epoch.store(kIdle, std::memory_order_release);
+  }
+}
+
+void Retire(std::shared_ptr<const void> object) {
+  const uint64_t epoch = global_epoch.fetch_add(1);
+  uint64_t oldest_reader = UINT64_MAX;
+  for (Slot* slot = slots.load(); slot != nullptr; slot = slot->next) {
+    const uint64_t reader_epoch = slot->epoch.load();
+    if (reader_epoch != kIdle) {
+      oldest_reader = std::min(oldest_reader, reader_epoch);
+    }
+  }
+
+  // Dropped outside of the lock, since dropping an object may free others.
+  std::vector<RetiredObject> dropped;
+  {
+    absl::MutexLock lock(&retired_mutex);
+    std::vector<RetiredObject>& retired = RetiredObjects();
+    retired.push_back({ .epoch = epoch, .object = std::move(object) });
+    // The scan only covers objects retired up to this one. Others retired
+    // since may be held by readers that entered after it.
+    const auto still_used = std::partition(
+        retired.begin(), retired.end(), [epoch, oldest_reader](const auto& r) {
+          return r.epoch > epoch || r.epoch >= oldest_reader;
+        });
+    dropped.assign(std::make_move_iterator(still_used),
+                   std::make_move_iterator(retired.end()));
+    retired.erase(still_used, retired.end());
+  }
+}
+
+}  // namespace debt_simpl
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+namespace debt_simpl {
+
+// Epoch-based reclamation of objects that readers load from atomic pointers
+// without taking a lock, while writers replace them.
+//
+// A reader holds an EpochGuard for as long as it uses an object it loaded. A
+// writer that replaces an object passes the old one to `Retire()`, which
+// drops it once every guard that may have loaded it is gone. Entering and
+// leaving a guard only stores the current epoch to a slot of the calling
+// thread, which writers scan to find what they can drop.
+class EpochGuard {
+ public:
+  EpochGuard();
+  ~EpochGuard();
+
+  EpochGuard(const EpochGuard&) = delete;
+  EpochGuard& operator=(const EpochGuard&) = delete;
+};
+
+// Drops `object`, which must no longer be reachable by readers that enter a
+// guard from now on, once no reader can still be using it. Objects are
+// dropped by this and later calls, on the threads that make them.
+void Retire(std::shared_ptr<const void> object);
+
+// A pointer to an immutable object, which readers load under an EpochGuard
+// while a writer replaces the object.
+template <typename T>
+class EpochPtr {
+ public:
+  EpochPtr() = default;
+  explicit EpochPtr(std::shared_ptr<const T> object) {
+    Store(std::move(object));
+  }
+
+  EpochPtr(const EpochPtr&) = delete;
+  EpochPtr& operator=(const EpochPtr&) = delete;
+
+  // Returns the latest object, which stays valid for as long as the caller's
+  // EpochGuard. Thread-safe.
+  const T* Load() const {
+    return ptr_.load();
+  }
+
+  // Returns the latest object to a writer. Not thread-safe against `Store()`.
+  const std::shared_ptr<const T>& Current() const {
+    return current_;
+  }
+
+  // Replaces the object with `object`, retiring the one it replaces. Writers
+  // must store one at a time.
+  void Store(std::shared_ptr<const T> object) {
+    ptr_.store(object.get());
+    std::shared_ptr<const T> replaced =
+        std::exchange(current_, std::move(object));
+    if (replaced != nullptr) {
+      Retire(std::move(replaced));
+    }
+  }
+
+ private:
+  // Owns the object `ptr_` points to.
+  std::shared_ptr<const T> current_;
+  std::atomic<const T*> ptr_ = nullptr;
+};
+
+}  // namespace debt_simpl
@@ -0,0 +1,147 @@
+#include "server/src/util/epoch.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace debt_simpl {
+
+TEST(Epoch, RetiredObjectsWithoutReadersAreDropped) {
+  auto object = std::make_shared<const int>(1);
+  const std::weak_ptr<const int> weak = object;
+  Retire(std::move(object));
+  EXPECT_TRUE(weak.expired());
+}
+
+TEST(Epoch, GuardsKeepRetiredObjectsAlive) {
+  auto object = std::make_shared<const int>(1);
+  const std::weak_ptr<const int> weak = object;
+  {
+    EpochGuard guard;
+    {
+      // Nested guards leave the outer one's epoch in place.
+      EpochGuard nested_guard;
+    }
+    Retire(std::move(object));
+    EXPECT_FALSE(weak.expired());
+  }
+
+  // Dropped by the next retire, now that the reader is gone.
+  Retire(std::make_shared<const int>(2));
+  EXPECT_TRUE(weak.expired());
+}
+
+TEST(Epoch, ReadersNeverSeeFreedObjects) {
+  // Poisoned when destroyed, so that a reader seeing a freed one is likely
+  // to notice.
+  struct Value {
+    ~Value() {
+      alive = false;
+    }
+    uint64_t n;
+    bool alive = true;
+  };
+
+  EpochPtr<Value> ptr(std::make_shared<const Value>(Value{ .n = 0 }));
+  std::atomic<bool> done = false;
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; i++) {
+    readers.emplace_back([&]() {
+      uint64_t last = 0;
+      while (!done) {
+        EpochGuard guard;
+        const Value* value = ptr.Load();
+        EXPECT_TRUE(value->alive);
+        EXPECT_GE(value->n, last);
+        last = value->n;
+      }
+    });
+  }
+  for (uint64_t n = 1; n <= 10000; n++) {
+    ptr.Store(std::make_shared<const Value>(Value{ .n = n }));
+  }
+  done = true;
+  for (std::thread& reader : readers) {
+    reader.join();
+  }
+
+  EpochGuard guard;
+  EXPECT_EQ(ptr.Load()->n, 10000);
+}
+
+TEST(Epoch, WritersOnlyDropWhatNoReaderHolds) {
+  constexpr int kNumWriters = 4;
+  constexpr uint64_t kStoresPerWriter = 100000;
+  constexpr uint64_t kNumValues = kNumWriters * (kStoresPerWriter + 1);
+
+  // Which values were dropped, by serial number, kept apart from the values
+  // so that it isn't lost to a reuse of their memory.
+  std::vector<std::atomic<bool>> dropped(kNumValues);
+  struct Value {
+    Value(std::vector<std::atomic<bool>>* dropped, uint64_t serial)
+        : dropped(dropped), serial(serial) {}
+    ~Value() {
+      (*dropped)[serial] = true;
+    }
+    std::vector<std::atomic<bool>>* const dropped;
+    const uint64_t serial;
+  };
+  std::atomic<uint64_t> next_serial = 0;
+  const auto new_value = [&]() {
+    return std::make_shared<const Value>(&dropped, next_serial++);
+  };
+
+  // Each writer replaces an object of its own, so that readers also catch
+  // a writer dropping what another one retired.
+  std::vector<std::unique_ptr<EpochPtr<Value>>> ptrs;
+  for (int i = 0; i < kNumWriters; i++) {
+    ptrs.push_back(std::make_unique<EpochPtr<Value>>(new_value()));
+  }
+  std::atomic<bool> done = false;
+  std::atomic<uint64_t> num_dropped_reads = 0;
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; i++) {
+    readers.emplace_back([&]() {
+      while (!done) {
+        {
+          EpochGuard guard;
+          uint64_t serials[kNumWriters];
+          for (int j = 0; j < kNumWriters; j++) {
+            serials[j] = ptrs[j]->Load()->serial;
+          }
+          std::this_thread::yield();
+          for (const uint64_t serial : serials) {
+            if (dropped[serial]) {
+              num_dropped_reads++;
+            }
+          }
+        }
+        // Readers are mostly outside of guards, so that writers' scans
+        // often find none.
+        std::this_thread::yield();
+      }
+    });
+  }
+  std::vector<std::thread> writers;
+  for (int i = 0; i < kNumWriters; i++) {
+    writers.emplace_back([&, i]() {
+      for (uint64_t n = 0; n < kStoresPerWriter; n++) {
+        ptrs[i]->Store(new_value());
+      }
+    });
+  }
+  for (std::thread& writer : writers) {
+    writer.join();
+  }
+  done = true;
+  for (std::thread& reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(num_dropped_reads, 0);
+}
+
+}  // namespace debt_simpl
@@ -0,0 +1,145 @@
+#include "server/src/util/file_util.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+
+namespace debt_simpl {
+
+absl::Status ErrnoError(absl::string_view action, const std::string& path) {
+  const int error_number = errno;
+  return absl::Status(absl::ErrnoToStatusCode(error_number),
+                      absl::StrCat("Failed to ", action, " ", path, ": ",
+                                   std::strerror(error_number)));
+}
+
+// static
+absl::StatusOr<MappedFile> MappedFile::Open(const std::string& path) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return ErrnoError("open", path);
+  }
+
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    const absl::Status status = ErrnoError("stat", path);
+    close(fd);
+    return status;
+  }
+
+  const uint64_t size = static_cast<uint64_t>(file_stat.st_size);
+  if (size == 0) {
+    close(fd);
+    return MappedFile(nullptr, 0);
+  }
+
+  void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping keeps the file alive on its own.
+  close(fd);
+  if (data == MAP_FAILED) {
+    return ErrnoError("map", path);
+  }
+  // Files are read front to back, so let the kernel read ahead aggressively.
+  madvise(data, size, MADV_SEQUENTIAL);
+
+  return MappedFile(static_cast<const char*>(data), size);
+}
+
+MappedFile::MappedFile(MappedFile&& other) {
+  *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) {
+  if (this != &other) {
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+  }
+  return *this;
+}
+
+MappedFile::~MappedFile() {
+  if (data_ != nullptr) {
+    munmap(const_cast<char*>(data_), size_);
+  }
+}
+
+absl::Status WriteAll(int fd, absl::string_view data,
+                      const std::string& path) {
+  while (!data.empty()) {
+    const ssize_t written = write(fd, data.data(), data.size());
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return ErrnoError("write", path);
+    }
+    data.remove_prefix(static_cast<size_t>(written));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status SyncDirectory(const std::string& dir) {
+  const int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd < 0) {
+    return ErrnoError("open", dir);
+  }
+  const bool synced = fsync(fd) == 0;
+  const absl::Status status =
+      synced ? absl::OkStatus() : ErrnoError("sync", dir);
+  close(fd);
+  return status;
+}
+
+absl::Status WriteFileAtomically(const std::string& path,
+                                 absl::string_view contents) {
+  std::string temp_path = absl::StrCat(path, ".tmp.XXXXXX");
+  const int fd = mkstemp(temp_path.data());
+  if (fd < 0) {
+    return ErrnoError("create a temporary file for", path);
+  }
+  // mkstemp() creates files only their owner can access, so the result gets
+  // the usual permissions of a new file back.
+  absl::Status status = absl::OkStatus();
+  if (fchmod(fd, 0644) != 0) {
+    status = ErrnoError("chmod", temp_path);
+  }
+  if (status.ok()) {
+    status = WriteAll(fd, contents, temp_path);
+  }
+  if (status.ok() && fsync(fd) != 0) {
+    status = ErrnoError("sync", temp_path);
+  }
+  if (close(fd) != 0 && status.ok()) {
+    status = ErrnoError("close", temp_path);
+  }
+  if (status.ok() && std::rename(temp_path.c_str(), path.c_str()) != 0) {
+    status = ErrnoError("rename", temp_path);
+  }
+  if (!status.ok()) {
+    unlink(temp_path.c_str());
+    return status;
+  }
+
+  // The rename itself is only durable once the directory is synced.
+  std::string dir = std::filesystem::path(path).parent_path().string();
+  if (dir.empty()) {
+    dir = ".";
+  }
+  return SyncDirectory(dir);
+}
+
+}  // namespace debt_simpl
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+
+namespace debt_simpl {
+
+// Returns the error of the failed system call that set `errno`, which tried to
+// `action` the file at `path`.
+absl::Status ErrnoError(absl::string_view action, const std::string& path);
+
+// A read-only memory mapping of a whole file.
+class MappedFile {
+ public:
+  static absl::StatusOr<MappedFile> Open(const std::string& path);
+
+  MappedFile(MappedFile&& other);
+  MappedFile& operator=(MappedFile&& other);
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  ~MappedFile();
+
+  absl::string_view contents() const {
+    return absl::string_view(data_, size_);
+  }
+
+ private:
+  MappedFile(const char* data, uint64_t size) : data_(data), size_(size) {}
+
+  const char* data_ = nullptr;
+  uint64_t size_ = 0;
+};
+
+// Writes all of `data` to `fd`, which is the file at `path`, retrying short
+// and interrupted writes.
+absl::Status WriteAll(int fd, absl::string_view data, const std::string& path);
+
+// Syncs the entries of directory `dir`, so that files created or renamed in
+// it survive a crash.
+absl::Status SyncDirectory(const std::string& dir);
+
+// Replaces the file at `path` with one holding `contents`. They are written to
+// a uniquely named temporary file next to it and synced before it replaces
+// `path`, and the directory is synced after, so a crash leaves either the old
+// file or the new one, never a partial one. Concurrent writers of the same
+// path never share a temporary file, and a failed write leaves none behind.
+absl::Status WriteFileAtomically(const std::string& path,
+                                 absl::string_view contents);
+
+}  // namespace debt_simpl
@@ -0,0 +1,78 @@
+#include "server/src/util/file_util.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "server/src/expense_simplifier/utils.h"
+
+namespace debt_simpl {
+
+using ::testing::ElementsAre;
+using ::testing::Not;
+
+class TestFileUtil : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    dir_ = ::testing::TempDir() + "/file_util_test";
+    std::filesystem::remove_all(dir_);
+    std::filesystem::create_directories(dir_);
+  }
+
+  void TearDown() override {
+    std::filesystem::remove_all(dir_);
+  }
+
+  // Returns the names of the files in `dir_`.
+  std::vector<std::string> Files() const {
+    std::vector<std::string> files;
+    for (const auto& entry : std::filesystem::directory_iterator(dir_)) {
+      files.push_back(entry.path().filename().string());
+    }
+    return files;
+  }
+
+  std::string dir_;
+};
+
+TEST_F(TestFileUtil, MappedFile) {
+  const std::string path = dir_ + "/ledger.csv";
+  FILE* file = std::fopen(path.c_str(), "w");
+  ASSERT_NE(file, nullptr);
+  std::fputs("Date,Cost\n2024-01-01,12.50\n", file);
+  std::fclose(file);
+
+  ASSERT_OK_AND_DEFINE(MappedFile, mapped_file, MappedFile::Open(path));
+  EXPECT_EQ(mapped_file.contents(), "Date,Cost\n2024-01-01,12.50\n");
+
+  EXPECT_THAT(MappedFile::Open(path + ".missing"), Not(IsOk()));
+}
+
+TEST_F(TestFileUtil, WriteFileAtomically) {
+  const std::string path = dir_ + "/out";
+  ASSERT_THAT(WriteFileAtomically(path, "first"), IsOk());
+  ASSERT_THAT(WriteFileAtomically(path, "second"), IsOk());
+
+  ASSERT_OK_AND_DEFINE(MappedFile, mapped_file, MappedFile::Open(path));
+  EXPECT_EQ(mapped_file.contents(), "second");
+  EXPECT_THAT(Files(), ElementsAre("out"));
+
+  EXPECT_THAT(WriteFileAtomically(path + ".missing/file", "contents"),
+              Not(IsOk()));
+}
+
+TEST_F(TestFileUtil, FailedWriteLeavesNoTemporaryFile) {
+  // A directory can't be replaced by a file, so only the rename fails.
+  const std::string path = dir_ + "/out";
+  std::filesystem::create_directory(path);
+
+  EXPECT_THAT(WriteFileAtomically(path, "contents"), Not(IsOk()));
+  EXPECT_THAT(Files(), ElementsAre("out"));
+  EXPECT_TRUE(std::filesystem::is_directory(path));
+}
+
+}  // namespace debt_simpl
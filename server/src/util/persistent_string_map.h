@@ -0,0 +1,162 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/hash/hash.h"
+#include "absl/numeric/bits.h"
+#include "absl/strings/string_view.h"
+
+namespace debt_simpl {
+
+// A map from strings to values that is copied in constant time, and whose
+// copies share every entry they don't change.
+//
+// Entries live in a hash array mapped trie: each level of the trie is picked
+// by the next 5 bits of the key's hash, and nodes only hold the children
+// they have. `Insert()` copies only the nodes on the path to the new entry,
+// unless the map is their only holder, in which case they are changed in
+// place. Copies can be read from any number of threads while another copy is
+// changed.
+template <typename V>
+class PersistentStringMap {
+ public:
+  PersistentStringMap() = default;
+
+  size_t size() const {
+    return size_;
+  }
+
+  // Returns the value of `key`, or null if it isn't in the map.
+  const V* Find(absl::string_view key) const {
+    const uint64_t hash = Hash(key);
+    const Node* node = root_.get();
+    for (uint32_t shift = 0; node != nullptr; shift += kBits) {
+      if (shift >= kHashBits) {
+        for (const std::shared_ptr<const Entry>& entry : node->collisions) {
+          if (entry->key == key) {
+            return &entry->value;
+          }
+        }
+        return nullptr;
+      }
+      const uint32_t bit = Bit(hash, shift);
+      if ((node->bitmap & bit) == 0) {
+        return nullptr;
+      }
+      const Slot& slot = node->slots[Position(*node, bit)];
+      if (slot.entry != nullptr) {
+        return slot.entry->key == key ? &slot.entry->value : nullptr;
+      }
+      node = slot.child.get();
+    }
+    return nullptr;
+  }
+
+  // Maps `key` to `value`, unless it is already in the map. Returns whether
+  // it was inserted.
+  bool Insert(absl::string_view key, V value) {
+    if (Find(key) != nullptr) {
+      return false;
+    }
+    if (root_ == nullptr) {
+      root_ = std::make_shared<Node>();
+    }
+    auto entry = std::make_shared<const Entry>(
+        Entry{ .hash = Hash(key),
+               .key = std::string(key),
+               .value = std::move(value) });
+    InsertInto(root_, /*shift=*/0, std::move(entry));
+    size_++;
+    return true;
+  }
+
+ private:
+  static constexpr uint32_t kBits = 5;
+  static constexpr uint32_t kHashBits = 64;
+
+  struct Entry {
+    uint64_t hash;
+    std::string key;
+    V value;
+  };
+
+  struct Node;
+
+  // Either an entry or a child holding the entries that share this slot.
+  struct Slot {
+    std::shared_ptr<const Entry> entry;
+    std::shared_ptr<Node> child;
+  };
+
+  struct Node {
+    // Which of the 32 slots of the level are taken, and the taken ones in
+    // order.
+    uint32_t bitmap = 0;
+    std::vector<Slot> slots;
+    // The entries of a node past the last level, whose hashes are all the
+    // same.
+    std::vector<std::shared_ptr<const Entry>> collisions;
+  };
+
+  static uint64_t Hash(absl::string_view key) {
+    return absl::Hash<absl::string_view>()(key);
+  }
+
+  static uint32_t Bit(uint64_t hash, uint32_t shift) {
+    return uint32_t{ 1 } << ((hash >> shift) & ((1 << kBits) - 1));
+  }
+
+  static size_t Position(const Node& node, uint32_t bit) {
+    return absl::popcount(node.bitmap & (bit - 1));
+  }
+
+  // Inserts `entry`, whose key isn't in the map, below `node` at the level
+  // of `shift`.
+  static void InsertInto(std::shared_ptr<Node>& node, uint32_t shift,
+                         std::shared_ptr<const Entry> entry) {
+    Node* const mutable_node = Mutable(node);
+    if (shift >= kHashBits) {
+      mutable_node->collisions.push_back(std::move(entry));
+      return;
+    }
+    const uint32_t bit = Bit(entry->hash, shift);
+    const size_t position = Position(*mutable_node, bit);
+    if ((mutable_node->bitmap & bit) == 0) {
+      mutable_node->bitmap |= bit;
+      mutable_node->slots.insert(mutable_node->slots.begin() + position,
+                                 Slot{ .entry = std::move(entry) });
+      return;
+    }
+    Slot& slot = mutable_node->slots[position];
+    if (slot.entry != nullptr) {
+      // The entry in the slot moves down a level, next to the new one.
+      slot.child = std::make_shared<Node>();
+      InsertInto(slot.child, shift + kBits, std::move(slot.entry));
+    }
+    InsertInto(slot.child, shift + kBits, std::move(entry));
+  }
+
+  // Returns `node` to change in place, replacing it with a copy first unless
+  // this map is its only holder.
+  static Node* Mutable(std::shared_ptr<Node>& node) {
+    if (node.use_count() == 1) {
+      // Pairs with the release of the last other holder, so that its reads
+      // of the node happen before the changes.
+      std::atomic_thread_fence(std::memory_order_acquire);
+    } else {
+      node = std::make_shared<Node>(*node);
+    }
+    return node.get();
+  }
+
+  std::shared_ptr<Node> root_;
+  size_t size_ = 0;
+};
+
+}  // namespace debt_simpl
@@ -0,0 +1,67 @@
+#include "server/src/util/persistent_string_map.h"
+
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "gtest/gtest.h"
+
+namespace debt_simpl {
+
+TEST(PersistentStringMap, InsertsAndFinds) {
+  PersistentStringMap<int> map;
+  EXPECT_EQ(map.Find("alice"), nullptr);
+  EXPECT_TRUE(map.Insert("alice", 1));
+  EXPECT_TRUE(map.Insert("bob", 2));
+  EXPECT_TRUE(map.Insert("", 3));
+  EXPECT_FALSE(map.Insert("alice", 4));
+
+  EXPECT_EQ(map.size(), 3);
+  ASSERT_NE(map.Find("alice"), nullptr);
+  EXPECT_EQ(*map.Find("alice"), 1);
+  ASSERT_NE(map.Find("bob"), nullptr);
+  EXPECT_EQ(*map.Find("bob"), 2);
+  ASSERT_NE(map.Find(""), nullptr);
+  EXPECT_EQ(*map.Find(""), 3);
+  EXPECT_EQ(map.Find("carol"), nullptr);
+}
+
+TEST(PersistentStringMap, ManyKeys) {
+  constexpr int kNumKeys = 100000;
+  PersistentStringMap<int> map;
+  for (int i = 0; i < kNumKeys; i++) {
+    ASSERT_TRUE(map.Insert(absl::StrCat("user", i), i));
+  }
+  EXPECT_EQ(map.size(), kNumKeys);
+  for (int i = 0; i < kNumKeys; i++) {
+    const int* value = map.Find(absl::StrCat("user", i));
+    ASSERT_NE(value, nullptr);
+    EXPECT_EQ(*value, i);
+  }
+  EXPECT_EQ(map.Find(absl::StrCat("user", kNumKeys)), nullptr);
+}
+
+TEST(PersistentStringMap, CopiesAreIndependent) {
+  PersistentStringMap<int> map;
+  for (int i = 0; i < 1000; i++) {
+    map.Insert(absl::StrCat("user", i), i);
+  }
+
+  PersistentStringMap<int> copy = map;
+  copy.Insert("alice", -1);
+  map.Insert("bob", -2);
+
+  EXPECT_EQ(map.size(), 1001);
+  EXPECT_EQ(copy.size(), 1001);
+  EXPECT_EQ(map.Find("alice"), nullptr);
+  EXPECT_EQ(copy.Find("bob"), nullptr);
+  ASSERT_NE(copy.Find("alice"), nullptr);
+  EXPECT_EQ(*copy.Find("alice"), -1);
+  ASSERT_NE(map.Find("bob"), nullptr);
+  EXPECT_EQ(*map.Find("bob"), -2);
+  for (int i = 0; i < 1000; i++) {
+    ASSERT_NE(copy.Find(absl::StrCat("user", i)), nullptr);
+    EXPECT_EQ(*copy.Find(absl::StrCat("user", i)), i);
+  }
+}
+
+}  // namespace debt_simpl
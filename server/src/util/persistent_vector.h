@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace debt_simpl {
+
+// A vector that is copied in constant time, and whose copies share every
+// element they don't change.
+//
+// Elements live in the leaves of a tree of 32-way nodes. A copy shares the
+// root, and `Set()` and `PushBack()` copy only the nodes on the path to the
+// element they change, unless the vector is their only holder, in which case
+// they are changed in place. Copies can be read from any number of threads
+// while another copy is changed.
+template <typename T>
+class PersistentVector {
+ public:
+  PersistentVector() = default;
+
+  size_t size() const {
+    return size_;
+  }
+
+  const T& operator[](size_t i) const {
+    const Node* node = root_.get();
+    for (uint32_t shift = shift_; shift > 0; shift -= kBits) {
+      node = node->children[(i >> shift) & kMask].get();
+    }
+    return node->values[i & kMask];
+  }
+
+  void Set(size_t i, T value) {
+    Node* node = Mutable(root_);
+    for (uint32_t shift = shift_; shift > 0; shift -= kBits) {
+      node = Mutable(node->children[(i >> shift) & kMask]);
+    }
+    node->values[i & kMask] = std::move(value);
+  }
+
+  void PushBack(T value) {
+    if (root_ == nullptr) {
+      root_ = std::make_shared<Node>();
+    } else if (size_ == (size_t{ 1 } << (shift_ + kBits))) {
+      // The tree is full, so it grows a level.
+      auto root = std::make_shared<Node>();
+      root->children.push_back(std::move(root_));
+      root_ = std::move(root);
+      shift_ += kBits;
+    }
+
+    const size_t i = size_++;
+    Node* node = Mutable(root_);
+    for (uint32_t shift = shift_; shift > 0; shift -= kBits) {
+      std::vector<std::shared_ptr<Node>>& children = node->children;
+      const size_t child = (i >> shift) & kMask;
+      if (child == children.size()) {
+        children.push_back(std::make_shared<Node>());
+      }
+      node = Mutable(children[child]);
+    }
+    node->values.push_back(std::move(value));
+  }
+
+ private:
+  static constexpr uint32_t kBits = 5;
+  static constexpr size_t kMask = (size_t{ 1 } << kBits) - 1;
+
+  // The children of an inner node, or the elements of a leaf.
+  struct Node {
+    std::vector<std::shared_ptr<Node>> children;
+    std::vector<T> values;
+  };
+
+  // Returns `node` to change in place, replacing it with a copy first unless
+  // this vector is its only holder.
+  static Node* Mutable(std::shared_ptr<Node>& node) {
+    if (node.use_count() == 1) {
+      // Pairs with the release of the last other holder, so that its reads
+      // of the node happen before the changes.
+      std::atomic_thread_fence(std::memory_order_acquire);
+    } else {
+      node = std::make_shared<Node>(*node);
+    }
+    return node.get();
+  }
+
+  std::shared_ptr<Node> root_;
+  size_t size_ = 0;
+  // The shift of the index bits picking a child of the root. Leaves are at
+  // shift 0.
+  uint32_t shift_ = 0;
+};
+
+}  // namespace debt_simpl
@@ -0,0 +1,56 @@
+#include "server/src/util/persistent_vector.h"
+
+#include <cstddef>
+
+#include "gtest/gtest.h"
+
+namespace debt_simpl {
+
+TEST(PersistentVector, PushesAndSets) {
+  // Enough elements for a tree of three levels.
+  constexpr size_t kSize = 40000;
+  PersistentVector<size_t> vector;
+  EXPECT_EQ(vector.size(), 0);
+  for (size_t i = 0; i < kSize; i++) {
+    vector.PushBack(i);
+  }
+  ASSERT_EQ(vector.size(), kSize);
+  for (size_t i = 0; i < kSize; i++) {
+    ASSERT_EQ(vector[i], i);
+  }
+
+  for (size_t i = 0; i < kSize; i += 7) {
+    vector.Set(i, 2 * i);
+  }
+  for (size_t i = 0; i < kSize; i++) {
+    ASSERT_EQ(vector[i], i % 7 == 0 ? 2 * i : i);
+  }
+}
+
+TEST(PersistentVector, CopiesAreIndependent) {
+  PersistentVector<int> vector;
+  for (int i = 0; i < 1000; i++) {
+    vector.PushBack(i);
+  }
+
+  PersistentVector<int> copy = vector;
+  copy.Set(500, -1);
+  copy.PushBack(1000);
+  vector.Set(0, -2);
+
+  ASSERT_EQ(vector.size(), 1000);
+  ASSERT_EQ(copy.size(), 1001);
+  EXPECT_EQ(vector[500], 500);
+  EXPECT_EQ(copy[500], -1);
+  EXPECT_EQ(vector[0], -2);
+  EXPECT_EQ(copy[0], 0);
+  EXPECT_EQ(copy[1000], 1000);
+  for (int i = 1; i < 1000; i++) {
+    if (i != 500) {
+      ASSERT_EQ(vector[i], i);
+      ASSERT_EQ(copy[i], i);
+    }
+  }
+}
+
+}  // namespace debt_simpl